@@ -5,11 +5,32 @@
  * Based on a probabilistic model for word correction
  *
  * AUTOCORR_check_word - check frequency of word in trie
+ * AUTOCORR_check_words - check frequencies of batch of words in trie
  * AUTOCORR_upload - add words and frequencies to trie
+ * AUTOCORR_compile_data - compile word data into binary image
+ * AUTOCORR_compile_words - compile words and frequencies into binary image
+ * AUTOCORR_dict_learn - add words or frequencies to loaded word data, recorded in delta log
+ * AUTOCORR_dict_compact - merge delta log into word data file
+ * AUTOCORR_dict_set_log_limit - set size of delta log past which learning merges it
  * AUTOCORR_correct_word - give correct spelling of misspelled word
+ * AUTOCORR_suggest - give k best ranked suggestions for misspelled word
+ * AUTOCORR_set_edit_distance - set edit distance of trie search corrections
+ * AUTOCORR_build_deletes_index - index word deletes for larger edit distances
+ * search_trie - bounded edit distance search of trie
  * AUTOCORR_size_data - give number of unique words in word frequency data
  * AUTOCORR_unload_words - unload word hash table to free memory
- * unload_rec - recursively unloads trie from memory
+ * AUTOCORR_dict_check_span - check frequency of word given by pointer and length
+ * AUTOCORR_dict_overlay - layer small dict of added or suppressed words over a shared one
+ * AUTOCORR_dict_upload_tiered - load most frequent words at once and the rest in background
+ * AUTOCORR_dict_wait - wait for all words of tiered dict, telling if they could be loaded
+ * AUTOCORR_dict_* - same operations on an explicit dict shareable between threads
+ * AUTOCORR_ctx_* - per-thread correction state, correcting into caller buffers
+ * AUTOCORR_ctx_stats - give work counters of correction state, if built with AUTOCORR_STATS
+ * AUTOCORR_cache_* - bounded cache of corrections shared between threads
+ * build_trie - builds compact depth-first trie from sorted word data
+ * segment_word - split run-together words by most probable sequence of dictionary words
+ * AUTOCORR_compile_bigrams - compile bigram model of confusable words from counts of word pairs
+ * AUTOCORR_bigrams_* - bigram context model telling which word of a confusion set is meant
  *
  * Based on probability theory from http://norvig.com/spell-correct.html
  *
@@ -18,422 +39,4586 @@
  *
  */
 
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "autocorrect.h"
+
+// Word frequnecy data file
+#define WORD_DATA "../autocorrect-lib/data-files/word_data.txt"
+
+// Precompiled binary image of word frequency data
+#define WORD_IMAGE "../autocorrect-lib/data-files/word_data.bin"
+
+// Append-only log of words learned since word data file was written, replayed on load
+#define WORD_LOG "../autocorrect-lib/data-files/word_data.log"
+
+// Delta log being merged into word data file, kept until merge is complete
+#define WORD_LOG_COMPACTING "../autocorrect-lib/data-files/word_data.log.compacting"
+
+// Default size of delta log past which learning merges it into word data file
+// Until then every load that replays new words rebuilds word table and trie, even from image
+#define LOG_COMPACT_BYTES (1 << 20)
+
+// Longest line of delta log: frequency, space, word and newline
+#define LOG_LINE_MAX (AUTOCORR_LENGTH_MAX + 16)
+
+// Binary image identification and layout version
+#define IMAGE_MAGIC "AUTOCORR"
+#define IMAGE_VERSION 2
+
+// Bigram context model of commonly confused words, built by spellcheck-build --bigrams
+#define BIGRAM_DATA "../autocorrect-lib/data-files/bigram_data.bin"
+
+// Bigram model identification and layout version
+#define BIGRAM_MAGIC "AUTOCBIG"
+#define BIGRAM_VERSION 1
+
+// Most words of confusion sets, parsed or held by a bigram model
+#define CONFUSABLES_MAX 128
+
+// Confusable words are shorter than this, so their lengths fit a 64-bit mask
+#define CONFUSABLE_LENGTH_MAX 64
+
+// Slots of hash tables of confusable words, a power of two
+#define BIGRAM_TABLE_BITS 9
+
+// Bigram counts are stored as base 2 logarithms in 1/BIGRAM_STEPS units, one byte each
+#define BIGRAM_STEPS 8
+
+// Context must make another word of set this much more probable (in 1/LOG_SCALE units)
+// before a correctly spelled word is reported
+#define BIGRAM_MARGIN (4 * LOG_SCALE)
+
+// Empty slot of neighbor table of bigram model
+#define NO_NEIGHBOR UINT32_MAX
+
+// Seed of image checksum (FNV-1a offset basis)
+#define CHECKSUM_SEED 2166136261u
+
+// Largest edit distance supported by deletes index
+#define DELETES_DISTANCE_MAX 3
+
+// Largest edit distance supported by trie search
+#define SEARCH_DISTANCE_MAX 3
+
+// Most deletes of one word prefix: sum of (45 choose k) for k <= 3
+#define DELETES_MAX_VARIANTS 16384
+
+// Default memory budget of deletes index
+#define DELETES_DEFAULT_BYTES ((size_t) 256 << 20)
+
+// Number of symbols in trie alphabet
+// 0-25 for lowercase a-z, 26 for apostrophe ('), 27-30 for escapes of bytes of UTF-8 characters
+#define ALPHABET_SIZE 31
+
+// Symbol of word character outside trie alphabet in trie search, equal to no symbol of trie path
+// nor to ALPHABET_SIZE, which stands for every path symbol outside window of word
+#define SYMBOL_NONE (-1)
+
+// Byte b of a character that is not ASCII takes two trie symbols: escape symbol
+// ESCAPE_SYMBOL + (b >> 5 & 3), then b & LOW_BITS below escape node
+#define ESCAPE_SYMBOL 27
+#define LOW_BITS 31
+
+// Deepest trie node, every byte of a word taking two symbols
+#define TRIE_DEPTH_MAX (2 * AUTOCORR_LENGTH_MAX)
+
+// Entries per correction cache bucket, searched on each lookup
+#define CACHE_WAYS 4
+
+// Locks guarding correction cache buckets, bucket b guarded by lock b % CACHE_STRIPES
+#define CACHE_STRIPES 64
+
+// Default memory cap of correction cache
+#define CACHE_DEFAULT_BYTES ((size_t) 16 << 20)
+
+// Number of lookups advanced together by batched word checks
+#define CHECK_LANES 8
+
+// Shortest word segmentation splits off
+#define SEGMENT_MIN_LENGTH 3
+
+// Segmentation costs are negative base 2 logarithms in units of 1/LOG_SCALE
+#define LOG_SCALE 256
+
+// Cost of unreachable segmentation position
+#define COST_INFINITE UINT32_MAX
+
+// Counts work done for statistics, compiled out unless AUTOCORR_STATS
+#if AUTOCORR_STATS
+#define COUNT(counter, amount) ((counter) += (amount))
+#else
+#define COUNT(counter, amount) ((void) 0)
+#endif
+
+// Initial capacity of word entries while loading
+#define INIT_WORDS 4096
+
+// Frequency of word suppressed by overlay, hiding it in dicts below
+#define FREQUENCY_SUPPRESSED (-1)
+
+// Number of most frequent words loaded at once by tiered load, if not given
+#define CORE_WORDS_DEFAULT 20000
+
+// Size of arena chunks mapped from the operating system
+#define ARENA_CHUNK (1 << 20)
+
+// Alignment of arena allocations
+#define ARENA_ALIGN 16
+
+// Space reserved for chunk header at start of each arena chunk
+#define ARENA_HEADER ((sizeof (arena_chunk) + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1))
+
+/**
+ * Compact trie node (12 bytes instead of 27 pointers + frequency)
+ * Children of a node are stored contiguously in the node array in symbol order.
+ * Child with symbol s is at first_child + number of set bits below s in children.
+ */
+typedef struct node
+{
+    // Frequency of word ending at this node, 0 if node is only a prefix
+    int frequency;
+
+    // Bit s set if node has a child for symbol s
+    uint32_t children;
+
+    // Index of first child in node array
+    uint32_t first_child;
+} node;
+
+/**
+ * Header of binary word data image, followed directly by node array, word offsets,
+ * word frequencies and word text (padded to 4 bytes), in that order.
+ * Image holds only 32-bit indices and offsets, so it can be mapped at any address.
+ */
+typedef struct image_header
+{
+    char magic[8];
+    uint32_t version;
+
+    // Size of node in bytes, guards against layout changes
+    uint32_t node_size;
+
+    uint32_t number_words;
+    uint32_t number_nodes;
+
+    // Size of word text in bytes, including terminators
+    uint32_t text_size;
+
+    // Checksum of everything following header
+    uint32_t checksum;
+} image_header;
+
+// Word read from word data file while loading
+typedef struct entry
+{
+    const char* word;
+    int frequency;
+} entry;
+
+// Trie node waiting to be built with its range of words
+// Escape node of bytes at depth that are not ASCII, if escape is set
+typedef struct build_range
+{
+    uint32_t index;
+    int lo, hi, depth;
+    bool escape;
+} build_range;
+
+// Chunk of arena memory, header placed at start of its own mapping
+typedef struct arena_chunk
+{
+    struct arena_chunk* prev;
+    size_t size;
+    size_t used;
+} arena_chunk;
+
+/**
+ * Arena allocator handing out memory from large mmap'd chunks.
+ * Individual allocations are never freed; whole arena is released at once.
+ */
+typedef struct arena
+{
+    arena_chunk* head;
+} arena;
+
+// Word table and trie prepared while learning words, before they replace those of dict
+typedef struct word_table
+{
+    arena data_arena;
+    node* nodes;
+    uint32_t number_nodes;
+    int number_words;
+    char* text;
+    uint32_t* offsets;
+    int* frequencies;
+    uint32_t text_size;
+} word_table;
+
+/**
+ * Symmetric-delete index item: hash of string obtained by deleting characters
+ * from a word prefix, and id of that word.
+ */
+typedef struct delete_item
+{
+    uint32_t hash;
+    uint32_t word_id;
+} delete_item;
+
+/**
+ * Full tier of word data being loaded in background, below core tier of most frequent words.
+ * Full tier is published once: ready is set (with release ordering) after full, under lock,
+ * so readers seeing ready need no lock.
+ */
+typedef struct dict_tier
+{
+    // Dict of all words, NULL until loaded, or if loading failed
+    AUTOCORR_dict* full;
+    bool ready;
+
+    pthread_t loader;
+    pthread_mutex_t lock;
+    pthread_cond_t loaded;
+} dict_tier;
+
+/**
+ * Loaded word frequency data.
+ * Not changed once loaded and indexed, so one dictionary can be shared by many threads.
+ */
+struct AUTOCORR_dict
+{
+    // Trie holding word data and frequencies in memory, root at index 0
+    // Nodes laid out in depth-first order in a single arena block or mapped image
+    const node* nodes;
+    uint32_t number_nodes;
+
+    // For number of unique words stored in the word frequency data loaded
+    // Gives size of word frequnecy data
+    int number_words;
+
+    // Word table in alphabetical order, word id is index into table
+    // Word id w is the NUL-terminated string word_text + word_offsets[w]
+    const char* word_text;
+    const uint32_t* word_offsets;
+    const int* word_frequencies;
+    uint32_t word_text_size;
+
+    // Words learned after load are appended to word table, only first sorted_words ids
+    // are in alphabetical order
+    int sorted_words;
+
+    // Base 2 logarithm of total frequency of all words (in 1/LOG_SCALE units),
+    // unigram probability of word being its frequency relative to total
+    uint32_t log_total;
+
+    // Symmetric-delete index: maps hashes of strings obtained by deleting up to
+    // deletes_distance characters from first deletes_prefix characters of each word
+    // to ids of those words. Buckets are stored contiguously (compressed rows).
+    const uint32_t* deletes_buckets;
+    const delete_item* deletes_items;
+    uint32_t deletes_mask;
+    int deletes_distance;
+    int deletes_prefix;
+
+    // Memory budget of deletes index, kept to rebuild it once words are learned
+    size_t deletes_bytes;
+
+    // Arena owning trie and word table built from word data file
+    arena data_arena;
+
+    // Arena owning deletes index
+    arena deletes_arena;
+
+    // Private mapping of binary image, if trie was loaded from one
+    // Made writable only once frequencies of its words are learned
+    void* image_map;
+    size_t image_size;
+    bool image_writable;
+
+    // Dict below this overlay, consulted for words overlay does not hold, NULL if not an overlay
+    // Not owned by overlay
+    const AUTOCORR_dict* base;
+
+    // Words overlay adds to dicts below less words it suppresses in them
+    int layered_words;
+
+    // Full tier loading in background if dict holds only core tier of tiered load, else NULL
+    // Owned by dict
+    dict_tier* tier;
+
+    // Size of delta log past which learning merges it into word data file, 0 for LOG_COMPACT_BYTES
+    size_t log_limit;
+};
+
+/**
+ * Header of bigram model, followed directly by bigram words, neighbor word ids and quantized
+ * pair counts (padded to 4 bytes), in that order.
+ * Word ids are those of word data the model was built with, told by its number and hash of words.
+ */
+typedef struct bigram_header
+{
+    char magic[8];
+    uint32_t version;
+
+    // Number of words of word data and hash of their text, in alphabetical order
+    uint32_t dict_words;
+    uint32_t dict_hash;
+
+    uint32_t number_words;
+    uint32_t number_neighbors;
+
+    // Checksum of everything following header
+    uint32_t checksum;
+} bigram_header;
+
+/**
+ * Confusable word of bigram model with its neighbors in word data: words seen before it (left)
+ * and after it (right), each list sorted by word id.
+ * Words of one confusion set are stored together.
+ */
+typedef struct bigram_word
+{
+    uint32_t word_id;
+    uint32_t set;
+    uint32_t left;
+    uint32_t left_count;
+    uint32_t right;
+    uint32_t right_count;
+} bigram_word;
+
+// Word of confusion set
+typedef struct confusable
+{
+    char word[CONFUSABLE_LENGTH_MAX];
+    int length;
+    int set;
+} confusable;
+
+// Pair of words counted in corpus, seen as neighbor of list (bigram word * 2, + 1 for right side)
+typedef struct bigram_pair
+{
+    uint32_t list;
+    uint32_t neighbor;
+    uint64_t count;
+} bigram_pair;
+
+/**
+ * Loaded bigram model, mapped in place, with text of its words to find them by.
+ * Not changed once loaded, so one model can be shared by many threads.
+ */
+struct AUTOCORR_bigrams
+{
+    const AUTOCORR_dict* dict;
+
+    const bigram_word* words;
+    int number_words;
+    const uint32_t* neighbors;
+    const uint8_t* counts;
+
+    // Text and length of each word, and bit l of lengths[c] set if a word of length l starts with letter c
+    const char* text[CONFUSABLES_MAX];
+    int length[CONFUSABLES_MAX];
+    uint64_t lengths[26];
+
+    // Hash table of words by word_key, index + 1 of word, 0 if slot is empty, as for confusable words
+    uint8_t word_table[1 << BIGRAM_TABLE_BITS];
+
+    // Hash table of ids of words in neighbor lists by hash of their text, NO_NEIGHBOR if slot is empty
+    // Finds neighbors in text without searching word table
+    uint32_t* neighbor_table;
+    uint32_t neighbor_mask;
+
+    void* map;
+    size_t map_size;
+};
+
+// Word next to confusable word in text, id -1 if not in neighbor lists of bigram model
+typedef struct neighbor
+{
+    int id;
+
+    // Logarithm of frequency of word (in 1/LOG_SCALE units)
+    int64_t log_frequency;
+} neighbor;
+
+/**
+ * Candidate suggestion kept while collecting suggestions, turned into a string only at end.
+ * Id is trie node index of word when searching trie, word id when probing deletes index.
+ */
+typedef struct candidate
+{
+    int frequency;
+    int distance;
+    uint32_t id;
+
+    // Layer of dict holding candidate, counted from top of overlays, 0 for dict itself
+    int layer;
+} candidate;
+
+/**
+ * State of bounded edit distance search over trie.
+ * Row d holds distances between trie path of length d and each prefix of word.
+ */
+typedef struct search_state
+{
+    const node* nodes;
+
+    // Top of overlays searched, layer whose trie nodes are being searched and its number from top
+    const AUTOCORR_dict* top;
+    const AUTOCORR_dict* layer;
+    int layer_number;
+
+    // Work counters of correction state
+    AUTOCORR_stats* stats;
+
+    // Misspelled word as trie symbols
+    int word[AUTOCORR_LENGTH_MAX + 1];
+    int word_len;
+
+    // Symbols of current trie path
+    int path[AUTOCORR_LENGTH_MAX + SEARCH_DISTANCE_MAX + 1];
+
+    // Distance rows for each depth of trie path
+    int rows[AUTOCORR_LENGTH_MAX + SEARCH_DISTANCE_MAX + 2][AUTOCORR_LENGTH_MAX + 2];
+
+    // Best candidate so far
+    int best_distance;
+    int best_prob;
+    char* best;
+
+    // Heap of best heap_k candidates collected for suggestions, worst on top, NULL when correcting
+    candidate* heap;
+    int heap_size;
+    int heap_k;
+} search_state;
+
+/**
+ * Cached correction of misspelled word.
+ * Mode identifies correction settings (search or index edit distance), 0 if entry is empty.
+ * Empty correction means no suggestion was found.
+ */
+typedef struct cache_entry
+{
+    uint32_t hash;
+    uint8_t mode;
+
+    // Set when entry is used, cleared as eviction hand passes it
+    uint8_t referenced;
+
+    char word[AUTOCORR_LENGTH_MAX + 1];
+    char correction[AUTOCORR_CORRECTION_MAX];
+} cache_entry;
+
+// Lock and counters of group of correction cache buckets
+typedef struct cache_stripe
+{
+    pthread_mutex_t lock;
+    unsigned long hits;
+    unsigned long misses;
+} cache_stripe;
+
+/**
+ * Correction cache: open-addressing hash table of CACHE_WAYS-entry buckets.
+ * Full buckets evict entries not used since eviction hand last passed them (clock).
+ */
+struct AUTOCORR_cache
+{
+    cache_entry* entries;
+    uint8_t* hands;
+    uint32_t mask;
+    cache_stripe stripes[CACHE_STRIPES];
+};
+
+// Lookup of one word in progress in batched word checks
+typedef struct lookup
+{
+    const node* at;
+    const char* word;
+    int position;
+    int length;
+    int slot;
+} lookup;
+
+/**
+ * Correction state of one thread: settings and scratch space of correction searches.
+ */
+struct AUTOCORR_ctx
+{
+    const AUTOCORR_dict* dict;
+
+    // Maximum edit distance of corrections found by trie search
+    int search_distance;
+
+    // Cache of corrections, possibly shared with other threads, NULL if not used
+    AUTOCORR_cache* cache;
+
+    // Work done by checks and corrections using this state
+    AUTOCORR_stats stats;
+
+    search_state search;
+
+    // Hashes of deletes of misspelled word
+    uint32_t hashes[DELETES_MAX_VARIANTS];
+
+    // Correction being built
+    char correction[AUTOCORR_CORRECTION_MAX];
+
+    // Candidates of suggestions being collected
+    candidate candidates[AUTOCORR_SUGGEST_MAX];
+};
+
+// Word data and correction state behind single-threaded AUTOCORR_* functions
+static AUTOCORR_dict* default_dict = NULL;
+static AUTOCORR_ctx* default_ctx = NULL;
+static AUTOCORR_cache* default_cache = NULL;
+static int default_distance = 1;
+
+// Correct replacement for incorrect word
+static char word_cor[AUTOCORR_CORRECTION_MAX];
+
+// Sets of commonly confused words, each word in one set
+// Very frequent words (to, too, of, off, no, know) are left out, their pairs being too noisy
+static const char* const confusion_sets[] =
+{
+    "their there they're",
+    "your you're",
+    "its it's",
+    "whose who's",
+    "then than",
+    "lose loose",
+    "affect effect",
+    "accept except",
+    "were where",
+    "weather whether",
+    "quite quiet",
+    "piece peace",
+    "advice advise",
+    "passed past",
+    "principal principle",
+    "break brake",
+    "hear here",
+    "led lead",
+    "breath breathe",
+    "choose chose",
+    "desert dessert",
+    "compliment complement",
+    "stationary stationery",
+    "later latter",
+    "weak week",
+    "threw through",
+    "allowed aloud",
+    "course coarse",
+    "council counsel",
+    "cite site sight",
+    "bare bear",
+    "right write",
+    "personal personnel",
+    "moral morale",
+    "lightning lightening",
+};
+
+// Words of confusion sets, parsed once, and hash table of their indices + 1 by word_key
+static confusable confusables[CONFUSABLES_MAX];
+static int number_confusables = 0;
+static uint64_t confusable_lengths[26];
+static uint8_t confusable_table[1 << BIGRAM_TABLE_BITS];
+static pthread_once_t confusables_parsed = PTHREAD_ONCE_INIT;
+
+
+// Forward declaration of segmentation function
+// Segmentation into multiple words ("maximumtime" to "maximum time")
+static void segment_word (AUTOCORR_ctx* ctx, const char* word, char* word_cor);
+
+/**
+ *
+ * Gives trie symbol for character.
+ * Returns 0-25 for letters, 26 for apostrophe, -1 for any other character.
+ *
+ */
+static inline int symbol_index (char c)
+{
+    // Handle ' as a special character
+    if (c == '\'')
+        return 26;
+
+    // Handle letters of the alphabet, as isalpha in C locale, without calls or branches on case
+    // Neglect character case
+    unsigned int letter = ((unsigned char) c | 0x20) - 'a';
+    if (letter < 26)
+        return letter;
+
+    return -1;
+}
+
+/**
+ *
+ * Gives trie symbol below node for byte c of folded word.
+ * Returns symbol of character for ASCII, escape symbol of byte for any other byte,
+ * its low bits LOW_BITS & c following below escape node. Returns -1 for characters outside alphabet.
+ *
+ */
+static inline int byte_symbol (unsigned char c)
+{
+    if (c >= 0x80)
+        return ESCAPE_SYMBOL + ((c >> 5) & 3);
+
+    return symbol_index (c);
+}
+
+/**
+ *
+ * Gives character of symbol of trie search path: a-z and apostrophe for symbols of the
+ * alphabet, bytes of characters that are not ASCII for their own values (0x80 and above).
+ *
+ */
+static inline char path_char (int symbol)
+{
+    if (symbol >= 0x80)
+        return (char) symbol;
+
+    return symbol == 26 ? '\'' : 'a' + symbol;
+}
+
+/**
+ *
+ * Decodes UTF-8 character of at most size bytes at text into *code.
+ * Overlong forms, surrogates and code points past U+10FFFF are invalid.
+ * Returns length of character in bytes, 0 if it is invalid or cut off.
+ *
+ */
+static int decode_utf8 (const unsigned char* text, size_t size, uint32_t* code)
+{
+    int length;
+    uint32_t c = text[0];
+
+    if (c < 0x80)
+        length = 1;
+    else if (c >= 0xC2 && c <= 0xDF)
+        length = 2, c &= 0x1F;
+    else if (c >= 0xE0 && c <= 0xEF)
+        length = 3, c &= 0x0F;
+    else if (c >= 0xF0 && c <= 0xF4)
+        length = 4, c &= 0x07;
+    else
+        return 0;
+
+    if ((size_t) length > size)
+        return 0;
+
+    for (int i = 1; i < length; i++)
+    {
+        if ((text[i] & 0xC0) != 0x80)
+            return 0;
+        c = (c << 6) | (text[i] & 0x3F);
+    }
+
+    if ((length == 3 && c < 0x800) || (length == 4 && (c < 0x10000 || c > 0x10FFFF)) || (c >= 0xD800 && c <= 0xDFFF))
+        return 0;
+
+    *code = c;
+    return length;
+}
+
+/**
+ *
+ * Gives lowercase of code point c by simple Unicode case folding, covering Latin (with
+ * Latin-1 Supplement, Latin Extended-A, regular pairs of Extended-B and Extended Additional),
+ * Greek, Cyrillic and Armenian letters. Other code points fold to themselves.
+ *
+ */
+static uint32_t fold_code (uint32_t c)
+{
+    // Latin-1 Supplement, except multiplication sign; micro sign is Greek mu
+    if (c >= 0xC0 && c <= 0xDE)
+        return c == 0xD7 ? c : c + 0x20;
+    if (c == 0xB5)
+        return 0x3BC;
+
+    // Latin Extended-A: uppercase at even code points, odd ones in two runs, with few exceptions
+    if (c >= 0x100 && c <= 0x17F)
+    {
+        if (c == 0x130 || c == 0x131 || c == 0x138 || c == 0x149)
+            return c;
+        if (c == 0x178)
+            return 0xFF;
+        if (c == 0x17F)
+            return 's';
+        if ((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+            return c + (c & 1);
+        return c | 1;
+    }
+
+    // Latin Extended-B: digraphs and regular runs of pairs
+    if (c == 0x1C4 || c == 0x1C5 || c == 0x1C7 || c == 0x1C8 || c == 0x1CA || c == 0x1CB || c == 0x1F1 || c == 0x1F2)
+        return c + ((c == 0x1C4 || c == 0x1C7 || c == 0x1CA || c == 0x1F1) ? 2 : 1);
+    if (c >= 0x1CD && c <= 0x1DC)
+        return c + (c & 1);
+    if ((c >= 0x1DE && c <= 0x1EF) || (c >= 0x1F8 && c <= 0x21F) || (c >= 0x222 && c <= 0x233) ||
+        (c >= 0x246 && c <= 0x24F))
+        return c | 1;
+
+    // Greek, final sigma folding to sigma
+    if (c >= 0x391 && c <= 0x3AB && c != 0x3A2)
+        return c + 0x20;
+    if (c == 0x386)
+        return 0x3AC;
+    if (c >= 0x388 && c <= 0x38A)
+        return c + 0x25;
+    if (c == 0x38C)
+        return 0x3CC;
+    if (c == 0x38E || c == 0x38F)
+        return c + 0x3F;
+    if (c == 0x3C2)
+        return 0x3C3;
+    if (c >= 0x3D8 && c <= 0x3EF)
+        return c | 1;
+
+    // Cyrillic
+    if (c >= 0x400 && c <= 0x40F)
+        return c + 0x50;
+    if (c >= 0x410 && c <= 0x42F)
+        return c + 0x20;
+    if ((c >= 0x460 && c <= 0x481) || (c >= 0x48A && c <= 0x4BF) || (c >= 0x4D0 && c <= 0x52F))
+        return c | 1;
+    if (c == 0x4C0)
+        return 0x4CF;
+    if (c >= 0x4C1 && c <= 0x4CE)
+        return c + (c & 1);
+
+    // Armenian
+    if (c >= 0x531 && c <= 0x556)
+        return c + 0x30;
+
+    // Latin Extended Additional, capital sharp s folding to sharp s
+    if ((c >= 0x1E00 && c <= 0x1E95) || (c >= 0x1EA0 && c <= 0x1EFF))
+        return c | 1;
+    if (c == 0x1E9E)
+        return 0xDF;
+
+    return c;
+}
+
+/**
+ *
+ * Folds first length bytes of UTF-8 word into folded, as words are stored in dict.
+ * ASCII is only lowercased, so words of English text cost one comparison per byte more.
+ *
+ */
+int AUTOCORR_fold_word (const char* word, size_t length, char* folded, size_t folded_size)
+{
+    const unsigned char* text = (const unsigned char*) word;
+    size_t out = 0;
+
+    for (size_t i = 0; i < length; )
+    {
+        // Lowercase ASCII letters, keeping any other ASCII character
+        if (text[i] < 0x80)
+        {
+            if (out + 1 >= folded_size)
+                return -1;
+
+            folded[out++] = ((unsigned) (text[i] - 'A') < 26) ? text[i] | 0x20 : text[i];
+            i++;
+            continue;
+        }
+
+        uint32_t code;
+        int n = decode_utf8 (text + i, length - i, &code);
+        if (n == 0)
+            return -1;
+        i += n;
+
+        // Typographic apostrophes
+        if (code == 0x2018 || code == 0x2019 || code == 0x2BC || code == 0xFF07)
+            code = '\'';
+        else
+            code = fold_code (code);
+
+        // Encode folded character
+        int bytes = code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+        if (out + bytes >= folded_size)
+            return -1;
+
+        if (bytes == 1)
+            folded[out++] = code;
+        else
+        {
+            static const unsigned char lead[5] = { 0, 0, 0xC0, 0xE0, 0xF0 };
+            for (int k = bytes - 1; k > 0; k--)
+                folded[out + k] = 0x80 | (code & 0x3F), code >>= 6;
+            folded[out] = lead[bytes] | code;
+            out += bytes;
+        }
+    }
+
+    folded[out] = '\0';
+    return out;
+}
+
+/**
+ *
+ * Folds rest of word of length bytes, from its first character that is not ASCII, into folded
+ * (AUTOCORR_LENGTH_MAX + 1 bytes) for lookup. Terminal apostrophe is dropped, as for ASCII words.
+ * Returns length of folded rest, -1 if it is not valid UTF-8 or does not fit.
+ *
+ */
+static int fold_rest (const char* rest, int length, char* folded)
+{
+    int folded_len = AUTOCORR_fold_word (rest, length, folded, AUTOCORR_LENGTH_MAX + 1);
+    if (folded_len > 0 && folded[folded_len - 1] == '\'')
+        folded_len--;
+
+    return folded_len;
+}
+
+/**
+ *
+ * Counts set bits of 32-bit value.
+ * Portable bit-twiddling version avoids library call when popcnt instruction is not enabled.
+ *
+ */
+static inline uint32_t count_bits (uint32_t v)
+{
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    return (((v + (v >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+/**
+ *
+ * Gives approximate base 2 logarithm of v > 0 in units of 1/LOG_SCALE.
+ * Linear between powers of two, within 0.09 of exact logarithm.
+ *
+ */
+static inline uint32_t log2_scaled (uint64_t v)
+{
+    // Bring v into [LOG_SCALE, 2 * LOG_SCALE), counting halvings
+    int e = 0;
+    for (; v >= 2 * LOG_SCALE; v >>= 1)
+        e++;
+    for (; v < LOG_SCALE; v <<= 1)
+        e--;
+
+    return (e + 8) * LOG_SCALE + (v - LOG_SCALE);
+}
+
+/**
+ *
+ * Gives child of trie node n in nodes for symbol index.
+ * Returns NULL if there is no such child.
+ *
+ */
+static inline const node* child_node (const node* nodes, const node* n, int index)
+{
+    uint32_t bit = (uint32_t) 1 << index;
+
+    if (!(n -> children & bit))
+        return NULL;
+
+    return &nodes[n -> first_child + count_bits (n -> children & (bit - 1))];
+}
+
+/**
+ *
+ * Gives child of trie node n in nodes for byte c of folded word, a letter or apostrophe, or a
+ * byte of a character that is not ASCII, found below its escape node.
+ * Returns NULL if there is no such child.
+ *
+ */
+static inline const node* byte_child (const node* nodes, const node* n, unsigned char c)
+{
+    if ((n = child_node (nodes, n, byte_symbol (c))) == NULL || c < 0x80)
+        return n;
+
+    return child_node (nodes, n, c & LOW_BITS);
+}
+
+/**
+ *
+ * Checks if word is present in dictionary trie.
+ * Returns word frequency if word is in present in trie, else returns -1.
+ *
+ */
+int AUTOCORR_dict_check (const AUTOCORR_dict* dict, const char* word)
+{
+    return AUTOCORR_dict_check_span (dict, word, strlen (word));
+}
+
+/**
+ *
+ * Looks up first length characters of word in one layer of dict, trie of nodes.
+ * Returns frequency of word's node (FREQUENCY_SUPPRESSED if overlay suppresses word),
+ * 0 if layer does not hold word.
+ *
+ */
+static int layer_check_span (const node* nodes, const char* word, size_t length)
+{
+    int word_len = length;
+    const node* tmp = nodes;
+
+    // Ignore terminal single quote character as part of word during spellcheck
+    if (word[word_len - 1] == '\'')
+        word_len--;
+
+    char folded[AUTOCORR_LENGTH_MAX + 1];
+    for (int i = 0; i < word_len; i++)
+    {
+        unsigned char c = word[i];
+
+        // Rest of word is read folded from its first character that is not ASCII
+        if (c >= 0x80 && word != folded)
+        {
+            if ((word_len = fold_rest (word + i, word_len - i, folded)) < 0)
+                return 0;
+
+            word = folded;
+            i = -1;
+            continue;
+        }
+
+        int index = byte_symbol (c);
+
+        // Handle error cases
+        if (index < 0)
+            continue;
+
+        // Check for character in trie, bytes that are not ASCII below their escape node
+        if ((tmp = child_node (nodes, tmp, index)) == NULL ||
+            (c >= 0x80 && (tmp = child_node (nodes, tmp, c & LOW_BITS)) == NULL))
+            return 0;
+    }
+
+    // Frequency is 0 if word is just a prefix of a dictionary word
+    return tmp -> frequency;
+}
+
+/**
+ *
+ * Gives dict holding all words of dict without waiting: dict itself, or full tier of tiered
+ * dict once loaded (core tier if loading failed). Returns NULL while full tier is being loaded.
+ *
+ */
+static const AUTOCORR_dict* loaded_tier (const AUTOCORR_dict* dict)
+{
+    if (dict -> tier == NULL)
+        return dict;
+    if (!__atomic_load_n (&dict -> tier -> ready, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    return dict -> tier -> full != NULL ? dict -> tier -> full : dict;
+}
+
+/**
+ *
+ * Gives dict whose trie and word table answer for layer dict: dict itself, or full tier of
+ * tiered dict, waiting until it is loaded (core tier if loading failed).
+ *
+ */
+static const AUTOCORR_dict* layer_dict (const AUTOCORR_dict* dict)
+{
+    const AUTOCORR_dict* loaded = loaded_tier (dict);
+    if (loaded != NULL)
+        return loaded;
+
+    dict_tier* tier = dict -> tier;
+    pthread_mutex_lock (&tier -> lock);
+    while (!tier -> ready)
+        pthread_cond_wait (&tier -> loaded, &tier -> lock);
+    pthread_mutex_unlock (&tier -> lock);
+
+    return tier -> full != NULL ? tier -> full : dict;
+}
+
+/**
+ *
+ * Gives dict changed in place of dict by learning and indexing: full tier of tiered dict,
+ * waiting until it is loaded, else dict itself.
+ * Returns NULL if full tier could not be loaded, so core tier is never changed.
+ *
+ */
+static AUTOCORR_dict* full_dict (AUTOCORR_dict* dict)
+{
+    if (dict == NULL || dict -> tier == NULL)
+        return dict;
+
+    layer_dict (dict);
+    return dict -> tier -> full;
+}
+
+/**
+ *
+ * Checks if first length characters of word are a word present in dictionary trie.
+ * Layers of overlays are consulted from top down, first layer holding word giving its frequency.
+ * Returns word frequency if word is in present in trie, else returns -1.
+ *
+ */
+int AUTOCORR_dict_check_span (const AUTOCORR_dict* dict, const char* word, size_t length)
+{
+    // Empty words and unloaded word data
+    if (length == 0 || dict == NULL)
+        return -1;
+
+    for (; dict != NULL; dict = dict -> base)
+    {
+        // Words core tier misses wait for full tier
+        const AUTOCORR_dict* loaded = loaded_tier (dict);
+        int frequency = layer_check_span ((loaded != NULL ? loaded : dict) -> nodes, word, length);
+        if (frequency == 0 && loaded == NULL)
+            frequency = layer_check_span (layer_dict (dict) -> nodes, word, length);
+
+        if (frequency != 0)
+            return frequency > 0 ? frequency : -1;
+    }
+
+    return -1;
+}
+
+/**
+ *
+ * Checks n words (words[i] of lens[i] characters) for presence in dictionary trie.
+ * Advances several lookups together, prefetching next node of each so that
+ * their cache misses overlap instead of each lookup waiting on its own.
+ * Words are advanced byte by byte as ASCII, until a byte that is not ASCII hands word to
+ * layer_check_span to be folded.
+ * Only trie of dict itself is searched, not dicts below an overlay.
+ * Sets freqs_out[i] to word frequency if word is present in trie, else to -1.
+ * Adds number of trie nodes visited to nodes_visited if not NULL.
+ *
+ */
+static void check_words (const AUTOCORR_dict* dict, const char** words, const int* lens, int n, int* freqs_out,
+                         unsigned long* nodes_visited)
+{
+    lookup lane[CHECK_LANES];
+    int lanes = 0, next = 0;
+    unsigned long visited = 0;
+
+    while (lanes > 0 || next < n)
+    {
+        // Start next words in idle lanes
+        while (lanes < CHECK_LANES && next < n)
+        {
+            int word_len = lens[next];
+
+            // Empty words and unloaded word data
+            if (word_len == 0 || dict == NULL)
+            {
+                freqs_out[next++] = -1;
+                continue;
+            }
+
+            // Ignore terminal single quote character as part of word during spellcheck
+            if (words[next][word_len - 1] == '\'')
+                word_len--;
+
+            lane[lanes].at = dict -> nodes;
+            lane[lanes].word = words[next];
+            lane[lanes].position = 0;
+            lane[lanes].length = word_len;
+            lane[lanes].slot = next++;
+            lanes++;
+        }
+
+        // Advance each lookup by one character
+        for (int l = 0; l < lanes; )
+        {
+            lookup* lk = &lane[l];
+
+            // Find next character in trie, skipping any others
+            int index = -1;
+            while (index < 0 && lk -> position < lk -> length)
+                index = byte_symbol (lk -> word[lk -> position++]);
+
+            // Words that are not ASCII are rare, and looked up folded on their own
+            int frequency;
+            if (index >= ESCAPE_SYMBOL)
+            {
+                frequency = layer_check_span (dict -> nodes, words[lk -> slot], lens[lk -> slot]);
+                frequency = frequency > 0 ? frequency : -1;
+            }
+
+            else if (index >= 0)
+            {
+                // Fetch child while other lanes advance
+                if ((lk -> at = child_node (dict -> nodes, lk -> at, index)) != NULL)
+                {
+                    __builtin_prefetch (lk -> at);
+                    COUNT (visited, 1);
+                    l++;
+                    continue;
+                }
+
+                frequency = -1;
+            }
+
+            // Check if word is not just a prefix of a dictionary word
+            else
+                frequency = (lk -> at -> frequency == 0) ? -1 : lk -> at -> frequency;
+
+            // Lookup finished, free its lane
+            freqs_out[lk -> slot] = frequency;
+            lane[l] = lane[--lanes];
+        }
+    }
+
+    if (nodes_visited != NULL)
+        *nodes_visited += visited;
+}
+
+/**
+ *
+ * Checks n words in dict (not an overlay), as check_words.
+ * Words are checked in core tier of tiered dict while full tier is being loaded, and only
+ * words core tier misses wait for full tier.
+ *
+ */
+static void check_tiers (const AUTOCORR_dict* dict, const char** words, const int* lens, int n, int* freqs_out,
+                         unsigned long* nodes_visited)
+{
+    const AUTOCORR_dict* loaded = loaded_tier (dict);
+    check_words (loaded != NULL ? loaded : dict, words, lens, n, freqs_out, nodes_visited);
+    if (loaded != NULL)
+        return;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (lens[i] == 0 || freqs_out[i] > 0)
+            continue;
+
+        int frequency = layer_check_span (layer_dict (dict) -> nodes, words[i], lens[i]);
+        freqs_out[i] = frequency > 0 ? frequency : -1;
+    }
+}
+
+/**
+ *
+ * Checks n words in dict and every dict below it, as check_tiers.
+ * Words are checked in batch in base dict, then looked up one by one in each overlay
+ * from bottom up, small tries of overlays staying in cache.
+ *
+ */
+static void check_layers (const AUTOCORR_dict* dict, const char** words, const int* lens, int n, int* freqs_out,
+                          unsigned long* nodes_visited)
+{
+    if (dict == NULL)
+    {
+        check_words (dict, words, lens, n, freqs_out, nodes_visited);
+        return;
+    }
+    if (dict -> base == NULL)
+    {
+        check_tiers (dict, words, lens, n, freqs_out, nodes_visited);
+        return;
+    }
+
+    check_layers (dict -> base, words, lens, n, freqs_out, nodes_visited);
+
+    // Words overlay holds take the place of those below it
+    for (int i = 0; i < n; i++)
+    {
+        int frequency = lens[i] > 0 ? layer_check_span (dict -> nodes, words[i], lens[i]) : 0;
+        if (frequency != 0)
+            freqs_out[i] = frequency > 0 ? frequency : -1;
+    }
+}
+
+/**
+ *
+ * Checks n words (words[i] of lens[i] characters) for presence in dictionary trie.
+ * Sets freqs_out[i] to word frequency if word is present in trie, else to -1.
+ *
+ */
+void AUTOCORR_dict_check_words (const AUTOCORR_dict* dict, const char** words, const int* lens, int n, int* freqs_out)
+{
+    check_layers (dict, words, lens, n, freqs_out, NULL);
+}
+
+/**
+ *
+ * Gives trie node of first length characters of normalized word, NULL if path is not in trie.
+ *
+ */
+static const node* span_node (const node* nodes, const char* word, int length)
+{
+    const node* n = nodes;
+    for (int i = 0; i < length && n != NULL; i++)
+        n = byte_symbol (word[i]) >= 0 ? byte_child (nodes, n, word[i]) : NULL;
+
+    return n;
+}
+
+/**
+ *
+ * Checks if first length characters of normalized word, found in dict layer, are added or
+ * suppressed by a layer between top and layer, hiding word of layer.
+ *
+ */
+static bool hidden_word (const AUTOCORR_dict* top, const AUTOCORR_dict* layer, const char* word, int length)
+{
+    for (; top != layer; top = top -> base)
+    {
+        const node* n = span_node (top -> nodes, word, length);
+        if (n != NULL && n -> frequency != 0)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ *
+ * Gives dict at bottom of layers of overlay dict, dict itself if it is not an overlay.
+ *
+ */
+static const AUTOCORR_dict* base_dict (const AUTOCORR_dict* dict)
+{
+    while (dict != NULL && dict -> base != NULL)
+        dict = dict -> base;
+
+    return dict;
+}
+
+/**
+ *
+ * Gives layer of dict numbered from top (dict itself being 0).
+ *
+ */
+static const AUTOCORR_dict* dict_layer (const AUTOCORR_dict* dict, int number)
+{
+    for (; number > 0; number--)
+        dict = dict -> base;
+
+    return dict;
+}
+
+/**
+ *
+ * Allocates size bytes from arena.
+ * Returns NULL if out of memory.
+ *
+ */
+static void* arena_alloc (arena* a, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+
+    arena_chunk* chunk = a -> head;
+
+    // Map new chunk, large allocations get a chunk of their own
+    if (chunk == NULL || chunk -> used + size > chunk -> size)
+    {
+        size_t chunk_size = ARENA_HEADER + size > ARENA_CHUNK ? ARENA_HEADER + size : ARENA_CHUNK;
+
+        void* map = mmap (NULL, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED)
+            return NULL;
+
+        chunk = map;
+        chunk -> prev = a -> head;
+        chunk -> size = chunk_size;
+        chunk -> used = ARENA_HEADER;
+        a -> head = chunk;
+    }
+
+    void* block = (char*) chunk + chunk -> used;
+    chunk -> used += size;
+
+    return block;
+}
+
+/**
+ *
+ * Releases all memory held by arena.
+ *
+ */
+static void arena_release (arena* a)
+{
+    while (a -> head != NULL)
+    {
+        arena_chunk* prev = a -> head -> prev;
+        munmap (a -> head, a -> head -> size);
+        a -> head = prev;
+    }
+}
+
+/**
+ *
+ * Orders load entries alphabetically by word string.
+ *
+ */
+static int compare_entries (const void* a, const void* b)
+{
+    return strcmp (((const entry*) a) -> word, ((const entry*) b) -> word);
+}
+
+/**
+ *
+ * Gives length of common prefix of two strings.
+ *
+ */
+static int common_prefix (const char* a, const char* b)
+{
+    int len = 0;
+    while (a[len] != '\0' && a[len] == b[len])
+        len++;
+    return len;
+}
+
+/**
+ *
+ * Gives number of trie nodes word adds below prefix of shared bytes it has in common with
+ * previous word prev (NULL if none): one per byte, and one per escape node of a byte that is
+ * not ASCII, unless first byte past prefix shares escape node of previous word.
+ *
+ */
+static uint32_t count_new_nodes (const char* prev, const char* word, int shared)
+{
+    uint32_t count = 0;
+    for (const unsigned char* c = (const unsigned char*) word + shared; *c != '\0'; c++)
+        count += (*c >= 0x80) ? 2 : 1;
+
+    unsigned char a = word[shared], b = (prev != NULL) ? prev[shared] : 0;
+    if (a >= 0x80 && b >= 0x80 && byte_symbol (a) == byte_symbol (b))
+        count--;
+
+    return count;
+}
+
+/**
+ *
+ * Gives symbol of child for byte c of word below node, escape node taking low bits of byte.
+ *
+ */
+static inline int child_symbol (char c, bool escape)
+{
+    return escape ? (c & LOW_BITS) : byte_symbol (c);
+}
+
+/**
+ *
+ * Builds trie for sorted unique entries into nodes, an array of exactly number_nodes nodes.
+ * Nodes are numbered in depth-first order with each child block placed right after its parent
+ * is visited, so the path of a word stays within a small span of the array.
+ * Bytes that are not ASCII are grouped by escape node, bytes of one escape node being adjacent
+ * in sorted order.
+ * Uses explicit stack of word ranges in place of recursion.
+ * Returns true if successful else false.
+ *
+ */
+static bool build_trie (node* nodes, uint32_t number_nodes, const entry* entries, int number_entries)
+{
+    // At most one pending sibling group per symbol per level
+    build_range stack[(LOW_BITS + 1) * (TRIE_DEPTH_MAX + 1)];
+    int top = 0;
+
+    // Root covers all words
+    stack[top++] = (build_range) { 0, 0, number_entries, 0, false };
+    uint32_t next = 1;
+
+    while (top > 0)
+    {
+        build_range range = stack[--top];
+        uint32_t index = range.index;
+        int lo = range.lo, hi = range.hi, depth = range.depth;
+
+        // Word equal to prefix itself sorts first
+        nodes[index].frequency = 0;
+        if (!range.escape && lo < hi && entries[lo].word[depth] == '\0')
+        {
+            nodes[index].frequency = entries[lo].frequency;
+            lo++;
+        }
+
+        // Set bits of children present in range
+        uint32_t children = 0;
+        for (int i = lo; i < hi; i++)
+            children |= (uint32_t) 1 << child_symbol (entries[i].word[depth], range.escape);
+
+        // Children numbered as one contiguous block
+        nodes[index].children = children;
+        nodes[index].first_child = next;
+
+        // Push groups of entries with same next symbol in reverse, so first child is visited first
+        for (int i = hi; i > lo; )
+        {
+            int symbol = child_symbol (entries[i - 1].word[depth], range.escape);
+
+            int j = i - 1;
+            while (j > lo && child_symbol (entries[j - 1].word[depth], range.escape) == symbol)
+                j--;
+
+            // Escape node leads on to low bits of bytes at same depth
+            bool escape = !range.escape && symbol >= ESCAPE_SYMBOL;
+            uint32_t bit = (uint32_t) 1 << symbol;
+            stack[top++] = (build_range) { next + count_bits (children & (bit - 1)), j, i, escape ? depth : depth + 1,
+                                           escape };
+
+            i = j;
+        }
+
+        next += count_bits (children);
+    }
+
+    return next == number_nodes;
+}
+
+/**
+ *
+ * Gives checksum of data (FNV-1a over 32-bit words), continuing from hash.
+ * Size must be a multiple of 4.
+ *
+ */
+static uint32_t checksum_data (uint32_t hash, const void* data, size_t size)
+{
+    const uint32_t* words = data;
+
+    for (size_t i = 0; i < size / 4; i++)
+        hash = (hash ^ words[i]) * 16777619u;
+
+    return hash;
+}
+
+/**
+ *
+ * Maps binary word data image read-only and uses its trie in place for dict.
+ * Image is not used if it is older than word data file.
+ * Returns true if successful else false.
+ *
+ */
+static bool upload_image (AUTOCORR_dict* dict, const char* path)
+{
+    int fd = open (path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat image_stat, data_stat;
+    if (fstat (fd, &image_stat) != 0 || (size_t) image_stat.st_size < sizeof (image_header) ||
+        (stat (WORD_DATA, &data_stat) == 0 && data_stat.st_mtime > image_stat.st_mtime))
+    {
+        close (fd);
+        return false;
+    }
+
+    // Private mapping, so learned frequencies can be written without changing image
+    void* map = mmap (NULL, image_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+        return false;
+
+    // Validate header, size and checksum before trusting any index
+    const image_header* header = map;
+    const node* nodes = (const node*) (header + 1);
+    size_t payload_size = (size_t) header -> number_nodes * sizeof (node) +
+                          (size_t) header -> number_words * (sizeof (uint32_t) + sizeof (int)) +
+                          ((header -> text_size + 3) & ~3u);
+
+    if (memcmp (header -> magic, IMAGE_MAGIC, sizeof (header -> magic)) != 0 ||
+        header -> version != IMAGE_VERSION || header -> node_size != sizeof (node) ||
+        header -> number_nodes == 0 || sizeof (image_header) + payload_size != (size_t) image_stat.st_size ||
+        checksum_data (CHECKSUM_SEED, nodes, payload_size) != header -> checksum)
+    {
+        munmap (map, image_stat.st_size);
+        return false;
+    }
+
+    dict -> image_map = map;
+    dict -> image_size = image_stat.st_size;
+
+    dict -> nodes = nodes;
+    dict -> number_nodes = header -> number_nodes;
+    dict -> number_words = header -> number_words;
+
+    dict -> word_offsets = (const uint32_t*) (nodes + dict -> number_nodes);
+    dict -> word_frequencies = (const int*) (dict -> word_offsets + dict -> number_words);
+    dict -> word_text = (const char*) (dict -> word_frequencies + dict -> number_words);
+    dict -> word_text_size = header -> text_size;
+
+    return true;
+}
+
+/**
+ *
+ * Writes trie and word table of dict to binary word data image at path.
+ * Image is written to a temporary file and renamed, so readers never see a partial image.
+ * Returns true if successful else false.
+ *
+ */
+static bool write_image (const AUTOCORR_dict* dict, const char* path)
+{
+    char tmp_path[4096];
+    if (snprintf (tmp_path, sizeof (tmp_path), "%s.tmp", path) >= (int) sizeof (tmp_path))
+        return false;
+
+    FILE* image_fp = fopen (tmp_path, "wb");
+    if (image_fp == NULL)
+        return false;
+
+    // Word text is padded with zeros to keep checksum over 32-bit words
+    const char padding[4] = { 0 };
+    uint32_t padding_size = ((dict -> word_text_size + 3) & ~3u) - dict -> word_text_size;
+
+    image_header header;
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, IMAGE_MAGIC, sizeof (header.magic));
+    header.version = IMAGE_VERSION;
+    header.node_size = sizeof (node);
+    header.number_words = dict -> number_words;
+    header.number_nodes = dict -> number_nodes;
+    header.text_size = dict -> word_text_size;
+
+    uint32_t checksum = checksum_data (CHECKSUM_SEED, dict -> nodes, dict -> number_nodes * sizeof (node));
+    checksum = checksum_data (checksum, dict -> word_offsets, dict -> number_words * sizeof (uint32_t));
+    checksum = checksum_data (checksum, dict -> word_frequencies, dict -> number_words * sizeof (int));
+    checksum = checksum_data (checksum, dict -> word_text, dict -> word_text_size - dict -> word_text_size % 4);
+
+    // Checksum final partial word of text including its padding
+    if (padding_size > 0)
+    {
+        char tail[4] = { 0 };
+        memcpy (tail, dict -> word_text + dict -> word_text_size - dict -> word_text_size % 4, dict -> word_text_size % 4);
+        checksum = checksum_data (checksum, tail, 4);
+    }
+    header.checksum = checksum;
+
+    bool written = fwrite (&header, sizeof (header), 1, image_fp) == 1 &&
+                   fwrite (dict -> nodes, sizeof (node), dict -> number_nodes, image_fp) == dict -> number_nodes &&
+                   fwrite (dict -> word_offsets, sizeof (uint32_t), dict -> number_words, image_fp) == (size_t) dict -> number_words &&
+                   fwrite (dict -> word_frequencies, sizeof (int), dict -> number_words, image_fp) == (size_t) dict -> number_words &&
+                   fwrite (dict -> word_text, 1, dict -> word_text_size, image_fp) == dict -> word_text_size &&
+                   fwrite (padding, 1, padding_size, image_fp) == padding_size;
+
+    if (fclose (image_fp) != 0 || !written || rename (tmp_path, path) != 0)
+    {
+        remove (tmp_path);
+        return false;
+    }
+
+    return true;
+}
+
+// Builds word table and trie of dict from words and frequencies
+static bool build_dict (AUTOCORR_dict* dict, entry* entries, int number_entries);
+
+/**
+ *
+ * Keeps letters and apostrophes of word in place, folded by AUTOCORR_fold_word, as words of word
+ * data are kept. Bytes of characters that are not ASCII are kept along with letters.
+ * Returns length of word kept, 0 if nothing is left, word is not valid UTF-8 or is too long.
+ *
+ */
+static int normalize_word (char* word)
+{
+    int word_len = 0;
+    for (int i = 0; word[i] != '\0'; i++)
+        if (byte_symbol (word[i]) >= 0)
+            word[word_len++] = word[i];
+
+    // Fold characters that are not ASCII along with case
+    char folded[AUTOCORR_LENGTH_MAX + 1];
+    if ((word_len = AUTOCORR_fold_word (word, word_len, folded, sizeof (folded))) <= 0)
+        return 0;
+
+    memcpy (word, folded, word_len + 1);
+    return word_len;
+}
+
+/**
+ *
+ * Loads first max_words words of word frequency data (all if 0) from text file into trie data
+ * structure of dict. Words of word data file are in order of decreasing frequency, so these are
+ * the most frequent ones.
+ * Returns true if successful else false.
+ *
+ */
+static bool upload_text (AUTOCORR_dict* dict, int max_words)
+{
+	FILE* word_data_fp;
+	word_data_fp = fopen (WORD_DATA, "r");
+
+	// File not opened
+    if (word_data_fp == NULL)
+        return false;
+
+    // Word strings and entries are only needed while building trie
+    arena load_arena = { NULL };
+
+  	// Prepare to read words from word data file
+    char word_str[AUTOCORR_LENGTH_MAX + 1];
+    int word_count;
+
+    int number_entries = 0, entries_cap = INIT_WORDS;
+    entry* entries = arena_alloc (&load_arena, entries_cap * sizeof (entry));
+    bool out_of_memory = (entries == NULL);
+
+    while (!out_of_memory && (max_words == 0 || number_entries < max_words) &&
+           fscanf (word_data_fp, "%d", &word_count) == 1 && fscanf (word_data_fp, "%45s", word_str) == 1)
+    {
+        // Keep folded letters and apostrophes of word
+        int word_len = normalize_word (word_str);
+        if (word_len == 0 || word_count <= 0)
+            continue;
+
+        // Grow entries, old block stays in arena until load completes
+        if (number_entries == entries_cap)
+        {
+            entry* grown = arena_alloc (&load_arena, 2 * entries_cap * sizeof (entry));
+            if ((out_of_memory = (grown == NULL)))
+                break;
+
+            memcpy (grown, entries, entries_cap * sizeof (entry));
+            entries = grown;
+            entries_cap *= 2;
+        }
+
+        char* word = arena_alloc (&load_arena, word_len + 1);
+        if ((out_of_memory = (word == NULL)))
+            break;
+        memcpy (word, word_str, word_len + 1);
+
+        entries[number_entries].word = word;
+        entries[number_entries].frequency = word_count;
+        number_entries++;
+    }
+
+    // If end of file (or last word wanted) not reached before loop termination or error indicator is set
+    if ((!feof (word_data_fp) && number_entries != max_words) || ferror (word_data_fp))
+    {
+        if (out_of_memory)
+            printf ("Out of memory. Dictionary could not be loaded.\n");
+
+        fclose (word_data_fp);
+        arena_release (&load_arena);
+        return false;
+    }
+    fclose (word_data_fp);
+
+    bool built = build_dict (dict, entries, number_entries);
+    arena_release (&load_arena);
+
+    return built;
+}
+
+/**
+ *
+ * Builds word table and trie of dict from number_entries words and frequencies, in any order.
+ * Entries are reordered.
+ * Returns true if successful else false.
+ *
+ */
+static bool build_dict (AUTOCORR_dict* dict, entry* entries, int number_entries)
+{
+    // Sort words so that words sharing a prefix are adjacent
+    qsort (entries, number_entries, sizeof (entry), compare_entries);
+
+    // Keep highest frequency (first in file) of duplicate words
+    // Count nodes: each word adds nodes for bytes past prefix shared with previous word
+    int unique = 0;
+    uint32_t number_nodes = 1;
+    for (int i = 0; i < number_entries; i++)
+    {
+        int shared = 0;
+        if (unique > 0)
+        {
+            shared = common_prefix (entries[unique - 1].word, entries[i].word);
+            if (entries[i].word[shared] == '\0' && entries[unique - 1].word[shared] == '\0')
+            {
+                if (entries[i].frequency > entries[unique - 1].frequency)
+                    entries[unique - 1].frequency = entries[i].frequency;
+                continue;
+            }
+        }
+        number_nodes += count_new_nodes (unique > 0 ? entries[unique - 1].word : NULL, entries[i].word, shared);
+        entries[unique++] = entries[i];
+    }
+
+    // Copy words into alphabetical word table
+    uint32_t text_size = 0;
+    for (int i = 0; i < unique; i++)
+        text_size += strlen (entries[i].word) + 1;
+
+    char* text = arena_alloc (&dict -> data_arena, text_size);
+    uint32_t* offsets = arena_alloc (&dict -> data_arena, unique * sizeof (uint32_t));
+    int* frequencies = arena_alloc (&dict -> data_arena, unique * sizeof (int));
+
+    if (text != NULL && offsets != NULL && frequencies != NULL)
+    {
+        uint32_t offset = 0;
+        for (int i = 0; i < unique; i++)
+        {
+            size_t size = strlen (entries[i].word) + 1;
+            memcpy (text + offset, entries[i].word, size);
+            offsets[i] = offset;
+            frequencies[i] = entries[i].frequency;
+            offset += size;
+        }
+    }
+    dict -> word_text = text;
+    dict -> word_offsets = offsets;
+    dict -> word_frequencies = frequencies;
+    dict -> word_text_size = text_size;
+
+    // Allocate trie as one block and build it
+    node* nodes = arena_alloc (&dict -> data_arena, number_nodes * sizeof (node));
+    dict -> nodes = nodes;
+    dict -> number_nodes = number_nodes;
+    if (text == NULL || offsets == NULL || frequencies == NULL || nodes == NULL ||
+        !build_trie (nodes, number_nodes, entries, unique))
+    {
+        printf ("Out of memory. Dictionary could not be loaded.\n");
+        return false;
+    }
+
+    dict -> number_words = unique; // Dictionary word count
+
+    return true;
+}
+
+/**
+ *
+ * Sets logarithm of total frequency of words of dict, scaling unigram probabilities of segmentation.
+ *
+ */
+static void update_log_total (AUTOCORR_dict* dict)
+{
+    uint64_t total = 0;
+    for (int w = 0; w < dict -> number_words; w++)
+        total += dict -> word_frequencies[w];
+
+    dict -> log_total = log2_scaled (total > 0 ? total : 1);
+}
+
+/**
+ *
+ * Gives id of word of dict, alphabetical ids by binary search and learned ones in turn.
+ * Returns -1 if word is not in word table.
+ *
+ */
+static int find_word_id (const AUTOCORR_dict* dict, const char* word)
+{
+    int lo = 0, hi = dict -> sorted_words - 1;
+    while (lo <= hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        int order = strcmp (word, dict -> word_text + dict -> word_offsets[mid]);
+        if (order == 0)
+            return mid;
+        if (order < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+
+    for (int w = dict -> sorted_words; w < dict -> number_words; w++)
+        if (strcmp (word, dict -> word_text + dict -> word_offsets[w]) == 0)
+            return w;
+
+    return -1;
+}
+
+/**
+ *
+ * Gives trie node of normalized word, NULL if word is not in trie.
+ *
+ */
+static node* find_node (const AUTOCORR_dict* dict, const char* word)
+{
+    const node* n = dict -> nodes;
+    for (int i = 0; word[i] != '\0' && n != NULL; i++)
+        n = byte_child (dict -> nodes, n, word[i]);
+
+    return (n != NULL && n -> frequency > 0) ? (node*) n : NULL;
+}
+
+/**
+ *
+ * Prepares word table of dict with n new words of entries (normalized, possibly repeated) added
+ * and frequencies of number_known words of known (all in dict) raised, into table.
+ * Word table grows by appending, so ids of words already in dict are kept,
+ * and trie is rebuilt in a new arena from all words in alphabetical order.
+ * Returns true if successful else false, dict being left unchanged either way.
+ *
+ */
+static bool prepare_words (const AUTOCORR_dict* dict, entry* entries, int n, const entry* known, int number_known,
+                           word_table* table)
+{
+    // Merge repeated new words, adding their frequencies
+    qsort (entries, n, sizeof (entry), compare_entries);
+    int added = 0;
+    uint32_t added_size = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (added > 0 && strcmp (entries[added - 1].word, entries[i].word) == 0)
+        {
+            long sum = (long) entries[added - 1].frequency + entries[i].frequency;
+            entries[added - 1].frequency = sum < INT32_MAX ? sum : INT32_MAX;
+            continue;
+        }
+        entries[added++] = entries[i];
+        added_size += strlen (entries[i].word) + 1;
+    }
+
+    int number_words = dict -> number_words + added;
+    uint32_t text_size = dict -> word_text_size + added_size;
+
+    arena data_arena = { NULL }, load_arena = { NULL };
+    char* text = arena_alloc (&data_arena, text_size);
+    uint32_t* offsets = arena_alloc (&data_arena, number_words * sizeof (uint32_t));
+    int* frequencies = arena_alloc (&data_arena, number_words * sizeof (int));
+    entry* sorted = arena_alloc (&load_arena, number_words * sizeof (entry));
+    entry* learned = arena_alloc (&load_arena, (number_words - dict -> sorted_words) * sizeof (entry));
+
+    if (text == NULL || offsets == NULL || frequencies == NULL || sorted == NULL || learned == NULL)
+    {
+        arena_release (&data_arena);
+        arena_release (&load_arena);
+        return false;
+    }
+
+    // Keep word table, appending new words
+    memcpy (text, dict -> word_text, dict -> word_text_size);
+    memcpy (offsets, dict -> word_offsets, dict -> number_words * sizeof (uint32_t));
+    memcpy (frequencies, dict -> word_frequencies, dict -> number_words * sizeof (int));
+
+    for (int i = 0; i < number_known; i++)
+    {
+        int w = find_word_id (dict, known[i].word);
+        if (w < 0)
+            continue;
+
+        long sum = (long) frequencies[w] + known[i].frequency;
+        frequencies[w] = sum < INT32_MAX ? sum : INT32_MAX;
+    }
+
+    uint32_t offset = dict -> word_text_size;
+    for (int i = 0; i < added; i++)
+    {
+        size_t size = strlen (entries[i].word) + 1;
+        memcpy (text + offset, entries[i].word, size);
+        offsets[dict -> number_words + i] = offset;
+        frequencies[dict -> number_words + i] = entries[i].frequency;
+        offset += size;
+    }
+
+    // Words learned before and now, sorted, merged with alphabetical words
+    int number_learned = number_words - dict -> sorted_words;
+    for (int i = 0; i < number_learned; i++)
+    {
+        int w = dict -> sorted_words + i;
+        learned[i] = (entry) { text + offsets[w], frequencies[w] };
+    }
+    qsort (learned, number_learned, sizeof (entry), compare_entries);
+
+    for (int i = 0, j = 0, k = 0; k < number_words; k++)
+    {
+        if (j == number_learned || (i < dict -> sorted_words && strcmp (text + offsets[i], learned[j].word) < 0))
+        {
+            sorted[k] = (entry) { text + offsets[i], frequencies[i] };
+            i++;
+        }
+        else
+            sorted[k] = learned[j++];
+    }
+
+    // Each word adds nodes for bytes past prefix shared with previous word
+    uint32_t number_nodes = 1;
+    for (int k = 0; k < number_words; k++)
+        number_nodes += (k > 0) ? count_new_nodes (sorted[k - 1].word, sorted[k].word,
+                                                   common_prefix (sorted[k - 1].word, sorted[k].word))
+                                : count_new_nodes (NULL, sorted[k].word, 0);
+
+    node* nodes = arena_alloc (&data_arena, number_nodes * sizeof (node));
+    bool built = (nodes != NULL && build_trie (nodes, number_nodes, sorted, number_words));
+    arena_release (&load_arena);
+
+    if (!built)
+    {
+        arena_release (&data_arena);
+        return false;
+    }
+
+    *table = (word_table) { data_arena, nodes, number_nodes, number_words, text, offsets, frequencies, text_size };
+    return true;
+}
+
+/**
+ *
+ * Replaces word table and trie of dict by those of prepared table, which dict takes over.
+ * Deletes index is rebuilt to cover new words, if built.
+ *
+ */
+static void replace_words (AUTOCORR_dict* dict, word_table* table)
+{
+    // Replace word data, image no longer being used
+    arena_release (&dict -> data_arena);
+    if (dict -> image_map != NULL)
+        munmap (dict -> image_map, dict -> image_size);
+    dict -> image_map = NULL;
+    dict -> image_size = 0;
+
+    dict -> data_arena = table -> data_arena;
+    dict -> nodes = table -> nodes;
+    dict -> number_nodes = table -> number_nodes;
+    dict -> number_words = table -> number_words;
+    dict -> word_text = table -> text;
+    dict -> word_offsets = table -> offsets;
+    dict -> word_frequencies = table -> frequencies;
+    dict -> word_text_size = table -> text_size;
+
+    if (dict -> deletes_items != NULL &&
+        !AUTOCORR_dict_build_deletes_index (dict, dict -> deletes_distance, dict -> deletes_bytes))
+        printf ("Out of memory. Deletes index could not be rebuilt.\n");
+}
+
+/**
+ *
+ * Appends log_size bytes of log_text to delta log in one write, so concurrent learners do not
+ * interleave lines.
+ * Returns true if successful else false.
+ *
+ */
+static bool append_log (const char* log_text, size_t log_size)
+{
+    int fd = open (WORD_LOG, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    bool written = (fd >= 0 && write (fd, log_text, log_size) == (ssize_t) log_size);
+
+    if (fd >= 0 && close (fd) != 0)
+        written = false;
+    return written;
+}
+
+/**
+ *
+ * Adds frequencies of n normalized entries to words of dict, adding words not yet in dict.
+ * Frequencies of known words are changed in place if all words are known,
+ * else new word table and trie are prepared with all of them.
+ * Everything that can fail is done first, then log_size bytes of log_text (none if 0) are
+ * appended to delta log, and dict is changed only once they are written.
+ * Returns true if successful else false, dict and delta log being left unchanged.
+ *
+ */
+static bool learn_entries (AUTOCORR_dict* dict, entry* entries, int n, const char* log_text, size_t log_size)
+{
+    // New words first, known words after them
+    int added = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (find_node (dict, entries[i].word) != NULL)
+            continue;
+
+        entry new_word = entries[i];
+        entries[i] = entries[added];
+        entries[added++] = new_word;
+    }
+
+    // Pages of mapped image are copied as they are written
+    if (added == 0 && dict -> image_map != NULL && !dict -> image_writable)
+    {
+        if (mprotect (dict -> image_map, dict -> image_size, PROT_READ | PROT_WRITE) != 0)
+            return false;
+        dict -> image_writable = true;
+    }
+
+    // New words need a new word table and trie, which take frequencies of known words too
+    word_table table;
+    if (added > 0 && !prepare_words (dict, entries, added, entries + added, n - added, &table))
+        return false;
+
+    if (log_size > 0 && !append_log (log_text, log_size))
+    {
+        if (added > 0)
+            arena_release (&table.data_arena);
+        return false;
+    }
+
+    if (added > 0)
+        replace_words (dict, &table);
+    else
+    {
+        for (int i = 0; i < n; i++)
+        {
+            node* word_node = find_node (dict, entries[i].word);
+            long sum = (long) word_node -> frequency + entries[i].frequency;
+            word_node -> frequency = sum < INT32_MAX ? sum : INT32_MAX;
+
+            int w = find_word_id (dict, entries[i].word);
+            if (w >= 0)
+                ((int*) dict -> word_frequencies)[w] = word_node -> frequency;
+        }
+    }
+
+    update_log_total (dict);
+    return true;
+}
+
+/**
+ *
+ * Appends copy of normalized word with frequency to entries (of capacity entries_cap) in load_arena.
+ * Returns true if successful, false if out of memory.
+ *
+ */
+static bool append_entry (arena* load_arena, entry** entries, int* number_entries, int* entries_cap,
+                          const char* word_str, int frequency)
+{
+    // Grow entries, old block stays in arena until load completes
+    if (*number_entries == *entries_cap)
+    {
+        entry* grown = arena_alloc (load_arena, 2 * *entries_cap * sizeof (entry));
+        if (grown == NULL)
+            return false;
+
+        memcpy (grown, *entries, *entries_cap * sizeof (entry));
+        *entries = grown;
+        *entries_cap *= 2;
+    }
+
+    char* word = arena_alloc (load_arena, strlen (word_str) + 1);
+    if (word == NULL)
+        return false;
+    strcpy (word, word_str);
+
+    (*entries)[*number_entries].word = word;
+    (*entries)[*number_entries].frequency = frequency;
+    (*number_entries)++;
+    return true;
+}
+
+/**
+ *
+ * Replays delta log at path into dict: lines of frequency and word, as in word data file.
+ * Incomplete last line of log, as left by interrupted write, is ignored.
+ * Returns true if successful or there is no log, else false.
+ *
+ */
+static bool replay_log (AUTOCORR_dict* dict, const char* path)
+{
+    FILE* log_fp = fopen (path, "r");
+    if (log_fp == NULL)
+        return true;
+
+    arena load_arena = { NULL };
+    int number_entries = 0, entries_cap = INIT_WORDS;
+    entry* entries = arena_alloc (&load_arena, entries_cap * sizeof (entry));
+    bool out_of_memory = (entries == NULL);
+
+    char line[LOG_LINE_MAX + 2];
+    char word_str[LOG_LINE_MAX + 2];
+    int word_count;
+    while (!out_of_memory && fgets (line, sizeof (line), log_fp) != NULL)
+    {
+        if (strchr (line, '\n') == NULL || sscanf (line, "%d %s", &word_count, word_str) != 2 ||
+            word_count <= 0 || normalize_word (word_str) == 0)
+            continue;
+
+        out_of_memory = !append_entry (&load_arena, &entries, &number_entries, &entries_cap, word_str, word_count);
+    }
+    fclose (log_fp);
+
+    bool replayed = !out_of_memory && learn_entries (dict, entries, number_entries, NULL, 0);
+    arena_release (&load_arena);
+
+    if (!replayed)
+        printf ("Out of memory. Learned words could not be loaded.\n");
+    return replayed;
+}
+
+/**
+ *
+ * Gives true if file at other_path was last changed after file at path, or path is missing.
+ * Gives false if other file is missing.
+ *
+ */
+static bool older_than (const char* path, const char* other_path)
+{
+    struct stat info, other;
+    if (stat (other_path, &other) != 0)
+        return false;
+    if (stat (path, &info) != 0)
+        return true;
+
+    return info.st_mtim.tv_sec < other.st_mtim.tv_sec ||
+           (info.st_mtim.tv_sec == other.st_mtim.tv_sec && info.st_mtim.tv_nsec < other.st_mtim.tv_nsec);
+}
+
+/**
+ *
+ * Replays delta logs into dict just loaded from word data, which holds only sorted words.
+ * Log of interrupted merge is replayed unless word data file was written after it.
+ * New words of logs make word table and trie be rebuilt, so a mapped image is copied in full,
+ * on every load until logs are merged into word data file.
+ * Returns true if successful else false.
+ *
+ */
+static bool replay_logs (AUTOCORR_dict* dict)
+{
+    dict -> sorted_words = dict -> number_words;
+
+    if (!older_than (WORD_LOG_COMPACTING, WORD_DATA) && !replay_log (dict, WORD_LOG_COMPACTING))
+        return false;
+
+    return replay_log (dict, WORD_LOG);
+}
+
+/**
+ *
+ * Loads word frequency data into a new dictionary.
+ * Maps precompiled binary image if present and up to date, else parses word data file.
+ * Returns dictionary if successful else NULL.
+ *
+ */
+AUTOCORR_dict* AUTOCORR_dict_upload (void)
+{
+    AUTOCORR_dict* dict = calloc (1, sizeof (AUTOCORR_dict));
+    if (dict == NULL)
+        return NULL;
+
+    if ((upload_image (dict, WORD_IMAGE) || upload_text (dict, 0)) && replay_logs (dict))
+    {
+        update_log_total (dict);
+        return dict;
+    }
+
+    AUTOCORR_dict_unload (dict);
+    return NULL;
+}
+
+/**
+ *
+ * Loads full tier arg of tiered dict in background, publishing it to threads waiting on it.
+ *
+ */
+static void* load_full_tier (void* arg)
+{
+    dict_tier* tier = arg;
+    AUTOCORR_dict* full = AUTOCORR_dict_upload ();
+    if (full == NULL)
+        printf ("Word data could not be loaded beyond its most frequent words.\n");
+
+    pthread_mutex_lock (&tier -> lock);
+    tier -> full = full;
+    __atomic_store_n (&tier -> ready, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast (&tier -> loaded);
+    pthread_mutex_unlock (&tier -> lock);
+
+    return NULL;
+}
+
+/**
+ *
+ * Loads word frequency data into a new dictionary in two tiers: core tier of the core_words
+ * most frequent words (CORE_WORDS_DEFAULT if 0) before returning, full tier on a thread of its own.
+ * Checks use core tier until full tier is loaded, words core tier misses waiting for full tier,
+ * and corrections, learning and indexing wait for full tier.
+ * Loads whole dictionary at once, as AUTOCORR_dict_upload, if binary image is up to date (mapping
+ * it is faster than parsing any tier) or words were learned since word data file was written.
+ * Returns dictionary if successful else NULL.
+ *
+ */
+AUTOCORR_dict* AUTOCORR_dict_upload_tiered (int core_words)
+{
+    struct stat info;
+    if (stat (WORD_LOG, &info) == 0 || stat (WORD_LOG_COMPACTING, &info) == 0)
+        return AUTOCORR_dict_upload ();
+
+    AUTOCORR_dict* dict = calloc (1, sizeof (AUTOCORR_dict));
+    if (dict == NULL)
+        return NULL;
+
+    if (upload_image (dict, WORD_IMAGE) && replay_logs (dict))
+    {
+        update_log_total (dict);
+        return dict;
+    }
+
+    dict_tier* tier = calloc (1, sizeof (dict_tier));
+    if (tier == NULL || !upload_text (dict, core_words > 0 ? core_words : CORE_WORDS_DEFAULT))
+    {
+        free (tier);
+        AUTOCORR_dict_unload (dict);
+        return NULL;
+    }
+    dict -> sorted_words = dict -> number_words;
+    update_log_total (dict);
+
+    pthread_mutex_init (&tier -> lock, NULL);
+    pthread_cond_init (&tier -> loaded, NULL);
+    if (pthread_create (&tier -> loader, NULL, load_full_tier, tier) != 0)
+    {
+        pthread_mutex_destroy (&tier -> lock);
+        pthread_cond_destroy (&tier -> loaded);
+        free (tier);
+        AUTOCORR_dict_unload (dict);
+        return NULL;
+    }
+    dict -> tier = tier;
+
+    return dict;
+}
+
+/**
+ *
+ * Waits until all words of dict, or of word data below overlay dict, are loaded.
+ * Returns true if they are, false if full tier of tiered dict could not be loaded, its
+ * core tier alone answering checks.
+ *
+ */
+bool AUTOCORR_dict_wait (const AUTOCORR_dict* dict)
+{
+    if ((dict = base_dict (dict)) == NULL)
+        return false;
+
+    return dict -> tier == NULL || layer_dict (dict) != dict;
+}
+
+/**
+ *
+ * Loads overlay of words at path over base dict: lines of frequency and word (frequency 1 if
+ * left out) adding words or setting their frequencies, and lines of '-' and word suppressing words.
+ * Overlay holds a trie of its own words only, base dict is searched below it and not copied.
+ * Returns overlay if successful else NULL.
+ *
+ */
+AUTOCORR_dict* AUTOCORR_dict_overlay (const AUTOCORR_dict* base, const char* path)
+{
+    if (base == NULL || path == NULL)
+        return NULL;
+
+    FILE* overlay_fp = fopen (path, "r");
+    if (overlay_fp == NULL)
+        return NULL;
+
+    AUTOCORR_dict* dict = calloc (1, sizeof (AUTOCORR_dict));
+    arena load_arena = { NULL };
+    int number_entries = 0, entries_cap = INIT_WORDS;
+    entry* entries = arena_alloc (&load_arena, entries_cap * sizeof (entry));
+    bool out_of_memory = (dict == NULL || entries == NULL);
+
+    char line[LOG_LINE_MAX + 2];
+    char word_str[LOG_LINE_MAX + 2];
+    int word_count;
+    while (!out_of_memory && fgets (line, sizeof (line), overlay_fp) != NULL)
+    {
+        // Lines too long for any word are skipped whole, last line may lack its newline
+        if (strchr (line, '\n') == NULL && !feof (overlay_fp))
+        {
+            while (fgets (line, sizeof (line), overlay_fp) != NULL && strchr (line, '\n') == NULL)
+                ;
+            continue;
+        }
+
+        char* text = line + strspn (line, " \t");
+        if (text[0] == '-')
+        {
+            if (sscanf (text + 1, "%s", word_str) != 1)
+                continue;
+            word_count = FREQUENCY_SUPPRESSED;
+        }
+        else if (sscanf (text, "%d %s", &word_count, word_str) != 2)
+        {
+            if (sscanf (text, "%s", word_str) != 1)
+                continue;
+            word_count = 1;
+        }
+
+        if (word_count == 0 || word_count < FREQUENCY_SUPPRESSED || normalize_word (word_str) == 0)
+            continue;
+
+        out_of_memory = !append_entry (&load_arena, &entries, &number_entries, &entries_cap, word_str, word_count);
+    }
+    fclose (overlay_fp);
+
+    if (out_of_memory || !build_dict (dict, entries, number_entries))
+    {
+        if (out_of_memory)
+            printf ("Out of memory. Overlay could not be loaded.\n");
+
+        arena_release (&load_arena);
+        AUTOCORR_dict_unload (dict);
+        return NULL;
+    }
+    arena_release (&load_arena);
+
+    dict -> base = base;
+    dict -> sorted_words = dict -> number_words;
+
+    for (int w = 0; w < dict -> number_words; w++)
+    {
+        bool in_base = AUTOCORR_dict_check (base, dict -> word_text + dict -> word_offsets[w]) > 0;
+        if (dict -> word_frequencies[w] > 0 && !in_base)
+            dict -> layered_words++;
+        else if (dict -> word_frequencies[w] < 0 && in_base)
+            dict -> layered_words--;
+    }
+
+    return dict;
+}
+
+/**
+ *
+ * Loads word frequency data into trie data structure.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_upload (void)
+{
+    AUTOCORR_unload_words ();
+
+    if ((default_dict = AUTOCORR_dict_upload ()) == NULL)
+        return false;
+
+    if ((default_ctx = AUTOCORR_ctx_new (default_dict)) == NULL || (default_cache = AUTOCORR_cache_new (0)) == NULL)
+    {
+        AUTOCORR_unload_words ();
+        return false;
+    }
+    AUTOCORR_ctx_set_edit_distance (default_ctx, default_distance);
+    AUTOCORR_ctx_set_cache (default_ctx, default_cache);
+
+    return true;
+}
+
+/**
+ *
+ * Compiles word frequency data file into binary image for fast loading.
+ * Writes image to image_path, or to default image file if NULL.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_compile_data (const char* image_path)
+{
+    AUTOCORR_dict* dict = calloc (1, sizeof (AUTOCORR_dict));
+    if (dict == NULL)
+        return false;
+
+    // Always build from text, image being replaced may be stale
+    bool compiled = upload_text (dict, 0) && write_image (dict, image_path != NULL ? image_path : WORD_IMAGE);
+    AUTOCORR_dict_unload (dict);
+
+    return compiled;
+}
+
+/**
+ *
+ * Builds word table and trie of dict from n words with frequencies, kept as loading word data
+ * file would keep them.
+ * Returns true if successful else false.
+ *
+ */
+static bool build_words (AUTOCORR_dict* dict, const char** words, const int* frequencies, int n)
+{
+    entry* entries = malloc ((n + 1) * sizeof (entry));
+    if (entries == NULL)
+        return false;
+
+    // Keep words as loading word data file would
+    int number_entries = 0;
+    for (int i = 0; i < n; i++)
+    {
+        // Words must be folded letters and apostrophes already
+        char word[AUTOCORR_LENGTH_MAX + 1];
+        bool valid = (words[i][0] != '\0' && frequencies[i] > 0 && strlen (words[i]) <= AUTOCORR_LENGTH_MAX);
+        if (valid)
+        {
+            strcpy (word, words[i]);
+            valid = (normalize_word (word) > 0 && strcmp (word, words[i]) == 0);
+        }
+
+        if (valid)
+        {
+            entries[number_entries].word = words[i];
+            entries[number_entries].frequency = frequencies[i];
+            number_entries++;
+        }
+    }
+
+    bool built = build_dict (dict, entries, number_entries);
+    dict -> sorted_words = dict -> number_words;
+
+    free (entries);
+    return built;
+}
+
+/**
+ *
+ * Compiles n words with frequencies into binary image at image_path, without word data file.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_compile_words (const char** words, const int* frequencies, int n, const char* image_path)
+{
+    AUTOCORR_dict* dict = calloc (1, sizeof (AUTOCORR_dict));
+    bool compiled = (dict != NULL && build_words (dict, words, frequencies, n) && write_image (dict, image_path));
+
+    AUTOCORR_dict_unload (dict);
+    return compiled;
+}
+
+/**
+ *
+ * Orders entries pointed to by a and b by decreasing frequency, then alphabetically, for qsort.
+ *
+ */
+static int compare_frequencies (const void* a, const void* b)
+{
+    const entry* x = a;
+    const entry* y = b;
+
+    if (x -> frequency != y -> frequency)
+        return (x -> frequency > y -> frequency) ? -1 : 1;
+
+    return strcmp (x -> word, y -> word);
+}
+
+/**
+ *
+ * Writes words of dict to word data file, one line of frequency and word per word in order of
+ * decreasing frequency, as written by form_data.
+ * File is written to a temporary file and renamed, so readers never see a partial file.
+ * Returns true if successful else false.
+ *
+ */
+static bool write_word_data (const AUTOCORR_dict* dict)
+{
+    entry* entries = malloc ((dict -> number_words + 1) * sizeof (entry));
+    if (entries == NULL)
+        return false;
+
+    for (int w = 0; w < dict -> number_words; w++)
+        entries[w] = (entry) { dict -> word_text + dict -> word_offsets[w], dict -> word_frequencies[w] };
+    qsort (entries, dict -> number_words, sizeof (entry), compare_frequencies);
+
+    const char* tmp_path = WORD_DATA ".tmp";
+    FILE* word_data_fp = fopen (tmp_path, "w");
+    bool written = (word_data_fp != NULL);
+
+    for (int w = 0; w < dict -> number_words && written; w++)
+        written = fprintf (word_data_fp, "%d %s\n", entries[w].frequency, entries[w].word) > 0;
+    free (entries);
+
+    if (word_data_fp == NULL || fclose (word_data_fp) != 0 || !written || rename (tmp_path, WORD_DATA) != 0)
+    {
+        remove (tmp_path);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Appends contents of file at path to file at other_path, then removes it.
+ * Returns true if successful else false.
+ *
+ */
+static bool append_file (const char* path, const char* other_path)
+{
+    FILE* from = fopen (path, "r");
+    if (from == NULL)
+        return true;
+
+    FILE* to = fopen (other_path, "a");
+    bool appended = (to != NULL);
+
+    char buffer[4096];
+    for (size_t size; appended && (size = fread (buffer, 1, sizeof (buffer), from)) > 0; )
+        appended = fwrite (buffer, 1, size, to) == size;
+
+    appended = appended && !ferror (from);
+    fclose (from);
+    if (to != NULL && fclose (to) != 0)
+        appended = false;
+
+    return appended && remove (path) == 0;
+}
+
+/**
+ *
+ * Merges words learned by dict into word data file, emptying delta log.
+ * Delta log is first set aside, and removed only once new word data file is in place, so an
+ * interrupted merge is finished or undone on next load without counting words twice.
+ * Binary image is recompiled if there is one.
+ * Assumes no other process learns words during merge.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_dict_compact (AUTOCORR_dict* dict)
+{
+    // Overlays have no word data file of their own
+    if ((dict = full_dict (dict)) == NULL || dict -> base != NULL)
+        return false;
+
+    // Nothing learned since word data file was written
+    struct stat info;
+    bool compacting = (stat (WORD_LOG_COMPACTING, &info) == 0);
+    if (!compacting && stat (WORD_LOG, &info) != 0)
+        return true;
+
+    // Set log aside, adding it to log of interrupted merge if any (already replayed into dict)
+    if (compacting ? !append_file (WORD_LOG, WORD_LOG_COMPACTING) : rename (WORD_LOG, WORD_LOG_COMPACTING) != 0)
+        return false;
+
+    if (!write_word_data (dict))
+        return false;
+    remove (WORD_LOG_COMPACTING);
+
+    // Image older than word data file would be ignored, replace it
+    return stat (WORD_IMAGE, &info) != 0 || AUTOCORR_compile_data (NULL);
+}
+
+/**
+ *
+ * Sets size of delta log past which learning words into dict merges it into word data file,
+ * LOG_COMPACT_BYTES if max_bytes is 0.
+ *
+ */
+void AUTOCORR_dict_set_log_limit (AUTOCORR_dict* dict, size_t max_bytes)
+{
+    if (dict != NULL)
+        dict -> log_limit = max_bytes;
+}
+
+/**
+ *
+ * Adds counts[i] to frequency of words[i] in dict, for n words, adding words not in dict.
+ * Words are kept as words of word data: letters and apostrophes, folded as by AUTOCORR_fold_word,
+ * at most AUTOCORR_LENGTH_MAX long, others and counts below 1 are skipped.
+ * Changes are prepared, appended to delta log, then made, replayed by every later load, and
+ * merged into word data file once log grows past log limit of dict.
+ * Returns number of words learned, -1 if unsuccessful, dict and delta log being left unchanged.
+ *
+ */
+int AUTOCORR_dict_learn (AUTOCORR_dict* dict, const char** words, const int* counts, int n)
+{
+    size_t log_limit = (dict != NULL && dict -> log_limit > 0) ? dict -> log_limit : LOG_COMPACT_BYTES;
+    if ((dict = full_dict (dict)) == NULL || n < 0)
+        return -1;
+
+    if (dict -> base != NULL)
+    {
+        printf ("Words cannot be learned into an overlay.\n");
+        return -1;
+    }
+
+    entry* entries = malloc ((n + 1) * sizeof (entry));
+    char* text = malloc ((size_t) n * (AUTOCORR_LENGTH_MAX + 1) + 1);
+    char* log_text = malloc ((size_t) n * LOG_LINE_MAX + 1);
+    if (entries == NULL || text == NULL || log_text == NULL)
+    {
+        free (entries);
+        free (text);
+        free (log_text);
+        return -1;
+    }
+
+    // Normalize words, recording each as line of delta log
+    int number_entries = 0;
+    size_t log_size = 0;
+    for (int i = 0; i < n; i++)
+    {
+        char* word = text + (size_t) number_entries * (AUTOCORR_LENGTH_MAX + 1);
+        if (counts[i] <= 0 || strlen (words[i]) > 2 * AUTOCORR_LENGTH_MAX)
+            continue;
+
+        char word_str[2 * AUTOCORR_LENGTH_MAX + 1];
+        strcpy (word_str, words[i]);
+        if (normalize_word (word_str) == 0)
+            continue;
+
+        strcpy (word, word_str);
+        entries[number_entries++] = (entry) { word, counts[i] };
+        log_size += sprintf (log_text + log_size, "%d %s\n", counts[i], word);
+    }
+
+    // Words are logged only once all changes to dict are prepared, and dict changed only once logged
+    bool learned = true;
+    if (log_size > 0)
+    {
+        learned = learn_entries (dict, entries, number_entries, log_text, log_size);
+
+        struct stat info;
+        bool full = (learned && stat (WORD_LOG, &info) == 0 && (size_t) info.st_size > log_limit);
+        if (full && !AUTOCORR_dict_compact (dict))
+            printf ("Could not merge learned words into word data file.\n");
+    }
+
+    free (entries);
+    free (text);
+    free (log_text);
+    return learned ? number_entries : -1;
+}
+
+/**
+ *
+ * Gives true if candidate a ranks below candidate b: further away, or as close but less frequent.
+ * Ids break remaining ties, so the same candidates are kept whatever order they are found in.
+ *
+ */
+static inline bool worse_candidate (const candidate* a, const candidate* b)
+{
+    if (a -> distance != b -> distance)
+        return a -> distance > b -> distance;
+    if (a -> frequency != b -> frequency)
+        return a -> frequency < b -> frequency;
+    if (a -> id != b -> id)
+        return a -> id > b -> id;
+
+    return a -> layer > b -> layer;
+}
+
+/**
+ *
+ * Moves candidate at i of heap of size candidates down below every better candidate.
+ *
+ */
+static void sift_down (candidate* heap, int size, int i)
+{
+    candidate c = heap[i];
+
+    for (int child; (child = 2 * i + 1) < size; i = child)
+    {
+        if (child + 1 < size && worse_candidate (&heap[child + 1], &heap[child]))
+            child++;
+        if (!worse_candidate (&heap[child], &c))
+            break;
+
+        heap[i] = heap[child];
+    }
+
+    heap[i] = c;
+}
+
+/**
+ *
+ * Offers candidate c to heap of size (at most k) best candidates so far, worst candidate on top.
+ * Returns true if c is kept else false.
+ *
+ */
+static bool offer_candidate (candidate* heap, int* size, int k, candidate c)
+{
+    // Full heap keeps c only in place of its worst candidate
+    if (*size == k)
+    {
+        if (!worse_candidate (&heap[0], &c))
+            return false;
+
+        heap[0] = c;
+        sift_down (heap, k, 0);
+        return true;
+    }
+
+    // Move c up above every better candidate
+    int i = (*size)++;
+    for (; i > 0 && worse_candidate (&c, &heap[(i - 1) / 2]); i = (i - 1) / 2)
+        heap[i] = heap[(i - 1) / 2];
+    heap[i] = c;
+
+    return true;
+}
+
+/**
+ *
+ * Copies word ending at trie node index into word, finding its path down from root.
+ * Subtree of each node is numbered in one span after its own children (see build_trie),
+ * so path goes on through child with children whose span starts last at or before index.
+ *
+ */
+static void node_word (const node* nodes, uint32_t index, char* word)
+{
+    int length = 0, escape = -1;
+
+    for (const node* n = nodes; n != &nodes[index]; )
+    {
+        uint32_t first = n -> first_child, count = count_bits (n -> children), child = index;
+
+        if (index >= first + count)
+        {
+            uint32_t none = child = first + count;
+            for (uint32_t c = first; c < none; c++)
+                if (nodes[c].children != 0 && nodes[c].first_child <= index &&
+                    (child == none || nodes[c].first_child > nodes[child].first_child))
+                    child = c;
+        }
+
+        // Symbol of child is its rank among set bits of children
+        uint32_t children = n -> children;
+        for (uint32_t skip = child - first; skip > 0; skip--)
+            children &= children - 1;
+
+        // Escape symbol gives top bits of byte completed by symbol of next child
+        int symbol = __builtin_ctz (children);
+        if (escape >= 0)
+        {
+            word[length++] = 0x80 | ((escape - ESCAPE_SYMBOL) << 5) | symbol;
+            escape = -1;
+        }
+        else if (symbol >= ESCAPE_SYMBOL)
+            escape = symbol;
+        else
+            word[length++] = path_char (symbol);
+        n = &nodes[child];
+    }
+
+    word[length] = '\0';
+}
+
+/**
+ *
+ * Computes distance row for trie path of length depth extended by symbol.
+ * Only cells within band of best distance around new path length are computed,
+ * cells just outside band are set to best distance + 1 for next row to read.
+ * Returns smallest distance in row.
+ *
+ */
+static int extend_row (search_state* st, int depth, int symbol)
+{
+    const int* row = st -> rows[depth];
+    int* next = st -> rows[depth + 1];
+    int word_len = st -> word_len;
+
+    // Only prefixes of word within best distance of path length can be within best distance
+    int bound = st -> best_distance, length = depth + 1;
+    int lo = length - bound > 1 ? length - bound : 1;
+    int hi = length + bound < word_len ? length + bound : word_len;
+
+    next[0] = length;
+    if (lo > 1)
+        next[lo - 1] = bound + 1;
+    if (hi < word_len)
+        next[hi + 1] = bound + 1;
+
+    int row_min = lo == 1 ? length : bound + 1;
+    for (int j = lo; j <= hi; j++)
+    {
+        int best = row[j - 1] + (st -> word[j - 1] != symbol);
+        if (row[j] + 1 < best)
+            best = row[j] + 1;
+        if (next[j - 1] + 1 < best)
+            best = next[j - 1] + 1;
+
+        // Transposition of adjacent letters
+        if (depth > 0 && j > 1 && st -> word[j - 2] == symbol && st -> word[j - 1] == st -> path[depth - 1] &&
+            st -> rows[depth - 1][j - 2] + 1 < best)
+            best = st -> rows[depth - 1][j - 2] + 1;
+
+        next[j] = best;
+        if (best < row_min)
+            row_min = best;
+    }
+
+    return row_min;
+}
+
+/**
+ *
+ * Checks if word of trie path of length depth, in layer being searched, is hidden by a layer above.
+ *
+ */
+static bool hidden_path (const search_state* st, int depth)
+{
+    if (st -> layer == st -> top)
+        return false;
+
+    char word[AUTOCORR_LENGTH_MAX + SEARCH_DISTANCE_MAX + 1];
+    for (int i = 0; i < depth; i++)
+        word[i] = path_char (st -> path[i]);
+
+    return hidden_word (st -> top, st -> layer, word, depth);
+}
+
+// Visits bytes below escape node of search path, searching on below each
+static void search_escape (search_state* st, const node* e, int depth, int escape);
+
+/**
+ *
+ * Visits trie node n at end of path of length depth, whose distance row is already computed.
+ * Records node's word if it beats best candidate, then descends into children whose rows
+ * can still reach best distance.
+ *
+ */
+static void search_trie (search_state* st, const node* n, int depth)
+{
+    const int* row = st -> rows[depth];
+    int word_len = st -> word_len;
+
+    // Closer candidates always win, frequency breaks ties
+    // Word itself is not its own correction
+    // Row only holds distances within band of best distance around depth
+    COUNT (st -> stats -> nodes_visited, 1);
+
+    if (n -> frequency > 0 && abs (depth - word_len) <= st -> best_distance)
+    {
+        COUNT (st -> stats -> candidates_probed, 1);
+
+        int distance = row[word_len];
+        if (st -> heap != NULL)
+        {
+            // Once heap is full, only words as close as its worst candidate can still join it
+            if (distance > 0 && distance <= st -> best_distance && !hidden_path (st, depth) &&
+                offer_candidate (st -> heap, &st -> heap_size, st -> heap_k,
+                                 (candidate) { n -> frequency, distance, n - st -> nodes, st -> layer_number }) &&
+                st -> heap_size == st -> heap_k)
+                st -> best_distance = st -> heap[0].distance;
+        }
+        else if (distance > 0 && (distance < st -> best_distance ||
+                             (distance == st -> best_distance && n -> frequency > st -> best_prob)) &&
+                 !hidden_path (st, depth))
+        {
+            st -> best_distance = distance;
+            st -> best_prob = n -> frequency;
+
+            for (int i = 0; i < depth; i++)
+                st -> best[i] = path_char (st -> path[i]);
+            st -> best[depth] = '\0';
+        }
+    }
+
+    // Fetch child block while rows are computed
+    const node* block = &st -> nodes[n -> first_child];
+    for (int i = 0; i < (int) count_bits (n -> children); i += 64 / sizeof (node))
+        __builtin_prefetch (block + i);
+
+    // Symbols of word that next path symbol can be compared with inside band, escape symbols
+    // for bytes that are not ASCII
+    // Every other symbol gives the same row, computed once and shared
+    int bound = st -> best_distance, length = depth + 1;
+    uint32_t window = 0;
+    for (int j = length - bound - 1; j <= length + bound && j <= word_len; j++)
+        if (j >= 1 && st -> word[j - 1] != SYMBOL_NONE)
+            window |= (uint32_t) 1 << (st -> word[j - 1] >= 0x80 ? byte_symbol (st -> word[j - 1]) : st -> word[j - 1]);
+
+    // Row shared by symbols outside window, other children are skipped if it is out of bound
+    int other_min = extend_row (st, depth, ALPHABET_SIZE), other_bound = bound;
+    uint32_t children = n -> children;
+    if (other_min > bound)
+        children &= window;
+
+    for (; children != 0; children &= children - 1)
+    {
+        int symbol = __builtin_ctz (children);
+
+        // Children are stored in symbol order, one after another
+        uint32_t child = n -> first_child + count_bits (n -> children & (((uint32_t) 1 << symbol) - 1));
+
+        // Bytes that are not ASCII are searched below their escape node, overwriting shared row
+        if (symbol >= ESCAPE_SYMBOL)
+        {
+            search_escape (st, &st -> nodes[child], depth, symbol);
+            other_bound = -1;
+            continue;
+        }
+
+        st -> path[depth] = symbol;
+
+        int row_min;
+        if (window & ((uint32_t) 1 << symbol))
+        {
+            row_min = extend_row (st, depth, symbol);
+            other_bound = -1;
+        }
+        else
+        {
+            // Shared row is still in place unless overwritten or best distance shrank
+            if (other_bound != st -> best_distance)
+            {
+                other_min = extend_row (st, depth, ALPHABET_SIZE);
+                other_bound = st -> best_distance;
+            }
+            row_min = other_min;
+        }
+
+        // Subtree can only yield words at least row_min edits away
+        if (row_min <= st -> best_distance)
+            search_trie (st, &st -> nodes[child], depth + 1);
+    }
+}
+
+/**
+ *
+ * Visits children of escape node e below trie path of length depth, extending path by byte of
+ * each child (escape symbol and low bits of child), and searches on below those whose rows can
+ * still reach best distance. Path and rows hold whole bytes, so edits count bytes.
+ *
+ */
+static void search_escape (search_state* st, const node* e, int depth, int escape)
+{
+    COUNT (st -> stats -> nodes_visited, 1);
+
+    for (uint32_t children = e -> children; children != 0; children &= children - 1)
+    {
+        int low = __builtin_ctz (children);
+        int byte = 0x80 | ((escape - ESCAPE_SYMBOL) << 5) | low;
+        uint32_t child = e -> first_child + count_bits (e -> children & (((uint32_t) 1 << low) - 1));
+
+        st -> path[depth] = byte;
+        if (extend_row (st, depth, byte) <= st -> best_distance)
+            search_trie (st, &st -> nodes[child], depth + 1);
+    }
+}
+
+/**
+ *
+ * Prepares search state of ctx for trie search of word within edit distance.
+ * Returns true if word can be searched for else false.
+ *
+ */
+static bool start_search (AUTOCORR_ctx* ctx, const char* word, int distance)
+{
+    search_state* st = &ctx -> search;
+
+    st -> word_len = strlen (word);
+    if (st -> word_len > AUTOCORR_LENGTH_MAX)
+        return false;
+
+    // Characters outside trie alphabet match no symbol, bytes that are not ASCII match themselves
+    for (int j = 0; j < st -> word_len; j++)
+    {
+        unsigned char c = word[j];
+        int index = symbol_index (c);
+        st -> word[j] = c >= 0x80 ? c : index >= 0 ? index : SYMBOL_NONE;
+    }
+
+    // Distances between empty path and prefixes of word
+    for (int j = 0; j <= st -> word_len; j++)
+        st -> rows[0][j] = j;
+
+    st -> top = ctx -> dict;
+    st -> stats = &ctx -> stats;
+    st -> best_distance = distance;
+
+    return true;
+}
+
+/**
+ *
+ * Searches trie of each layer of dict of ctx from top down to stop (not searched, NULL for all),
+ * with search state prepared by start_search. Words hidden by a layer above are skipped.
+ *
+ */
+static void search_layers (AUTOCORR_ctx* ctx, const AUTOCORR_dict* stop)
+{
+    search_state* st = &ctx -> search;
+
+    st -> layer_number = 0;
+    for (st -> layer = ctx -> dict; st -> layer != stop; st -> layer = st -> layer -> base, st -> layer_number++)
+    {
+        st -> nodes = layer_dict (st -> layer) -> nodes;
+        search_trie (st, st -> nodes, 0);
+    }
+}
+
+/**
+ *
+ * Finds words within edit distance of word in one walk of the trie of each layer above stop,
+ * carrying a banded row of Damerau-Levenshtein distances down each path and pruning subtrees
+ * that cannot come within the distance.
+ * Copies closest candidate into word_cor, highest frequency among equally close ones.
+ * Returns frequency of chosen candidate, 0 if none found, its distance being left in search state.
+ *
+ */
+static int correct_search (AUTOCORR_ctx* ctx, const char* word, char* word_cor, int distance,
+                           const AUTOCORR_dict* stop)
+{
+    search_state* st = &ctx -> search;
+    if (!start_search (ctx, word, distance))
+        return 0;
+
+    st -> best_prob = 0;
+    st -> best = word_cor;
+    st -> heap = NULL;
+
+    search_layers (ctx, stop);
+
+    return st -> best_prob;
+}
+
+/**
+ *
+ * Collects up to k closest words within edit distance of word in one walk of the trie of each
+ * layer above stop, as correct_search, into heap of candidates of ctx.
+ * Bound of search shrinks to distance of worst candidate kept once k are found.
+ * Returns number of candidates collected.
+ *
+ */
+static int suggest_search (AUTOCORR_ctx* ctx, const char* word, int k, int distance, const AUTOCORR_dict* stop)
+{
+    search_state* st = &ctx -> search;
+    if (!start_search (ctx, word, distance))
+        return 0;
+
+    st -> best_prob = 0;
+    st -> best = NULL;
+    st -> heap = ctx -> candidates;
+    st -> heap_size = 0;
+    st -> heap_k = k;
+
+    search_layers (ctx, stop);
+
+    return st -> heap_size;
+}
+
+/**
+ *
+ * Sets maximum edit distance of corrections found by trie search of ctx.
+ * Returns true if distance is supported (1 to 3) else false.
+ *
+ */
+bool AUTOCORR_ctx_set_edit_distance (AUTOCORR_ctx* ctx, int max_distance)
+{
+    if (max_distance < 1 || max_distance > SEARCH_DISTANCE_MAX)
+        return false;
+
+    ctx -> search_distance = max_distance;
+    return true;
+}
+
+/**
+ *
+ * Sets maximum edit distance of corrections found by trie search.
+ * Returns true if distance is supported (1 to 3) else false.
+ *
+ */
+bool AUTOCORR_set_edit_distance (int max_distance)
+{
+    if (max_distance < 1 || max_distance > SEARCH_DISTANCE_MAX)
+        return false;
+
+    // Kept for correction state created on next upload
+    default_distance = max_distance;
+    if (default_ctx != NULL)
+        AUTOCORR_ctx_set_edit_distance (default_ctx, max_distance);
+
+    return true;
+}
+
+/**
+ *
+ * Gives hash of first len characters of string (FNV-1a).
+ *
+ */
+static uint32_t hash_string (const char* str, int len)
+{
+    uint32_t hash = CHECKSUM_SEED;
+
+    for (int i = 0; i < len; i++)
+        hash = (hash ^ (unsigned char) str[i]) * 16777619u;
+
+    return hash;
+}
+
+/**
+ *
+ * Adds hashes of all strings obtained by deleting up to remaining characters at or after
+ * position start of str (length len) to hashes, starting at count.
+ * Returns new number of hashes.
+ *
+ */
+static int generate_deletes (const char* str, int len, int start, int remaining, uint32_t* hashes, int count)
+{
+    char shorter[AUTOCORR_LENGTH_MAX + 2];
+
+    for (int i = start; i < len; i++)
+    {
+        // String with character at i-th index removed
+        memcpy (shorter, str, i);
+        memcpy (shorter + i, str + i + 1, len - i - 1);
+
+        hashes[count++] = hash_string (shorter, len - 1);
+
+        if (remaining > 1)
+            count = generate_deletes (shorter, len - 1, i, remaining - 1, hashes, count);
+    }
+
+    return count;
+}
+
+/**
+ *
+ * Gives binomial coefficient n choose k.
+ *
+ */
+static size_t choose (int n, int k)
+{
+    size_t result = 1;
+
+    for (int i = 1; i <= k; i++)
+        result = result * (n - k + i) / i;
+
+    return result;
+}
+
+/**
+ *
+ * Orders 32-bit hashes.
+ *
+ */
+static int compare_hashes (const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*) a, y = *(const uint32_t*) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ *
+ * Gives hashes of word and its deletes within deletes index prefix, sorted and without duplicates.
+ * Returns number of hashes.
+ *
+ */
+static int word_deletes (const char* word, int len, int prefix, int distance, uint32_t* hashes)
+{
+    if (len > prefix)
+        len = prefix;
+
+    hashes[0] = hash_string (word, len);
+    int count = generate_deletes (word, len, 0, distance, hashes, 1);
+
+    // Same string can result from deleting different characters
+    qsort (hashes, count, sizeof (uint32_t), compare_hashes);
+
+    int unique = 0;
+    for (int i = 0; i < count; i++)
+        if (unique == 0 || hashes[unique - 1] != hashes[i])
+            hashes[unique++] = hashes[i];
+
+    return unique;
+}
+
+/**
+ *
+ * Gives optimal string alignment (Damerau-Levenshtein) distance between strings a and b.
+ * Returns max + 1 as soon as distance is known to exceed max.
+ *
+ */
+static int edit_distance (const char* a, int len_a, const char* b, int len_b, int max)
+{
+    if (abs (len_a - len_b) > max)
+        return max + 1;
+
+    // Last three rows of distance matrix
+    int rows[3][AUTOCORR_LENGTH_MAX + 3];
+    int *prev2 = rows[0], *prev = rows[1], *cur = rows[2];
+
+    for (int j = 0; j <= len_b; j++)
+        prev[j] = j;
+
+    for (int i = 1; i <= len_a; i++)
+    {
+        int row_min = cur[0] = i;
+
+        for (int j = 1; j <= len_b; j++)
+        {
+            int cost = (a[i - 1] != b[j - 1]);
+
+            int best = prev[j - 1] + cost;
+            if (prev[j] + 1 < best)
+                best = prev[j] + 1;
+            if (cur[j - 1] + 1 < best)
+                best = cur[j - 1] + 1;
+
+            // Transposition of adjacent letters
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] && prev2[j - 2] + 1 < best)
+                best = prev2[j - 2] + 1;
+
+            cur[j] = best;
+            if (best < row_min)
+                row_min = best;
+        }
+
+        // No alignment can get back under bound
+        if (row_min > max)
+            return max + 1;
+
+        int* tmp = prev2;
+        prev2 = prev;
+        prev = cur;
+        cur = tmp;
+    }
+
+    return prev[len_b] <= max ? prev[len_b] : max + 1;
+}
+
+/**
+ *
+ * Builds symmetric-delete index of dict answering corrections within max_distance edits.
+ * Index must be built before dict is shared between threads.
+ * Uses longest word prefix for deletes that keeps index within max_bytes (0 for default).
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_dict_build_deletes_index (AUTOCORR_dict* dict, int max_distance, size_t max_bytes)
+{
+    // Index of base dict serves overlays above it
+    if ((dict = full_dict (dict)) == NULL || dict -> base != NULL || max_distance < 1 || max_distance > DELETES_DISTANCE_MAX)
+        return false;
+
+    if (max_bytes == 0)
+        max_bytes = DELETES_DEFAULT_BYTES;
+    dict -> deletes_bytes = max_bytes;
+
+    // Replace previous index
+    arena_release (&dict -> deletes_arena);
+    dict -> deletes_items = NULL;
+    dict -> deletes_buckets = NULL;
+
+    // Number of words of each length
+    size_t lengths[AUTOCORR_LENGTH_MAX + 1] = { 0 };
+    for (int w = 0; w < dict -> number_words; w++)
+    {
+        size_t len = strlen (dict -> word_text + dict -> word_offsets[w]);
+        lengths[len > AUTOCORR_LENGTH_MAX ? AUTOCORR_LENGTH_MAX : len]++;
+    }
+
+    // Longest prefix whose estimated index size fits memory budget
+    int prefix = 0;
+    size_t number_items = 0, number_buckets = 0;
+    for (int p = max_distance + 1; p <= AUTOCORR_LENGTH_MAX; p++)
+    {
+        size_t items = 0;
+        for (int len = 1; len <= AUTOCORR_LENGTH_MAX; len++)
+            for (int k = 0; k <= max_distance && k <= (len < p ? len : p); k++)
+                items += lengths[len] * choose (len < p ? len : p, k);
+
+        size_t buckets = 1;
+        while (buckets < items)
+            buckets *= 2;
+
+        if (items * sizeof (delete_item) + (buckets + 1) * sizeof (uint32_t) > max_bytes)
+            break;
+
+        prefix = p;
+        number_items = items;
+        number_buckets = buckets;
+    }
+
+    if (prefix == 0)
+        return false;
+
+    uint32_t* buckets = arena_alloc (&dict -> deletes_arena, (number_buckets + 1) * sizeof (uint32_t));
+    delete_item* items = arena_alloc (&dict -> deletes_arena, number_items * sizeof (delete_item));
+    if (buckets == NULL || items == NULL)
+    {
+        arena_release (&dict -> deletes_arena);
+        return false;
+    }
+    memset (buckets, 0, (number_buckets + 1) * sizeof (uint32_t));
+
+    uint32_t mask = number_buckets - 1;
+    uint32_t* hashes = malloc (DELETES_MAX_VARIANTS * sizeof (uint32_t));
+    if (hashes == NULL)
+    {
+        arena_release (&dict -> deletes_arena);
+        return false;
+    }
+
+    // Count items per bucket, stored one place ahead for prefix sum
+    for (int w = 0; w < dict -> number_words; w++)
+    {
+        const char* word = dict -> word_text + dict -> word_offsets[w];
+        int count = word_deletes (word, strlen (word), prefix, max_distance, hashes);
+
+        for (int i = 0; i < count; i++)
+            buckets[(hashes[i] & mask) + 1]++;
+    }
+
+    for (size_t b = 0; b < number_buckets; b++)
+        buckets[b + 1] += buckets[b];
+
+    // Fill buckets, advancing start of each bucket while filling
+    for (int w = 0; w < dict -> number_words; w++)
+    {
+        const char* word = dict -> word_text + dict -> word_offsets[w];
+        int count = word_deletes (word, strlen (word), prefix, max_distance, hashes);
+
+        for (int i = 0; i < count; i++)
+            items[buckets[hashes[i] & mask]++] = (delete_item) { hashes[i], w };
+    }
+
+    // Restore start of each bucket
+    for (size_t b = number_buckets; b > 0; b--)
+        buckets[b] = buckets[b - 1];
+    buckets[0] = 0;
+
+    free (hashes);
+
+    dict -> deletes_buckets = buckets;
+    dict -> deletes_items = items;
+    dict -> deletes_mask = mask;
+    dict -> deletes_distance = max_distance;
+    dict -> deletes_prefix = prefix;
+
+    return true;
+}
+
+/**
+ *
+ * Builds symmetric-delete index answering corrections within max_distance edits.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_build_deletes_index (int max_distance, size_t max_bytes)
+{
+    return AUTOCORR_dict_build_deletes_index (default_dict, max_distance, max_bytes);
+}
+
+/**
+ *
+ * Finds words within deletes index edit distance by probing index with deletes of word.
+ * Index covers only base dict of overlays, whose own tries are searched first.
+ * Copies closest candidate into word_cor, highest frequency among equally close ones.
+ * Returns frequency of chosen candidate, 0 if none found.
+ *
+ */
+static int correct_deletes (AUTOCORR_ctx* ctx, const char* word, char* word_cor)
+{
+    const AUTOCORR_dict* base = base_dict (ctx -> dict);
+    const AUTOCORR_dict* dict = layer_dict (base);
+
+    int word_len = strlen (word);
+    if (word_len > AUTOCORR_LENGTH_MAX)
+        return 0;
+
+    int best_distance = dict -> deletes_distance + 1, best_prob = 0;
+    if (ctx -> dict != base && correct_search (ctx, word, word_cor, dict -> deletes_distance, base) > 0)
+    {
+        best_distance = ctx -> search.best_distance;
+        best_prob = ctx -> search.best_prob;
+    }
+
+    uint32_t* hashes = ctx -> hashes;
+    int count = word_deletes (word, word_len, dict -> deletes_prefix, dict -> deletes_distance, hashes);
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t bucket = hashes[i] & dict -> deletes_mask;
+
+        for (uint32_t k = dict -> deletes_buckets[bucket]; k < dict -> deletes_buckets[bucket + 1]; k++)
+        {
+            if (dict -> deletes_items[k].hash != hashes[i])
+                continue;
+
+            uint32_t w = dict -> deletes_items[k].word_id;
+            const char* candidate = dict -> word_text + dict -> word_offsets[w];
+
+            // Word itself is not its own correction
+            int distance = edit_distance (word, word_len, candidate, strlen (candidate), dict -> deletes_distance);
+            COUNT (ctx -> stats.candidates_probed, 1);
+            if (distance == 0 || distance > dict -> deletes_distance)
+                continue;
+
+            // Closer candidates always win, frequency breaks ties
+            if ((distance < best_distance || (distance == best_distance && dict -> word_frequencies[w] > best_prob)) &&
+                !hidden_word (ctx -> dict, base, candidate, strlen (candidate)))
+            {
+                best_distance = distance;
+                best_prob = dict -> word_frequencies[w];
+                strcpy (word_cor, candidate);
+            }
+        }
+    }
+
+    return best_prob;
+}
+
+/**
+ *
+ * Collects up to k closest words within deletes index edit distance of word, as correct_deletes,
+ * into heap of candidates of ctx.
+ * Candidates farther than worst candidate kept are dropped early once k are found.
+ * Returns number of candidates collected.
+ *
+ */
+static int suggest_deletes (AUTOCORR_ctx* ctx, const char* word, int k)
+{
+    const AUTOCORR_dict* base = base_dict (ctx -> dict);
+    const AUTOCORR_dict* dict = layer_dict (base);
+
+    int word_len = strlen (word);
+    if (word_len > AUTOCORR_LENGTH_MAX)
+        return 0;
+
+    // Words of overlays above base dict first, index candidates being numbered as base layer
+    candidate* heap = ctx -> candidates;
+    int size = 0, bound = dict -> deletes_distance, layer = 0;
+    if (ctx -> dict != base)
+    {
+        size = suggest_search (ctx, word, k, dict -> deletes_distance, base);
+        if (size == k)
+            bound = heap[0].distance;
+
+        for (const AUTOCORR_dict* d = ctx -> dict; d != base; d = d -> base)
+            layer++;
+    }
+
+    uint32_t* hashes = ctx -> hashes;
+    int count = word_deletes (word, word_len, dict -> deletes_prefix, dict -> deletes_distance, hashes);
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t bucket = hashes[i] & dict -> deletes_mask;
+
+        for (uint32_t item = dict -> deletes_buckets[bucket]; item < dict -> deletes_buckets[bucket + 1]; item++)
+        {
+            if (dict -> deletes_items[item].hash != hashes[i])
+                continue;
+
+            uint32_t w = dict -> deletes_items[item].word_id;
+            const char* text = dict -> word_text + dict -> word_offsets[w];
+
+            // Word itself is not its own correction
+            int distance = edit_distance (word, word_len, text, strlen (text), bound);
+            COUNT (ctx -> stats.candidates_probed, 1);
+            if (distance == 0 || distance > bound)
+                continue;
+
+            candidate c = { dict -> word_frequencies[w], distance, w, layer };
+            if ((size == k && !worse_candidate (&heap[0], &c)) || (layer > 0 && hidden_word (ctx -> dict, base, text, strlen (text))))
+                continue;
+
+            // Word found through several of its deletes is kept once
+            int j = 0;
+            while (j < size && (heap[j].id != w || heap[j].layer != layer))
+                j++;
+
+            if (j == size && offer_candidate (heap, &size, k, c) && size == k)
+                bound = heap[0].distance;
+        }
+    }
+
+    return size;
+}
+
+/**
+ *
+ * Creates correction state for one thread using dict.
+ * Returns correction state if successful else NULL.
+ *
+ */
+AUTOCORR_ctx* AUTOCORR_ctx_new (const AUTOCORR_dict* dict)
+{
+    if (dict == NULL)
+        return NULL;
+
+    AUTOCORR_ctx* ctx = malloc (sizeof (AUTOCORR_ctx));
+    if (ctx == NULL)
+        return NULL;
+
+    ctx -> dict = dict;
+    ctx -> search_distance = 1;
+    ctx -> cache = NULL;
+    memset (&ctx -> stats, 0, sizeof (AUTOCORR_stats));
+
+    return ctx;
+}
+
+/**
+ *
+ * Checks n words in dictionary of ctx, as AUTOCORR_dict_check_words.
+ * Counts trie nodes visited in statistics of ctx.
+ *
+ */
+void AUTOCORR_ctx_check_words (AUTOCORR_ctx* ctx, const char** words, const int* lens, int n, int* freqs_out)
+{
+#if AUTOCORR_STATS
+    check_layers (ctx -> dict, words, lens, n, freqs_out, &ctx -> stats.nodes_visited);
+#else
+    check_layers (ctx -> dict, words, lens, n, freqs_out, NULL);
+#endif
+}
+
+/**
+ *
+ * Copies work counters of checks and corrections using ctx into stats.
+ *
+ */
+void AUTOCORR_ctx_stats (const AUTOCORR_ctx* ctx, AUTOCORR_stats* stats)
+{
+    *stats = ctx -> stats;
+}
+
+/**
+ *
+ * Frees correction state.
+ *
+ */
+void AUTOCORR_ctx_free (AUTOCORR_ctx* ctx)
+{
+    free (ctx);
+}
+
+/**
+ *
+ * Creates correction cache using at most max_bytes of memory (0 for default of 16 MB).
+ * Returns cache if successful else NULL.
+ *
+ */
+AUTOCORR_cache* AUTOCORR_cache_new (size_t max_bytes)
+{
+    if (max_bytes == 0)
+        max_bytes = CACHE_DEFAULT_BYTES;
+
+    // Largest power of two number of buckets within memory cap
+    uint32_t buckets = 1;
+    while ((size_t) buckets * 2 * (CACHE_WAYS * sizeof (cache_entry) + 1) <= max_bytes && buckets < (1u << 30))
+        buckets *= 2;
+
+    AUTOCORR_cache* cache = malloc (sizeof (AUTOCORR_cache));
+    if (cache == NULL)
+        return NULL;
+
+    cache -> entries = calloc ((size_t) buckets * CACHE_WAYS, sizeof (cache_entry));
+    cache -> hands = calloc (buckets, sizeof (uint8_t));
+    cache -> mask = buckets - 1;
+
+    if (cache -> entries == NULL || cache -> hands == NULL)
+    {
+        free (cache -> entries);
+        free (cache -> hands);
+        free (cache);
+        return NULL;
+    }
+
+    for (int i = 0; i < CACHE_STRIPES; i++)
+    {
+        pthread_mutex_init (&cache -> stripes[i].lock, NULL);
+        cache -> stripes[i].hits = 0;
+        cache -> stripes[i].misses = 0;
+    }
+
+    return cache;
+}
+
+/**
+ *
+ * Gives cache key hash of word corrected with settings mode.
+ *
+ */
+static inline uint32_t cache_hash (const char* word, int len, int mode)
+{
+    return (hash_string (word, len) ^ mode) * 16777619u;
+}
+
+/**
+ *
+ * Looks up correction of word with settings mode in cache.
+ * Copies correction (empty if no suggestion) into word_cor if found.
+ * Returns true if found else false.
+ *
+ */
+static bool cache_lookup (AUTOCORR_cache* cache, const char* word, int mode, char* word_cor)
+{
+    int len = strlen (word);
+    if (len > AUTOCORR_LENGTH_MAX)
+        return false;
+
+    uint32_t hash = cache_hash (word, len, mode);
+    uint32_t bucket = hash & cache -> mask;
+    cache_entry* entry = &cache -> entries[(size_t) bucket * CACHE_WAYS];
+    cache_stripe* stripe = &cache -> stripes[bucket % CACHE_STRIPES];
+
+    bool found = false;
+
+    pthread_mutex_lock (&stripe -> lock);
+    for (int w = 0; w < CACHE_WAYS && !found; w++)
+    {
+        if (entry[w].mode == mode && entry[w].hash == hash && strcmp (entry[w].word, word) == 0)
+        {
+            strcpy (word_cor, entry[w].correction);
+            entry[w].referenced = 1;
+            found = true;
+        }
+    }
+
+    if (found)
+        stripe -> hits++;
+    else
+        stripe -> misses++;
+    pthread_mutex_unlock (&stripe -> lock);
+
+    return found;
+}
+
+/**
+ *
+ * Stores correction word_cor (empty if no suggestion) of word with settings mode in cache.
+ * Evicts entry of full bucket not used since eviction hand last passed it.
+ *
+ */
+static void cache_insert (AUTOCORR_cache* cache, const char* word, int mode, const char* word_cor)
+{
+    int len = strlen (word);
+    if (len > AUTOCORR_LENGTH_MAX || strlen (word_cor) >= AUTOCORR_CORRECTION_MAX)
+        return;
+
+    uint32_t hash = cache_hash (word, len, mode);
+    uint32_t bucket = hash & cache -> mask;
+    cache_entry* entry = &cache -> entries[(size_t) bucket * CACHE_WAYS];
+    cache_stripe* stripe = &cache -> stripes[bucket % CACHE_STRIPES];
+
+    pthread_mutex_lock (&stripe -> lock);
+
+    // Reuse entry of same word (stored by another thread meanwhile) or empty entry
+    cache_entry* victim = NULL;
+    for (int w = 0; w < CACHE_WAYS && victim == NULL; w++)
+        if (entry[w].mode == 0 || (entry[w].mode == mode && entry[w].hash == hash && strcmp (entry[w].word, word) == 0))
+            victim = &entry[w];
+
+    // Give used entries second chance
+    uint8_t* hand = &cache -> hands[bucket];
+    while (victim == NULL)
+    {
+        cache_entry* e = &entry[*hand];
+        *hand = (*hand + 1) % CACHE_WAYS;
+
+        if (e -> referenced)
+            e -> referenced = 0;
+        else
+            victim = e;
+    }
+
+    victim -> hash = hash;
+    victim -> mode = mode;
+    victim -> referenced = 0;
+    strcpy (victim -> word, word);
+    strcpy (victim -> correction, word_cor);
+
+    pthread_mutex_unlock (&stripe -> lock);
+}
+
+/**
+ *
+ * Gives number of corrections found in cache (hits) and not found (misses).
+ *
+ */
+void AUTOCORR_cache_stats (AUTOCORR_cache* cache, unsigned long* hits, unsigned long* misses)
+{
+    *hits = 0;
+    *misses = 0;
+
+    if (cache == NULL)
+        return;
+
+    for (int i = 0; i < CACHE_STRIPES; i++)
+    {
+        pthread_mutex_lock (&cache -> stripes[i].lock);
+        *hits += cache -> stripes[i].hits;
+        *misses += cache -> stripes[i].misses;
+        pthread_mutex_unlock (&cache -> stripes[i].lock);
+    }
+}
+
+/**
+ *
+ * Frees correction cache.
+ *
+ */
+void AUTOCORR_cache_free (AUTOCORR_cache* cache)
+{
+    if (cache == NULL)
+        return;
+
+    for (int i = 0; i < CACHE_STRIPES; i++)
+        pthread_mutex_destroy (&cache -> stripes[i].lock);
+
+    free (cache -> entries);
+    free (cache -> hands);
+    free (cache);
+}
+
+/**
+ *
+ * Sets cache of corrections used by ctx, NULL to not use any.
+ *
+ */
+void AUTOCORR_ctx_set_cache (AUTOCORR_ctx* ctx, AUTOCORR_cache* cache)
+{
+    ctx -> cache = cache;
+}
+
+/**
+ *
+ * Finds correction of word using ctx, without cache.
+ * Copies correction into word_cor, empty if no suggestion found.
+ *
+ */
+static void find_correction (AUTOCORR_ctx* ctx, const char* word, char* word_cor)
+{
+    word_cor[0] = '\0';
+
+    // Core tier alone would give corrections of most frequent words only
+    if (!AUTOCORR_dict_wait (ctx -> dict))
+        return;
+
+    // Use symmetric-delete index if built, else search trie directly
+    if (layer_dict (base_dict (ctx -> dict)) -> deletes_items != NULL)
+        correct_deletes (ctx, word, word_cor);
+    else
+        correct_search (ctx, word, word_cor, ctx -> search_distance, NULL);
+
+    /**
+     * Segmentation into multiple words ("maximumtime" to "maximum time")
+     * Inserts spaces into incorrect word, choosing most probable sequence of words
+     * To be tried only if no other alternate replacements found
+     */
+    if (word_cor[0] == '\0' && strlen (word) <= AUTOCORR_LENGTH_MAX)
+        segment_word (ctx, word, word_cor);
+}
+
+/**
+ *
+ * Edit distance between two words: number of edits to turn one into the other.
+ * Can be deletion (remove one letter), transposition (swap adjacent letters),
+ * alteration (change one letter to another) or insertion (add a letter)
+ *
+ * Finds words within edit distance of ctx with a single bounded search of the trie,
+ * or within deletes index distance if index is built
+ * Reuses corrections stored in cache of ctx, if set.
+ * Copies closest word with highest probability value as suggested correction for
+ * misspelled word into correction (of correction_size bytes).
+ * Returns true if correction found, false if not found or correction does not fit.
+ *
+ */
+bool AUTOCORR_ctx_correct (AUTOCORR_ctx* ctx, const char* word, char* correction, size_t correction_size)
+{
+    char* word_cor = ctx -> correction;
+
+    // Settings corrections depend on, part of cache key
+    const AUTOCORR_dict* dict = layer_dict (base_dict (ctx -> dict));
+    int mode = (dict -> deletes_items != NULL) ? SEARCH_DISTANCE_MAX + 1 + dict -> deletes_distance : ctx -> search_distance;
+
+    if (ctx -> cache == NULL || !cache_lookup (ctx -> cache, word, mode, word_cor))
+    {
+        find_correction (ctx, word, word_cor);
+
+        if (ctx -> cache != NULL)
+            cache_insert (ctx -> cache, word, mode, word_cor);
+    }
+
+    if (word_cor[0] == '\0' || strlen (word_cor) >= correction_size)
+        return false;
+
+    strcpy (correction, word_cor);
+    return true;
+}
+
+/**
+ *
+ * Edit distance between two words: number of edits to turn one into the other.
+ * Can be deletion (remove one letter), transposition (swap adjacent letters),
+ * alteration (change one letter to another) or insertion (add a letter)
+ *
+ * Finds words within edit distance set by AUTOCORR_set_edit_distance (default 1) with a
+ * single bounded search of the trie
+ * Returns closest word with highest probability value as per word frequency data trie as suggested
+ * correction for misspelled word.
+ * Returns NULL in case of error.
+ *
+ */
+char* AUTOCORR_correct_word (const char* word)
+{
+    if (default_ctx == NULL || !AUTOCORR_ctx_correct (default_ctx, word, word_cor, sizeof (word_cor)))
+        return NULL;
+
+    return word_cor;
+}
+
+/**
+ *
+ * Finds up to k suggested corrections of misspelled word using ctx, without cache.
+ * Candidates are kept as trie nodes or word ids in a heap of the k best while searching,
+ * within edit distance of ctx (or deletes index distance), and only the k kept are copied out.
+ * If no word is close, gives word segmented into several words, as AUTOCORR_ctx_correct.
+ * Copies suggestions into out, closest first, most frequent first among equally close ones.
+ * Returns number of suggestions found.
+ *
+ */
+int AUTOCORR_ctx_suggest (AUTOCORR_ctx* ctx, const char* word, int k, AUTOCORR_suggestion* out)
+{
+    const AUTOCORR_dict* dict = ctx -> dict;
+
+    int word_len = strlen (word);
+    if (k > AUTOCORR_SUGGEST_MAX)
+        k = AUTOCORR_SUGGEST_MAX;
+    if (k < 1 || word_len > AUTOCORR_LENGTH_MAX || !AUTOCORR_dict_wait (dict))
+        return 0;
+
+    const AUTOCORR_dict* base = base_dict (dict);
+    bool indexed = (layer_dict (base) -> deletes_items != NULL);
+    int size = indexed ? suggest_deletes (ctx, word, k) : suggest_search (ctx, word, k, ctx -> search_distance, NULL);
+
+    // Take worst candidate off heap for each place from last to first
+    candidate* heap = ctx -> candidates;
+    for (int i = size - 1; i >= 0; i--)
+    {
+        candidate c = heap[0];
+        heap[0] = heap[i];
+        sift_down (heap, i, 0);
+
+        // Candidates of index are word ids of base dict, others trie nodes of their layer
+        const AUTOCORR_dict* layer = dict_layer (dict, c.layer);
+        const AUTOCORR_dict* words = layer_dict (layer);
+        if (indexed && layer == base)
+            strcpy (out[i].word, words -> word_text + words -> word_offsets[c.id]);
+        else
+            node_word (words -> nodes, c.id, out[i].word);
+
+        out[i].frequency = c.frequency;
+        out[i].distance = c.distance;
+    }
+
+    if (size > 0)
+        return size;
+
+    // Segmentation inserts spaces, and drops letters no word covers
+    segment_word (ctx, word, out[0].word);
+    if (out[0].word[0] == '\0')
+        return 0;
+
+    int spaces = 0, length = 0;
+    for (; out[0].word[length] != '\0'; length++)
+        spaces += (out[0].word[length] == ' ');
+
+    out[0].frequency = 0;
+    out[0].distance = word_len - (length - spaces) + spaces;
+    return 1;
+}
+
+/**
+ *
+ * Finds up to k suggested corrections of misspelled word, as AUTOCORR_ctx_suggest.
+ * Returns number of suggestions found, 0 if word data is not loaded.
+ *
+ */
+int AUTOCORR_suggest (const char* word, int k, AUTOCORR_suggestion* out)
+{
+    return default_ctx != NULL ? AUTOCORR_ctx_suggest (default_ctx, word, k, out) : 0;
+}
+
+
+/**
+ *
+ * Segmentation into multiple words ("maximumtime" to "maximum time")
+ * Inserts spaces into incorrect word, choosing the sequence of dictionary words with highest
+ * product of unigram probabilities (dynamic programming over split positions, Viterbi).
+ * All words starting at one position are found by a single walk down the trie of each layer.
+ * Segments are at least SEGMENT_MIN_LENGTH letters long.
+ * If no sequence of words covers whole word, longest covered prefix is used and rest discarded.
+ * Copies segmented word into word_cor, left empty if no word starts word.
+ *
+ */
+static void segment_word (AUTOCORR_ctx* ctx, const char* word, char* word_cor)
+{
+    const AUTOCORR_dict* dict = ctx -> dict;
+    int word_len = strlen (word);
+
+    // Probabilities are relative to total frequency of word data, below any overlays
+    uint32_t log_total = layer_dict (base_dict (dict)) -> log_total;
+
+    // cost[i]: least cost of splitting first i letters into words, start[i]: start of last of those words
+    uint32_t cost[AUTOCORR_LENGTH_MAX + 1];
+    int start[AUTOCORR_LENGTH_MAX + 1];
+
+    cost[0] = 0;
+    for (int i = 1; i <= word_len; i++)
+        cost[i] = COST_INFINITE;
+
+    for (int i = 0; i + SEGMENT_MIN_LENGTH <= word_len; i++)
+    {
+        if (cost[i] == COST_INFINITE)
+            continue;
+
+        // Extend split at i by every dictionary word starting at i, not hidden by a layer above
+        for (const AUTOCORR_dict* layer = dict; layer != NULL; layer = layer -> base)
+        {
+            const node* nodes = layer_dict (layer) -> nodes;
+            const node* n = nodes;
+            for (int j = i; j < word_len; j++)
+            {
+                if (byte_symbol (word[j]) < 0 || (n = byte_child (nodes, n, word[j])) == NULL)
+                    break;
+                COUNT (ctx -> stats.nodes_visited, 1);
+
+                // Words end between characters, not inside one
+                if (n -> frequency <= 0 || j + 1 - i < SEGMENT_MIN_LENGTH || (word[j + 1] & 0xC0) == 0x80 ||
+                    hidden_word (dict, layer, word + i, j + 1 - i))
+                    continue;
+
+                // Cost of word is negative logarithm of its probability
+                uint32_t word_cost = cost[i] + log_total - log2_scaled (n -> frequency);
+                if (word_cost < cost[j + 1])
+                {
+                    cost[j + 1] = word_cost;
+                    start[j + 1] = i;
+                }
+            }
+        }
+    }
+
+    // Split of whole word, else of longest prefix that can be split
+    int end = word_len;
+    while (end > 0 && cost[end] == COST_INFINITE)
+        end--;
+
+    // Collect word starts from end back to beginning, then copy words in order
+    int starts[AUTOCORR_LENGTH_MAX];
+    int count = 0;
+    for (int i = end; i > 0; i = start[i])
+        starts[count++] = start[i];
+
+    char* out = word_cor;
+    for (int k = count - 1; k >= 0; k--)
+    {
+        int stop = (k > 0) ? starts[k - 1] : end;
+        if (k < count - 1)
+            *out++ = ' ';
+        memcpy (out, word + starts[k], stop - starts[k]);
+        out += stop - starts[k];
+    }
+    *out = '\0';
+}
+
+/**
+ *
+ * Adds counts[i] to frequency of words[i] in word data, for n words, as AUTOCORR_dict_learn.
+ * Corrections cached before are forgotten, as learned words may change them.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_learn_words (const char** words, const int* counts, int n)
+{
+    if (default_dict == NULL || AUTOCORR_dict_learn (default_dict, words, counts, n) < 0)
+        return false;
+
+    AUTOCORR_cache* cache = AUTOCORR_cache_new (0);
+    if (cache == NULL)
+        return false;
+
+    AUTOCORR_ctx_set_cache (default_ctx, cache);
+    AUTOCORR_cache_free (default_cache);
+    default_cache = cache;
+
+    return true;
+}
+
+/**
+ *
+ * Gives slot of hash table of confusable words for word of length > 0 characters, in any case.
+ * Hashes only first two and last characters and length, which tell most words apart.
+ *
+ */
+static inline uint32_t word_key (const char* word, size_t length)
+{
+    uint32_t key = ((unsigned char) word[0] | 0x20) * 961 + ((unsigned char) word[length > 1] | 0x20) * 31 +
+                   ((unsigned char) word[length - 1] | 0x20) + (length << 16);
+
+    return (key * 2654435761u) >> (32 - BIGRAM_TABLE_BITS);
+}
+
 /**
- * TODO:
- * 1. Consider words with frequency > 1 and Edit Distance = 2.
- * 2. Add text from files checked by user into word data. Process and update word frequency file.
+ *
+ * Parses words of confusion sets, giving each word the index of its set.
+ * Run once, before confusable words are first looked up.
  *
  */
+static void parse_confusables (void)
+{
+    for (int set = 0; set < (int) (sizeof (confusion_sets) / sizeof (confusion_sets[0])); set++)
+    {
+        for (const char* c = confusion_sets[set]; *c != '\0' && number_confusables < CONFUSABLES_MAX; )
+        {
+            int length = strcspn (c, " ");
+            confusable* word = &confusables[number_confusables++];
 
-#include <stdio.h>
-#include <string.h>
-#include <stdbool.h>
-#include <ctype.h>
-#include <stdlib.h>
+            memcpy (word -> word, c, length);
+            word -> word[length] = '\0';
+            word -> length = length;
+            word -> set = set;
+            confusable_lengths[word -> word[0] - 'a'] |= (uint64_t) 1 << length;
 
-#include "autocorrect.h"
+            uint32_t slot = word_key (word -> word, length);
+            while (confusable_table[slot] != 0)
+                slot = (slot + 1) & ((1 << BIGRAM_TABLE_BITS) - 1);
+            confusable_table[slot] = number_confusables;
 
-// Word frequnecy data file
-#define WORD_DATA "../autocorrect-lib/data-files/word_data.txt"
+            c += length + (c[length] == ' ');
+        }
+    }
+}
 
-// Define each node of the trie with 27 children nodes
-typedef struct node
+/**
+ *
+ * Checks if first length characters of word, letters and apostrophes in any case, are the
+ * lowercase word lower.
+ *
+ */
+static inline bool same_word (const char* lower, const char* word, size_t length)
 {
-    int frequency;
+    // Apostrophe is unchanged by setting lowercase bit
+    for (size_t i = 0; i < length; i++)
+        if (((unsigned char) word[i] | 0x20) != (unsigned char) lower[i])
+            return false;
 
-    // 0-25 for lowercase a-z, 26 for apostrophe (')
-    struct node* next[27];
-} node;
+    return true;
+}
 
-// For number of unique words stored in the word frequency data loaded
-// Gives size of word frequnecy data
-static int number_dict_words = 0;
+/**
+ *
+ * Gives index of word of length characters among words of confusion sets, -1 if not found.
+ *
+ */
+static int find_confusable (const char* word, size_t length)
+{
+    pthread_once (&confusables_parsed, parse_confusables);
 
-// Initialize trie to hold word data and frequencies in memory
-node* word_freq = NULL;
+    unsigned int letter = ((unsigned char) word[0] | 0x20) - 'a';
+    if (length == 0 || length >= CONFUSABLE_LENGTH_MAX || letter >= 26 || !((confusable_lengths[letter] >> length) & 1))
+        return -1;
 
+    for (uint32_t slot = word_key (word, length); confusable_table[slot] != 0; slot = (slot + 1) & ((1 << BIGRAM_TABLE_BITS) - 1))
+    {
+        int i = confusable_table[slot] - 1;
+        if (confusables[i].length == (int) length && same_word (confusables[i].word, word, length))
+            return i;
+    }
 
-// Forward declaration of segmentation function
-// Segmentation into multiple words ("maximumtime" to "maximum time")
-void segment_word (const char* word);
+    return -1;
+}
 
 /**
  *
- * Checks if word is present in word data trie.
- * Returns word frequency if word is in present in trie, else returns -1.
+ * Checks if first length characters of word, in any case, are a word of a confusion set.
  *
  */
-int AUTOCORR_check_word (const char* word)
+bool AUTOCORR_confusable (const char* word, size_t length)
 {
-    int index, freq;
-    node* tmp = word_freq;
-
-    int word_len = strlen (word);
+    return find_confusable (word, length) >= 0;
+}
 
-    // Ignore terminal single quote character as part of word during spellcheck
-    if (word[word_len - 1] == '\'')
-        word_len--;
+/**
+ *
+ * Gives hash of text of alphabetically sorted words of dict, including terminators.
+ * Tells word data a bigram model was built with, its word ids being valid only for it.
+ *
+ */
+static uint32_t hash_words (const AUTOCORR_dict* dict)
+{
+    uint32_t hash = CHECKSUM_SEED;
 
-    for (int i = 0; i < word_len; i++)
+    for (int w = 0; w < dict -> sorted_words; w++)
     {
-        //printf ("%d", tmp -> frequency);
-        // Check if word is not just a prefix of a dictionary word
-        if (i == (word_len - 1) && tmp -> frequency == 0)
-            return -1;
-
-        else
-            // Frequency of word in trie
-            freq = tmp -> frequency;
-
-        // Handle ' as a special character
-        if (word[i] == '\'')
-            index = 26;
+        const char* c = dict -> word_text + dict -> word_offsets[w];
+        do
+            hash = (hash ^ (unsigned char) *c) * 16777619u;
+        while (*c++ != '\0');
+    }
 
-        // Handle letters of the alphabet
-        // Index between 0 - 25
-        else
-            index = (int)tolower (word[i]) - 'a';
+    return hash;
+}
 
-        // Handle error cases
-        if (index > 26 || index < 0)
-            continue;
+/**
+ *
+ * Orders pairs pointed to by a and b by list, then neighbor word id, for qsort.
+ *
+ */
+static int compare_pairs (const void* a, const void* b)
+{
+    const bigram_pair* x = a;
+    const bigram_pair* y = b;
 
-        // Check for character in trie
-        if (tmp -> next[index] == NULL)
-            return -1;
+    if (x -> list != y -> list)
+        return (x -> list < y -> list) ? -1 : 1;
 
-        else
-            tmp = tmp -> next[index];
-    }
-    return freq;
+    return (x -> neighbor > y -> neighbor) - (x -> neighbor < y -> neighbor);
 }
 
-
 /**
  *
- * Loads word frequency data from file into trie data structure.
+ * Writes number_words bigram words with number_neighbors neighbors and quantized counts
+ * (padded to 4 bytes) to bigram model at path, for word data of dict.
+ * Model is written to a temporary file and renamed, so readers never see a partial model.
  * Returns true if successful else false.
  *
  */
-bool AUTOCORR_upload (void)
+static bool write_bigrams (const AUTOCORR_dict* dict, const bigram_word* words, int number_words,
+                           const uint32_t* neighbors, const uint8_t* counts, uint32_t number_neighbors,
+                           const char* path)
 {
-	FILE* word_data_fp;
-	word_data_fp = fopen (WORD_DATA, "r");
+    char tmp_path[4096];
+    if (snprintf (tmp_path, sizeof (tmp_path), "%s.tmp", path) >= (int) sizeof (tmp_path))
+        return false;
 
-	// File not opened
-    if (word_data_fp == NULL)
+    FILE* model_fp = fopen (tmp_path, "wb");
+    if (model_fp == NULL)
         return false;
 
-    // Initialize trie for dictionary
-    if ((word_freq = calloc (1, sizeof (node))) == NULL)
+    size_t counts_size = (number_neighbors + 3) & ~3u;
+
+    bigram_header header;
+    memset (&header, 0, sizeof (header));
+    memcpy (header.magic, BIGRAM_MAGIC, sizeof (header.magic));
+    header.version = BIGRAM_VERSION;
+    header.dict_words = dict -> sorted_words;
+    header.dict_hash = hash_words (dict);
+    header.number_words = number_words;
+    header.number_neighbors = number_neighbors;
+
+    uint32_t checksum = checksum_data (CHECKSUM_SEED, words, number_words * sizeof (bigram_word));
+    checksum = checksum_data (checksum, neighbors, number_neighbors * sizeof (uint32_t));
+    header.checksum = checksum_data (checksum, counts, counts_size);
+
+    bool written = fwrite (&header, sizeof (header), 1, model_fp) == 1 &&
+                   fwrite (words, sizeof (bigram_word), number_words, model_fp) == (size_t) number_words &&
+                   fwrite (neighbors, sizeof (uint32_t), number_neighbors, model_fp) == number_neighbors &&
+                   fwrite (counts, 1, counts_size, model_fp) == counts_size;
+
+    if (fclose (model_fp) != 0 || !written || rename (tmp_path, path) != 0)
     {
-        printf ("Out of memory. Dictionary could not be loaded.\n");
+        remove (tmp_path);
         return false;
     }
-    for (int i = 0; i < 27; i++)
-        word_freq -> next[i] = NULL;
-    word_freq -> frequency = 0;
 
-    node* tmp = word_freq;
+    return true;
+}
 
-  	// Prepare to read words from word data file
-    int index = 0;
-    char word_str[AUTOCORR_LENGTH_MAX + 1];
-    int word_count;
+/**
+ *
+ * Compiles bigram model of words of confusion sets from counts of pairs of words.
+ * Words of n words with frequencies give word ids, as their word data file or image would.
+ * Each pair counted is a neighbor of its words found in confusion sets.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_compile_bigrams (const char** words, const int* frequencies, int n,
+                               const char** pairs, const int* counts, int number_pairs, const char* path)
+{
+    AUTOCORR_dict* dict = calloc (1, sizeof (AUTOCORR_dict));
+    bigram_pair* found = malloc ((2 * (size_t) number_pairs + 1) * sizeof (bigram_pair));
+    uint32_t* neighbors = malloc ((2 * (size_t) number_pairs + 1) * sizeof (uint32_t));
+    uint8_t* quantized = calloc (2 * (size_t) number_pairs + 4, 1);
+    bool compiled = false;
 
-    while (fscanf (word_data_fp, "%d", &word_count) && fscanf (word_data_fp, "%s", word_str) != EOF)
+    if (dict != NULL && found != NULL && neighbors != NULL && quantized != NULL &&
+        build_words (dict, words, frequencies, n))
     {
-        int word_len = strlen (word_str);
+        pthread_once (&confusables_parsed, parse_confusables);
 
-        for (int i = 0; i < word_len; i++)
+        // Bigram word of each confusable word present in word data, sets staying together
+        bigram_word model_words[CONFUSABLES_MAX];
+        int model_word[CONFUSABLES_MAX];
+        int number_words = 0;
+        for (int c = 0; c < number_confusables; c++)
         {
-            // Set word as present in dictionary
-            // Set frequency from file data
-            if (i == word_len - 1)
-                tmp -> frequency = word_count;
+            int id = find_word_id (dict, confusables[c].word);
+            model_word[c] = (id >= 0) ? number_words : -1;
+            if (id >= 0)
+                model_words[number_words++] = (bigram_word) {id, confusables[c].set, 0, 0, 0, 0};
+        }
 
-            // Handle ' as a special character
-            if (word_str[i] == '\'')
-                index = 26;
+        // Pair "left right" is left neighbor of right word and right neighbor of left word
+        int number_found = 0;
+        for (int i = 0; i < number_pairs; i++)
+        {
+            const char* space = strchr (pairs[i], ' ');
+            if (space == NULL || space - pairs[i] > AUTOCORR_LENGTH_MAX || counts[i] <= 0)
+                continue;
 
-            // Handle letters of the alphabet
-            // Neglect character case
-            else if (isalpha (word_str[i]))
-                index = (int)tolower (word_str[i]) - 'a';
+            char left[AUTOCORR_LENGTH_MAX + 1];
+            memcpy (left, pairs[i], space - pairs[i]);
+            left[space - pairs[i]] = '\0';
 
-            // Handle error cases
-            if (index > 26 || index < 0)
+            int left_id = find_word_id (dict, left), right_id = find_word_id (dict, space + 1);
+            if (left_id < 0 || right_id < 0)
                 continue;
 
-            // Insert character from word read from dictionary into Trie
-            if (tmp -> next[index] == NULL)
-            {
-                // Create and initialize new next nodes for subsequent letter
-                if ((tmp -> next[index] = calloc (1, sizeof (node))) == NULL)
-                {
-                    printf ("Out of memory. Dictionary could not be loaded.\n");
-                    return false;
-                }
+            int c = find_confusable (space + 1, strlen (space + 1));
+            if (c >= 0 && model_word[c] >= 0)
+                found[number_found++] = (bigram_pair) {2 * model_word[c], left_id, counts[i]};
 
-                tmp = tmp -> next[index];
-                for (int j = 0; j < 27; j++)
-                    tmp -> next[j] = NULL;
-                tmp -> frequency = 0;
-            }
-            else
-                tmp = tmp -> next[index];
+            c = find_confusable (left, space - pairs[i]);
+            if (c >= 0 && model_word[c] >= 0)
+                found[number_found++] = (bigram_pair) {2 * model_word[c] + 1, right_id, counts[i]};
         }
 
-        // Insert next word from dictionary
-        tmp = word_freq;
-        number_dict_words++; // Dictionary word count
-    }
+        // Merge counts of same pair, quantizing their logarithms
+        qsort (found, number_found, sizeof (bigram_pair), compare_pairs);
 
-    // If end of file not reached before loop termination and error indicator is not set
-    if (feof (word_data_fp) && !ferror (word_data_fp))
-    {
-        fclose (word_data_fp);
-        return true;
+        uint32_t number_neighbors = 0;
+        for (int i = 0; i < number_found; )
+        {
+            int j = i;
+            uint64_t count = 0;
+            for (; j < number_found && found[j].list == found[i].list && found[j].neighbor == found[i].neighbor; j++)
+                count += found[j].count;
+
+            uint32_t level = (log2_scaled (count) + LOG_SCALE / BIGRAM_STEPS / 2) / (LOG_SCALE / BIGRAM_STEPS);
+            neighbors[number_neighbors] = found[i].neighbor;
+            quantized[number_neighbors] = (level < 255) ? level : 255;
+
+            // Lists are sorted, so each starts at its first neighbor
+            bigram_word* word = &model_words[found[i].list / 2];
+            if (found[i].list % 2 == 0)
+            {
+                if (word -> left_count++ == 0)
+                    word -> left = number_neighbors;
+            }
+            else if (word -> right_count++ == 0)
+                word -> right = number_neighbors;
+
+            number_neighbors++;
+            i = j;
+        }
+
+        compiled = write_bigrams (dict, model_words, number_words, neighbors, quantized, number_neighbors, path);
     }
 
-	fclose (word_data_fp);
-	return false;
+    free (found);
+    free (neighbors);
+    free (quantized);
+    AUTOCORR_dict_unload (dict);
+    return compiled;
 }
 
-// Correct replacement for incorrect word
-char* word_cor = NULL;
-
 /**
  *
- * Edit distance between two words: number of edits to turn one into the other.
- * Can be deletion (remove one letter), transposition (swap adjacent letters),
- * alteration (change one letter to another) or insertion (add a letter)
- *
- * Finds words with edit distance = 1
- * Returns word with highest probability value as per word frequency data trie as suggested
- * correction for misspelled word.
- * Returns NULL in case of error.
+ * Loads bigram model at path (default model file if NULL) for dict, mapping it in place.
+ * Model is only used with word data it was built with.
+ * Returns model if successful else NULL.
  *
  */
-char* AUTOCORR_correct_word (const char* word)
+AUTOCORR_bigrams* AUTOCORR_bigrams_load (const AUTOCORR_dict* dict, const char* path)
 {
-    int word_len = strlen (word);
-
-    // Words with edit distance of 1 from misspelled word
-    char word_edit_dist1 [AUTOCORR_LENGTH_MAX + 2];
-    int word_edit_dist1_prob;
+    // Word ids are those of word data below any overlays
+    dict = layer_dict (base_dict (dict));
 
-    // Prepare for next work check
-    free (word_cor);
-    word_cor = NULL;
+    int fd = open (path != NULL ? path : BIGRAM_DATA, O_RDONLY);
+    if (fd < 0)
+        return NULL;
 
-    // Intialize correct word string
-    if ((word_cor = calloc (AUTOCORR_LENGTH_MAX + 2, sizeof (char))) == NULL)
+    struct stat model_stat;
+    if (fstat (fd, &model_stat) != 0 || (size_t) model_stat.st_size < sizeof (bigram_header))
     {
-        printf ("Out of memory. Autocorrect could not be run.\n");
+        close (fd);
         return NULL;
     }
 
-    int word_cor_prob = 0;
+    void* map = mmap (NULL, model_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+        return NULL;
 
-    /**
-     * Deletions (remove one letter)
-     * Length of word = word_len; Length of word_edit_dist1 = word_len - 1
-     */
-    for (int i = 0; i < word_len; i++)
+    AUTOCORR_bigrams* model = calloc (1, sizeof (AUTOCORR_bigrams));
+    if (model == NULL)
     {
-        // Word with letter at i-th index removed
-        for (int j = 0; j < i; j++)
-            word_edit_dist1[j] = word[j];
+        munmap (map, model_stat.st_size);
+        return NULL;
+    }
+    model -> dict = dict;
+    model -> map = map;
+    model -> map_size = model_stat.st_size;
 
-        for (int j = i + 1; j < word_len; j++)
-            word_edit_dist1[j - 1] = word[j];
+    // Validate header, size and checksum before trusting any index
+    const bigram_header* header = map;
+    size_t payload_size = (size_t) header -> number_words * sizeof (bigram_word) +
+                          (size_t) header -> number_neighbors * sizeof (uint32_t) +
+                          (((size_t) header -> number_neighbors + 3) & ~(size_t) 3);
 
-        // Terminate word
-        word_edit_dist1[word_len - 1] = '\0';
+    bool valid = memcmp (header -> magic, BIGRAM_MAGIC, sizeof (header -> magic)) == 0 &&
+                 header -> version == BIGRAM_VERSION && header -> number_words <= CONFUSABLES_MAX &&
+                 sizeof (bigram_header) + payload_size == (size_t) model_stat.st_size &&
+                 checksum_data (CHECKSUM_SEED, header + 1, payload_size) == header -> checksum &&
+                 header -> dict_words == (uint32_t) dict -> sorted_words && header -> dict_hash == hash_words (dict);
 
-        // Choose word with highest probability value as per word data frequency trie
-        word_edit_dist1_prob = AUTOCORR_check_word (word_edit_dist1);
-        if (word_edit_dist1_prob > word_cor_prob)
-        {
-            strcpy (word_cor, word_edit_dist1);
-            word_cor_prob = word_edit_dist1_prob;
-        }
+    if (valid)
+    {
+        model -> words = (const bigram_word*) (header + 1);
+        model -> number_words = header -> number_words;
+        model -> neighbors = (const uint32_t*) (model -> words + model -> number_words);
+        model -> counts = (const uint8_t*) (model -> neighbors + header -> number_neighbors);
     }
 
-    /**
-     * Transposition (swap adjacent letters)
-     * Length of word = word_len; Length of word_edit_dist1 = word_len
-     */
-    for (int i = 0; i < word_len - 1; i++)
+    // Index text of words, neighbor lists and word ids must lie within model and word data
+    for (int i = 0; i < model -> number_words && valid; i++)
     {
-        char tmp;
+        const bigram_word* word = &model -> words[i];
+        valid = word -> word_id < header -> dict_words &&
+                (uint64_t) word -> left + word -> left_count <= header -> number_neighbors &&
+                (uint64_t) word -> right + word -> right_count <= header -> number_neighbors;
+        if (!valid)
+            break;
 
-        strcpy (word_edit_dist1, word);
+        model -> text[i] = dict -> word_text + dict -> word_offsets[word -> word_id];
+        model -> length[i] = strlen (model -> text[i]);
 
-        // Swap letters word[i] and word[i + 1]
-        tmp = word_edit_dist1[i + 1];
-        word_edit_dist1[i + 1] = word_edit_dist1[i];
-        word_edit_dist1[i] = tmp;
+        unsigned int letter = (unsigned char) model -> text[i][0] - 'a';
+        valid = (letter < 26 && model -> length[i] < CONFUSABLE_LENGTH_MAX);
+        if (!valid)
+            break;
 
-        // Choose word with highest probability value as per word data frequency trie
-        word_edit_dist1_prob = AUTOCORR_check_word (word_edit_dist1);
-        if (word_edit_dist1_prob > word_cor_prob)
-        {
-            strcpy (word_cor, word_edit_dist1);
-            word_cor_prob = word_edit_dist1_prob;
-        }
+        model -> lengths[letter] |= (uint64_t) 1 << model -> length[i];
+
+        uint32_t slot = word_key (model -> text[i], model -> length[i]);
+        while (model -> word_table[slot] != 0)
+            slot = (slot + 1) & ((1 << BIGRAM_TABLE_BITS) - 1);
+        model -> word_table[slot] = i + 1;
     }
 
-    /**
-     * Alteration (change one letter to another)
-     * Length of word = word_len; Length of word_edit_dist1 = word_len
-     */
-    for (int i = 0; i < word_len; i++)
-    {
-        for (char c = 'a'; c <= 'z'; c++)
-        {
-            // Word with letter at i-th index changed to c
-            for (int j = 0; j < i; j++)
-                word_edit_dist1[j] = word[j];
+    for (uint32_t i = 0; i < header -> number_neighbors && valid; i++)
+        valid = (model -> neighbors[i] < header -> dict_words);
 
-            // Letter at i-th index altered
-            word_edit_dist1[i] = c;
+    // Index neighbors by text, table at most half full
+    uint32_t capacity = 16;
+    while (valid && capacity < 2 * (uint64_t) header -> number_neighbors)
+        capacity *= 2;
 
-            for (int j = i + 1; j < word_len; j++)
-                word_edit_dist1[j] = word[j];
+    if (valid && (model -> neighbor_table = malloc (capacity * sizeof (uint32_t))) == NULL)
+    {
+        printf ("Out of memory. Bigram model could not be loaded.\n");
+        valid = false;
+    }
 
-            // Terminate word
-            word_edit_dist1[word_len] = '\0';
+    if (valid)
+    {
+        memset (model -> neighbor_table, 0xFF, capacity * sizeof (uint32_t));
+        model -> neighbor_mask = capacity - 1;
 
-            // Choose word with highest probability value as per word data frequency trie
-            word_edit_dist1_prob = AUTOCORR_check_word (word_edit_dist1);
-            if (word_edit_dist1_prob > word_cor_prob)
-            {
-                strcpy (word_cor, word_edit_dist1);
-                word_cor_prob = word_edit_dist1_prob;
-            }
+        for (uint32_t i = 0; i < header -> number_neighbors; i++)
+        {
+            uint32_t id = model -> neighbors[i];
+            const char* text = dict -> word_text + dict -> word_offsets[id];
+
+            uint32_t slot = hash_string (text, strlen (text)) & model -> neighbor_mask;
+            while (model -> neighbor_table[slot] != NO_NEIGHBOR && model -> neighbor_table[slot] != id)
+                slot = (slot + 1) & model -> neighbor_mask;
+            model -> neighbor_table[slot] = id;
         }
     }
 
-    /**
-     * Insertion (add a letter)
-     * Length of word = word_len; Length of word_edit_dist1 = word_len + 1
-     */
-    for (int i = 0; i < word_len + 1; i++)
+    if (!valid)
     {
-        for (char c = 'a'; c <= 'z'; c++)
-        {
-            // Word with letter added at i-th index
-            for (int j = 0; j < i; j++)
-                word_edit_dist1[j] = word[j];
+        AUTOCORR_bigrams_unload (model);
+        return NULL;
+    }
 
-            // Insert letter at i-th index
-            word_edit_dist1[i] = c;
+    return model;
+}
 
-            for (int j = i; j < word_len; j++)
-                word_edit_dist1[j + 1] = word[j];
+/**
+ *
+ * Gives index of first length characters of word, in any case, among words of bigram model.
+ * Returns -1 if word is not in model.
+ *
+ */
+int AUTOCORR_bigrams_find (const AUTOCORR_bigrams* model, const char* word, size_t length)
+{
+    // Most words are ruled out by first letter and length
+    unsigned int letter = ((unsigned char) word[0] | 0x20) - 'a';
+    if (length == 0 || length >= CONFUSABLE_LENGTH_MAX || letter >= 26 || !((model -> lengths[letter] >> length) & 1))
+        return -1;
 
-            // Choose word with highest probability value as per word data frequency trie
-            word_edit_dist1_prob = AUTOCORR_check_word (word_edit_dist1);
-            if (word_edit_dist1_prob > word_cor_prob)
-            {
-                strcpy (word_cor, word_edit_dist1);
-                word_cor_prob = word_edit_dist1_prob;
-            }
-        }
+    for (uint32_t slot = word_key (word, length); model -> word_table[slot] != 0; slot = (slot + 1) & ((1 << BIGRAM_TABLE_BITS) - 1))
+    {
+        int i = model -> word_table[slot] - 1;
+        if (model -> length[i] == (int) length && same_word (model -> text[i], word, length))
+            return i;
     }
 
-    /**
-     * Segmentation into multiple words ("maximumtime" to "maximum time")
-     * Inserts spaces into incorrect word using greedy maximum prefix algorithm
-     * To be tried only if no other alternate replacements found
-     */
-    if (word_cor[0] == '\0')
-    {
-        // Prepare to check, segment word
-        free (word_cor);
-        word_cor = NULL;
+    return -1;
+}
+
+/**
+ *
+ * Finds first length characters of word (letters and apostrophes, in any case) among neighbors
+ * of model, as neighbor of confusable word.
+ * Words never seen next to any confusable word would score all words of a set alike, so they
+ * are not looked up in word data.
+ * Returns neighbor, with id and log_frequency -1 if word is NULL or not among neighbors.
+ *
+ */
+static neighbor find_neighbor (const AUTOCORR_bigrams* model, const char* word, size_t length)
+{
+    neighbor found = {-1, -1};
+    if (word == NULL || length == 0 || length > AUTOCORR_LENGTH_MAX)
+        return found;
 
-        // Intialize correct word string
-        // Add log (AUTOCORR_LENGTH_MAX) / log (2) space to word_cor for possible segmentation spaces
-        // Add space for segment correction
-        if ((word_cor = calloc (2 * AUTOCORR_LENGTH_MAX, sizeof (char))) == NULL)
-            printf ("Out of memory. Autocorrect could not be run.\n");
+    char lower[AUTOCORR_LENGTH_MAX + 1];
+    for (size_t i = 0; i < length; i++)
+        lower[i] = word[i] | 0x20;
+    lower[length] = '\0';
 
-        segment_word (word);
+    const AUTOCORR_dict* dict = model -> dict;
+    for (uint32_t slot = hash_string (lower, length) & model -> neighbor_mask; ; slot = (slot + 1) & model -> neighbor_mask)
+    {
+        uint32_t id = model -> neighbor_table[slot];
+        if (id == NO_NEIGHBOR)
+            break;
 
-        // Handle empty strings - no replacement word found
-        if (word_cor[0] == '\0')
-            return NULL;
+        if (strcmp (lower, dict -> word_text + dict -> word_offsets[id]) == 0)
+        {
+            found.id = id;
+            found.log_frequency = log2_scaled (dict -> word_frequencies[id]);
+            break;
+        }
+    }
 
-        // Remove leading space from segmented word
+    return found;
+}
+
+/**
+ *
+ * Gives logarithm of count of pair of word of model with neighbor n, from its neighbor list of
+ * count neighbors from first, setting *seen if pair was seen in corpus.
+ * Unseen pairs are given half the count expected of words occurring independently, at most half.
+ *
+ */
+static int64_t pair_score (const AUTOCORR_bigrams* model, uint32_t first, uint32_t count, neighbor n,
+                           int64_t log_word, bool* seen)
+{
+    uint32_t lo = first, hi = first + count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (model -> neighbors[mid] < (uint32_t) n.id)
+            lo = mid + 1;
         else
-            for (int j = 0; word_cor[j] != '\0'; j++)
-                word_cor[j] = word_cor[j + 1];
+            hi = mid;
     }
 
-    return word_cor;
+    if (lo < first + count && model -> neighbors[lo] == (uint32_t) n.id)
+    {
+        *seen = true;
+        return model -> counts[lo] * (LOG_SCALE / BIGRAM_STEPS);
+    }
+
+    int64_t expected = n.log_frequency + log_word - model -> dict -> log_total;
+    return (expected < 0 ? expected : 0) - LOG_SCALE;
 }
 
+/**
+ *
+ * Gives logarithm of probability of word of model between neighbors prev and next, up to a
+ * constant: count of word, times probability of each neighbor found in model given word.
+ * Sets *seen if word was seen next to either neighbor.
+ *
+ */
+static int64_t context_score (const AUTOCORR_bigrams* model, const bigram_word* word, neighbor prev, neighbor next,
+                              bool* seen)
+{
+    int64_t log_word = log2_scaled (model -> dict -> word_frequencies[word -> word_id]);
+    int64_t score = log_word;
+
+    if (prev.id >= 0)
+        score += pair_score (model, word -> left, word -> left_count, prev, log_word, seen) - log_word;
+
+    if (next.id >= 0)
+        score += pair_score (model, word -> right, word -> right_count, next, log_word, seen) - log_word;
+
+    return score;
+}
 
 /**
  *
- * Segmentation into multiple words ("maximumtime" to "maximum time")
- * Inserts spaces into incorrect word using greedy maximum prefix algorithm
- * To be tried only if no other alternate replacements found
- * Adds one leading whitespace to segmented word
+ * Gives word of confusion set of word (index in model) much more probable than word between
+ * words prev and next, of prev_length and next_length characters (NULL if none).
+ * Returns NULL if context does not tell against word.
  *
  */
-void segment_word (const char* word)
+const char* AUTOCORR_bigrams_alternative (const AUTOCORR_bigrams* model, int word, const char* prev, size_t prev_length,
+                                          const char* next, size_t next_length)
 {
-    int word_len = strlen (word);
+    // Alternatives must have been seen next to a neighbor
+    neighbor before = find_neighbor (model, prev, prev_length);
+    neighbor after = find_neighbor (model, next, next_length);
+    if (before.id < 0 && after.id < 0)
+        return NULL;
 
-    char* word_seg_cor = NULL;
-    char* word_seg_rem = NULL;
+    bool seen = false;
+    const bigram_word* words = model -> words;
+    int64_t best_score = context_score (model, &words[word], before, after, &seen) + BIGRAM_MARGIN;
+    int best = -1;
 
-    // Check for largest prefix of the incorrect word string
-    // Only consider prefixes longer than/equal to length 2
-    for (int i = word_len - 1; i >= 2; i--)
+    // Words of set are stored together
+    int first = word;
+    while (first > 0 && words[first - 1].set == words[word].set)
+        first--;
+
+    for (int i = first; i < model -> number_words && words[i].set == words[word].set; i++)
     {
-        bool prefix_match = false;
+        if (i == word)
+            continue;
+
+        // Alternatives must have been seen in context, not only be more frequent
+        seen = false;
+        int64_t score = context_score (model, &words[i], before, after, &seen);
+        if (seen && score > best_score)
+        {
+            best_score = score;
+            best = i;
+        }
+    }
 
-        // Initialize word_seg_cor string
-        if ((word_seg_cor = calloc (i + 2, sizeof (char))) == NULL)
-            printf ("Out of memory. Autocorrect could not be run.\n");
+    return (best >= 0) ? model -> text[best] : NULL;
+}
 
-        // Initialize word_seg_rem string
-        if ((word_seg_rem = calloc (word_len - i, sizeof (char))) == NULL)
-            printf ("Out of memory. Autocorrect could not be run.\n");
+/**
+ *
+ * Unloads bigram model from memory.
+ *
+ */
+void AUTOCORR_bigrams_unload (AUTOCORR_bigrams* model)
+{
+    if (model == NULL)
+        return;
 
-        // Create specified prefix of word to segment
-        for (int j = 0; j <= i; j++)
-            word_seg_cor[j] = word[j];
-        word_seg_cor[i + 1] = '\0';
+    munmap (model -> map, model -> map_size);
+    free (model -> neighbor_table);
+    free (model);
+}
 
-        // Keep remaining suffix string word_seg_rem
-        for (int j = i + 1; j < word_len; j++)
-            word_seg_rem[j - i - 1] = word[j];
-        word_seg_rem[word_len - i - 1] = '\0';
+/**
+ *
+ * Gives number of unique words in dictionary.
+ *
+ */
+unsigned int AUTOCORR_dict_size (const AUTOCORR_dict* dict)
+{
+    if (dict == NULL)
+        return 0;
 
-        // Selected prefix is a correct word
-        if (AUTOCORR_check_word (word_seg_cor) > 0)
-        {
-            // Set end of loop flag
-            prefix_match = true;
+    // Size of word data is not known if it could not be loaded whole
+    if (dict -> base == NULL)
+        return AUTOCORR_dict_wait (dict) ? layer_dict (dict) -> number_words : 0;
 
-            strcat (word_cor, " ");
-            strcat (word_cor, word_seg_cor);
-            segment_word (word_seg_rem);
-        }
+    unsigned int base_size = AUTOCORR_dict_size (dict -> base);
+    return base_size > 0 ? base_size + dict -> layered_words : 0;
+}
 
-        // Free memory
-        free (word_seg_rem);
-        free (word_seg_cor);
+/**
+ *
+ * Checks if word is present in word data trie.
+ * Returns word frequency if word is in present in trie, else returns -1.
+ *
+ */
+int AUTOCORR_check_word (const char* word)
+{
+    return AUTOCORR_dict_check (default_dict, word);
+}
 
-        if (prefix_match == true)
-            break;
-    }
+/**
+ *
+ * Checks n words (words[i] of lens[i] characters) for presence in word data trie.
+ * Sets freqs_out[i] to word frequency if word is present in trie, else to -1.
+ *
+ */
+void AUTOCORR_check_words (const char** words, const int* lens, int n, int* freqs_out)
+{
+    AUTOCORR_dict_check_words (default_dict, words, lens, n, freqs_out);
 }
 
 /**
@@ -444,23 +4629,38 @@ void segment_word (const char* word)
  */
 unsigned int AUTOCORR_size_data (void)
 {
-    return number_dict_words;
+    return AUTOCORR_dict_size (default_dict);
 }
 
 /**
  *
- * Recursive function to unload trie from memory.
+ * Unloads dictionary from memory.
+ * Trie nodes live in arena or image mapping, released in a few munmap calls.
  *
  */
-void unload_recr (node* dict_rem)
+void AUTOCORR_dict_unload (AUTOCORR_dict* dict)
 {
-    // Recursively freeing allocated memory
-    for (int i = 0; i < 27; i++)
-        if (dict_rem -> next[i] != NULL)
-            unload_recr (dict_rem -> next[i]);
+    if (dict == NULL)
+        return;
+
+    // Full tier is unloaded once its loading thread is done
+    if (dict -> tier != NULL)
+    {
+        pthread_join (dict -> tier -> loader, NULL);
+        AUTOCORR_dict_unload (dict -> tier -> full);
+
+        pthread_mutex_destroy (&dict -> tier -> lock);
+        pthread_cond_destroy (&dict -> tier -> loaded);
+        free (dict -> tier);
+    }
+
+    arena_release (&dict -> data_arena);
+    arena_release (&dict -> deletes_arena);
 
-    free (dict_rem);
-    dict_rem = NULL;
+    if (dict -> image_map != NULL)
+        munmap (dict -> image_map, dict -> image_size);
+
+    free (dict);
 }
 
 /**
@@ -471,8 +4671,12 @@ void unload_recr (node* dict_rem)
  */
 void AUTOCORR_unload_words (void)
 {
-    free (word_cor);
-    word_cor = NULL;
+    AUTOCORR_ctx_free (default_ctx);
+    default_ctx = NULL;
+
+    AUTOCORR_cache_free (default_cache);
+    default_cache = NULL;
 
-    unload_recr (word_freq);
+    AUTOCORR_dict_unload (default_dict);
+    default_dict = NULL;
 }
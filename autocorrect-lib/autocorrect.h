@@ -4,9 +4,55 @@
  * Header file with the functionality of the autocorrect feature
  *
  * AUTOCORR_LENGTH_MAX - store maximum permitted word length
+ * AUTOCORR_CORRECTION_MAX - store maximum length of correction buffers
+ * AUTOCORR_SUGGEST_MAX - store maximum number of suggestions given at once
+ * AUTOCORR_suggestion - suggested correction with its frequency and edit distance
+ * AUTOCORR_dict - loaded word data, shareable between threads
+ * AUTOCORR_ctx - per-thread correction state using a dict
+ * AUTOCORR_dict_upload - load word data into new dict
+ * AUTOCORR_dict_upload_tiered - load most frequent words into new dict, the rest in background
+ * AUTOCORR_dict_wait - wait until all words of dict are loaded
+ * AUTOCORR_dict_overlay - load overlay of words added or suppressed on top of dict
+ * AUTOCORR_dict_check - check frequency of word in dict
+ * AUTOCORR_dict_check_span - check frequency of unterminated word in dict
+ * AUTOCORR_dict_check_words - check frequencies of batch of words in dict
+ * AUTOCORR_fold_word - fold case and apostrophes of UTF-8 word as dict stores it
+ * AUTOCORR_dict_build_deletes_index - index dict word deletes for larger edit distances
+ * AUTOCORR_dict_learn - add words or frequencies to dict, recorded in delta log
+ * AUTOCORR_dict_compact - merge delta log into word data file
+ * AUTOCORR_dict_set_log_limit - set size of delta log past which learning merges it
+ * AUTOCORR_dict_size - give number of unique words in dict
+ * AUTOCORR_dict_unload - unload dict to free memory
+ * AUTOCORR_ctx_new - create correction state for dict
+ * AUTOCORR_ctx_set_edit_distance - set edit distance of correction state
+ * AUTOCORR_ctx_check_words - check frequencies of batch of words, counting work
+ * AUTOCORR_ctx_correct - copy correct spelling of misspelled word into buffer
+ * AUTOCORR_ctx_suggest - copy k best suggestions for misspelled word into array
+ * AUTOCORR_stats - work counters of correction state
+ * AUTOCORR_ctx_stats - give work counters of correction state
+ * AUTOCORR_ctx_free - free correction state
+ * AUTOCORR_cache - bounded cache of corrections, shareable between threads
+ * AUTOCORR_cache_new - create correction cache
+ * AUTOCORR_ctx_set_cache - set correction cache used by correction state
+ * AUTOCORR_cache_stats - give correction cache hits and misses
+ * AUTOCORR_cache_free - free correction cache
  * AUTOCORR_check_word - check frequency of word in trie
+ * AUTOCORR_check_words - check frequencies of batch of words in trie
  * AUTOCORR_upload - add words and frequencies to trie
+ * AUTOCORR_compile_data - compile word data into binary image
+ * AUTOCORR_compile_words - compile words and frequencies into binary image
+ * AUTOCORR_confusable - check if word belongs to a set of commonly confused words
+ * AUTOCORR_compile_bigrams - compile bigram model of confusable words from counts of word pairs
+ * AUTOCORR_bigrams - bigram context model of confusable words, shareable between threads
+ * AUTOCORR_bigrams_load - load bigram model for dict
+ * AUTOCORR_bigrams_find - find confusable word in bigram model
+ * AUTOCORR_bigrams_alternative - give word of confusion set its context makes more probable
+ * AUTOCORR_bigrams_unload - unload bigram model
+ * AUTOCORR_learn_words - add words or frequencies to word data, recorded in delta log
  * AUTOCORR_correct_word - give correct spelling of misspelled word
+ * AUTOCORR_suggest - copy k best suggestions for misspelled word into array
+ * AUTOCORR_set_edit_distance - set edit distance of trie search corrections
+ * AUTOCORR_build_deletes_index - index word deletes for larger edit distances
  * AUTOCORR_size_data - give number of unique words in word frequency data
  * AUTOCORR_unload_words - unload word hash table to free memory
  *
@@ -19,11 +65,296 @@
 #define AUTOCORRECT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
-// Assumed maximum word length in dictionary
+// Assumed maximum word length in dictionary, in bytes of UTF-8
 // (pneumonoultramicroscopicsilicovolcanoconiosis)
 #define AUTOCORR_LENGTH_MAX 45
 
+// Work counters of AUTOCORR_stats are kept unless built with AUTOCORR_STATS=0
+#ifndef AUTOCORR_STATS
+#define AUTOCORR_STATS 1
+#endif
+
+// Maximum length of corrections including terminator, segmentation may add spaces
+#define AUTOCORR_CORRECTION_MAX (2 * AUTOCORR_LENGTH_MAX)
+
+// Maximum number of suggestions given by one call of AUTOCORR_ctx_suggest
+#define AUTOCORR_SUGGEST_MAX 64
+
+// Suggested correction of misspelled word
+typedef struct AUTOCORR_suggestion
+{
+    // Dictionary word, or several dictionary words separated by spaces if misspelling was split
+    char word[AUTOCORR_CORRECTION_MAX];
+
+    // Frequency of word in word data, 0 for split words
+    int frequency;
+
+    // Number of edits turning misspelled word into suggestion
+    int distance;
+} AUTOCORR_suggestion;
+
+// Loaded word data: immutable once loaded (unless words are learned), may be shared by any number of threads
+typedef struct AUTOCORR_dict AUTOCORR_dict;
+
+// Correction scratch state: one per thread, never shared
+typedef struct AUTOCORR_ctx AUTOCORR_ctx;
+
+// Work done by checks and corrections using a correction state, all 0 unless AUTOCORR_STATS
+typedef struct AUTOCORR_stats
+{
+    // Trie nodes visited by checks and correction searches
+    unsigned long nodes_visited;
+
+    // Dictionary words compared with misspelled words for corrections
+    unsigned long candidates_probed;
+} AUTOCORR_stats;
+
+// Cache of corrections of misspelled words: may be shared by any number of threads
+typedef struct AUTOCORR_cache AUTOCORR_cache;
+
+// Bigram context model of commonly confused words: immutable once loaded, may be shared by any number of threads
+typedef struct AUTOCORR_bigrams AUTOCORR_bigrams;
+
+/**
+ *
+ * Loads word frequency data into new dict.
+ * Maps precompiled binary image in place if present and up to date.
+ * Replays words learned since word data was written from delta log.
+ * Returns dict if successful else NULL.
+ *
+ */
+AUTOCORR_dict* AUTOCORR_dict_upload (void);
+
+/**
+ *
+ * Loads word frequency data into new dict in tiers, when it is parsed from word data file:
+ * the core_words most frequent words (20000 if 0) before returning, all words in background.
+ * Words found among most frequent ones are checked at once, other checks, corrections, learning
+ * and indexing wait until all words are loaded.
+ * Loads all words at once, as AUTOCORR_dict_upload, if binary image is used or words were
+ * learned since word data file was written.
+ * Returns dict if successful else NULL.
+ *
+ */
+AUTOCORR_dict* AUTOCORR_dict_upload_tiered (int core_words);
+
+/**
+ *
+ * Waits until all words of dict (of word data below it if dict is an overlay) are loaded.
+ * Returns true if they are, false if dict is NULL or loading words beyond most frequent ones of
+ * tiered dict failed, in which case words that are not among them are reported misspelled,
+ * and corrections, learning, indexing and AUTOCORR_dict_size fail.
+ *
+ */
+bool AUTOCORR_dict_wait (const AUTOCORR_dict* dict);
+
+/**
+ *
+ * Loads overlay file at path as new dict layered on top of base, which is neither copied nor
+ * changed, so several overlays may share one base. Lines of overlay file hold a word, optionally
+ * preceded by its frequency (default 1) as in word data file, or a word preceded by '-' which
+ * suppresses it in base. Checks and corrections using overlay consult it first, then base.
+ * Base (itself possibly an overlay) must stay loaded until overlay is unloaded, and its deletes
+ * index, if any, be built before.
+ * Overlays cannot learn words or build a deletes index, and correction caches must not be
+ * shared with contexts of other dicts.
+ * Returns dict if successful else NULL.
+ *
+ */
+AUTOCORR_dict* AUTOCORR_dict_overlay (const AUTOCORR_dict* base, const char* path);
+
+/**
+ *
+ * Checks if word is present in dict.
+ * Returns word frequency if word is in present in dict, else returns -1.
+ *
+ */
+int AUTOCORR_dict_check (const AUTOCORR_dict* dict, const char* word);
+
+/**
+ *
+ * Checks if first length characters of word, which need not be terminated or lowercase,
+ * are a word present in dict.
+ * Lets words be checked in place in text. Words of UTF-8 text are folded as by AUTOCORR_fold_word.
+ * Returns word frequency if word is in present in dict, else returns -1.
+ *
+ */
+int AUTOCORR_dict_check_span (const AUTOCORR_dict* dict, const char* word, size_t length);
+
+/**
+ *
+ * Folds first length bytes of UTF-8 word into folded (of folded_size bytes), terminated, as words
+ * are stored in dict: letters lowercase (simple Unicode case folding of Latin, Greek, Cyrillic and
+ * Armenian letters) and typographic apostrophes (U+2018, U+2019, U+02BC, U+FF07) as '.
+ * Words passed to correction functions are expected folded, learned words are folded when added.
+ * Returns length of folded word in bytes, -1 if word is not valid UTF-8 or does not fit.
+ *
+ */
+int AUTOCORR_fold_word (const char* word, size_t length, char* folded, size_t folded_size);
+
+/**
+ *
+ * Checks n words in dict, as AUTOCORR_check_words.
+ *
+ */
+void AUTOCORR_dict_check_words (const AUTOCORR_dict* dict, const char** words, const int* lens, int n, int* freqs_out);
+
+/**
+ *
+ * Builds symmetric-delete index of dict, as AUTOCORR_build_deletes_index.
+ * Must be called before dict is shared between threads.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_dict_build_deletes_index (AUTOCORR_dict* dict, int max_distance, size_t max_bytes);
+
+/**
+ *
+ * Adds counts[i] to frequency of words[i] in dict for each of n words, adding words not in dict.
+ * Words are kept as in word data: letters and apostrophes, folded as by AUTOCORR_fold_word, at most
+ * AUTOCORR_LENGTH_MAX long; other words and counts below 1 are skipped.
+ * Changes are prepared, then appended to delta log next to word data file, then made, so every
+ * later load replays them, and log is merged into word data file once it grows past log limit
+ * (1 MB unless set by AUTOCORR_dict_set_log_limit).
+ * Until then, every load that replays new words rebuilds trie, copying binary image in full
+ * instead of only mapping it.
+ * Known words are updated in place, new words make trie be rebuilt, so learn words in batches.
+ * Must not be called while other threads use dict. Cached corrections may be out of date after.
+ * Returns number of words learned, those not skipped, -1 if unsuccessful, dict and delta log
+ * being left unchanged.
+ *
+ */
+int AUTOCORR_dict_learn (AUTOCORR_dict* dict, const char** words, const int* counts, int n);
+
+/**
+ *
+ * Merges delta log of learned words into word data file (and binary image, if there is one),
+ * so later loads do not replay it.
+ * Assumes no other process learns words meanwhile.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_dict_compact (AUTOCORR_dict* dict);
+
+/**
+ *
+ * Sets size of delta log past which AUTOCORR_dict_learn merges it into word data file, 1 MB if
+ * max_bytes is 0. Smaller limits keep loads from binary image fast at the cost of merging more often.
+ *
+ */
+void AUTOCORR_dict_set_log_limit (AUTOCORR_dict* dict, size_t max_bytes);
+
+/**
+ *
+ * Gives number of unique words in dict, 0 if dict is NULL or its words could not be loaded.
+ *
+ */
+unsigned int AUTOCORR_dict_size (const AUTOCORR_dict* dict);
+
+/**
+ *
+ * Unloads dict from memory, only the overlay itself if dict is an overlay.
+ * All correction states and overlays using dict must be freed first.
+ *
+ */
+void AUTOCORR_dict_unload (AUTOCORR_dict* dict);
+
+/**
+ *
+ * Creates correction state using dict, with edit distance 1.
+ * Returns correction state if successful else NULL.
+ *
+ */
+AUTOCORR_ctx* AUTOCORR_ctx_new (const AUTOCORR_dict* dict);
+
+/**
+ *
+ * Sets maximum edit distance (1 to 3) of corrections found by trie search using ctx.
+ * Returns true if distance is supported else false.
+ *
+ */
+bool AUTOCORR_ctx_set_edit_distance (AUTOCORR_ctx* ctx, int max_distance);
+
+/**
+ *
+ * Checks n words in dict of ctx, as AUTOCORR_check_words.
+ * Counts work done in statistics of ctx.
+ *
+ */
+void AUTOCORR_ctx_check_words (AUTOCORR_ctx* ctx, const char** words, const int* lens, int n, int* freqs_out);
+
+/**
+ *
+ * Finds correction of misspelled word as AUTOCORR_correct_word, using only state in ctx.
+ * Copies correction into correction buffer of correction_size bytes
+ * (AUTOCORR_CORRECTION_MAX always suffices).
+ * Returns true if correction found, false if none found or it does not fit.
+ *
+ */
+bool AUTOCORR_ctx_correct (AUTOCORR_ctx* ctx, const char* word, char* correction, size_t correction_size);
+
+/**
+ *
+ * Finds up to k (at most AUTOCORR_SUGGEST_MAX) suggested corrections of misspelled word,
+ * within edit distance of ctx (or deletes index distance, if built), using only state in ctx.
+ * Copies suggestions into out, an array of k suggestions, closest first and most frequent
+ * first among equally close ones. The word itself is never suggested. If no word is close,
+ * gives word split into several words, as AUTOCORR_ctx_correct.
+ * Allocates no memory, and takes about as long for any k as for a single correction.
+ * Returns number of suggestions found.
+ *
+ */
+int AUTOCORR_ctx_suggest (AUTOCORR_ctx* ctx, const char* word, int k, AUTOCORR_suggestion* out);
+
+/**
+ *
+ * Frees correction state.
+ *
+ */
+void AUTOCORR_ctx_free (AUTOCORR_ctx* ctx);
+
+/**
+ *
+ * Copies work counters of all checks and corrections using ctx into stats.
+ *
+ */
+void AUTOCORR_ctx_stats (const AUTOCORR_ctx* ctx, AUTOCORR_stats* stats);
+
+/**
+ *
+ * Creates cache of corrections (including no suggestion results) of misspelled words,
+ * using at most max_bytes of memory (0 for default of 16 MB).
+ * Corrections not used recently are evicted once cache is full.
+ * Returns cache if successful else NULL.
+ *
+ */
+AUTOCORR_cache* AUTOCORR_cache_new (size_t max_bytes);
+
+/**
+ *
+ * Sets cache of corrections used by AUTOCORR_ctx_correct with ctx, NULL to not use any.
+ * Contexts of several threads may share one cache, if they use the same dict.
+ *
+ */
+void AUTOCORR_ctx_set_cache (AUTOCORR_ctx* ctx, AUTOCORR_cache* cache);
+
+/**
+ *
+ * Gives number of corrections found in cache (hits) and not found in cache (misses).
+ *
+ */
+void AUTOCORR_cache_stats (AUTOCORR_cache* cache, unsigned long* hits, unsigned long* misses);
+
+/**
+ *
+ * Frees correction cache.
+ * All correction states using cache must be freed first, or set to use no cache.
+ *
+ */
+void AUTOCORR_cache_free (AUTOCORR_cache* cache);
+
 /**
  *
  * Checks if word is present in word data trie.
@@ -32,28 +363,162 @@
  */
 int AUTOCORR_check_word (const char* word);
 
+/**
+ *
+ * Checks n words for presence in word data trie, words[i] being lens[i] characters long
+ * (need not be terminated or lowercase).
+ * Several lookups are advanced together to overlap their memory accesses, much faster than
+ * checking words one at a time for large batches (64 words or more).
+ * Sets freqs_out[i] to word frequency if word is present in trie, else to -1.
+ *
+ */
+void AUTOCORR_check_words (const char** words, const int* lens, int n, int* freqs_out);
+
 /**
  *
  * Loads word frequency data from file into trie data structure. 
+ * Maps precompiled binary image in place if present and up to date.
  * Returns true if successful else false.
  *
  */
 bool AUTOCORR_upload (void);
 
+/**
+ *
+ * Compiles word frequency data file into binary image for fast loading.
+ * Writes image to image_path, or to default image file if NULL.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_compile_data (const char* image_path);
+
+/**
+ *
+ * Compiles n words with frequencies into binary image at image_path, without word data file.
+ * Words must already be folded as by AUTOCORR_fold_word, as in word data, and at most
+ * AUTOCORR_LENGTH_MAX long; other words and frequencies below 1 are skipped.
+ * Image is only loaded in place of word data file not newer than it.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_compile_words (const char** words, const int* frequencies, int n, const char* image_path);
+
+/**
+ *
+ * Checks if first length characters of word, letters and apostrophes in any case, are a word
+ * of a set of commonly confused words (their, there, they're).
+ *
+ */
+bool AUTOCORR_confusable (const char* word, size_t length);
+
+/**
+ *
+ * Compiles bigram model of words of sets of commonly confused words into file at path.
+ * Words of n words with frequencies, as given to AUTOCORR_compile_words, give word ids of model,
+ * which is only loaded with word data of exactly those words.
+ * pairs[i] are two words separated by a space, counted counts[i] times next to each other in
+ * corpus; pairs of which neither word is confusable are skipped.
+ * Counts are stored as quantized logarithms, one byte each, sorted by word id.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_compile_bigrams (const char** words, const int* frequencies, int n,
+                               const char** pairs, const int* counts, int number_pairs, const char* path);
+
+/**
+ *
+ * Loads bigram model at path (default model file next to word data if NULL) for dict,
+ * mapping it in place. Model must have been compiled with words of dict, before any were learned.
+ * Dict must stay loaded while model is used.
+ * Returns model if successful else NULL.
+ *
+ */
+AUTOCORR_bigrams* AUTOCORR_bigrams_load (const AUTOCORR_dict* dict, const char* path);
+
+/**
+ *
+ * Gives index of first length characters of word (letters and apostrophes, in any case)
+ * among confusable words of model, rejecting most other words by first letter and length alone.
+ * Returns -1 if word is not in model.
+ *
+ */
+int AUTOCORR_bigrams_find (const AUTOCORR_bigrams* model, const char* word, size_t length);
+
+/**
+ *
+ * Scores each word of confusion set of word (index given by AUTOCORR_bigrams_find) between
+ * previous word prev and next word next, of prev_length and next_length characters (letters and
+ * apostrophes in any case, NULL if there is none), by counts of pairs with either neighbor.
+ * Returns word of set seen next to either neighbor and much more probable there than word,
+ * NULL if there is none.
+ *
+ */
+const char* AUTOCORR_bigrams_alternative (const AUTOCORR_bigrams* model, int word, const char* prev, size_t prev_length,
+                                          const char* next, size_t next_length);
+
+/**
+ *
+ * Unloads bigram model from memory.
+ *
+ */
+void AUTOCORR_bigrams_unload (AUTOCORR_bigrams* model);
+
+/**
+ *
+ * Adds counts[i] to frequency of words[i] in word data for each of n words, as AUTOCORR_dict_learn.
+ * Forgets cached corrections, which learned words may change.
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_learn_words (const char** words, const int* counts, int n);
+
 /**
  *
  * Edit distance between two words: number of edits to turn one into the other.
  * Can be deletion (remove one letter), transposition (swap adjacent letters), 
  * alteration (change one letter to another) or insertion (add a letter)
  *
- * Finds words with edit distance = 1
- * Returns word with highest probability value as per word frequency data trie as suggested
- * correction for misspelled word.
+ * Finds words within edit distance set by AUTOCORR_set_edit_distance (default 1) with a
+ * single bounded search of the trie, or within deletes index distance if index is built
+ * Returns closest word with highest probability value as per word frequency data trie as suggested
+ * correction for misspelled word, in a buffer overwritten by the next call.
+ * Not thread-safe, use AUTOCORR_ctx_correct with one ctx per thread instead.
  * Returns NULL in case of error.
  *
  */
 char* AUTOCORR_correct_word (const char* word);
 
+/**
+ *
+ * Finds up to k suggested corrections of misspelled word, as AUTOCORR_ctx_suggest.
+ * Not thread-safe, use AUTOCORR_ctx_suggest with one ctx per thread instead.
+ * Returns number of suggestions found, 0 if word data is not loaded.
+ *
+ */
+int AUTOCORR_suggest (const char* word, int k, AUTOCORR_suggestion* out);
+
+/**
+ *
+ * Sets maximum edit distance (1 to 3) of corrections found by trie search.
+ * Closer words are always preferred over more probable words further away.
+ * Returns true if distance is supported else false.
+ *
+ */
+bool AUTOCORR_set_edit_distance (int max_distance);
+
+/**
+ *
+ * Builds symmetric-delete index of word data, precomputing strings obtained by deleting
+ * up to max_distance (1-3) letters from each word.
+ * AUTOCORR_correct_word then finds closest words within max_distance with a few hash probes,
+ * highest probability first among equally close words.
+ * Only a prefix of each word is indexed, longest prefix keeping index within max_bytes of
+ * memory (0 for default of 256 MB).
+ * Returns true if successful else false.
+ *
+ */
+bool AUTOCORR_build_deletes_index (int max_distance, size_t max_bytes);
+
 /**
  *
  * Gives size of word frequncy data
@@ -130,9 +130,22 @@ if __name__ == '__main__':
         print("Usage: spellcheck /path/to/file_name.pdf")
         print("Usage: spellcheck /path/to/directory_name")
 
+    # Check files on resident server if one is running (spellcheck --serve socket_file)
+    # Word data is then loaded once instead of once per file
+    server_socket = os.environ.get("SPELLCHECK_SOCKET")
+    server_option = ""
+    if server_socket and os.path.exists(server_socket):
+        server_option = "--connect {socket} ".format(socket=server_socket)
+
     chdir("../src/")
-    for file in files_list:
-        cmd_autocorrect = "./spellcheck {check_file}".format(check_file=file)
-        print("File: ", file)
+    if server_option:
+        for file in files_list:
+            cmd_autocorrect = "./spellcheck {option}{check_file}".format(option=server_option, check_file=file)
+            print("File: ", file)
+            system(cmd_autocorrect)
+            print("")
+
+    # Check all files with a single process, loading word data once
+    elif files_list:
+        cmd_autocorrect = "./spellcheck {check_files}".format(check_files=" ".join(files_list))
         system(cmd_autocorrect)
-        print("")
@@ -0,0 +1,476 @@
+/**
+ * batch.c
+ *
+ * Implements checking of several text files and directories of text files.
+ * Worker threads take files in order, each checking whole files with its own correction state,
+ * while the calling thread prints reports of finished files in order.
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+// strdup, lstat
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "batch.h"
+#include "input.h"
+
+// Files checked ahead of report printed, per thread, bounding memory held by reports
+#define BATCH_WINDOW 4
+
+/**
+ * Result of checking one file, printed once done.
+ */
+typedef struct
+{
+    char* report;
+    size_t report_len;
+    int misspellings;
+    int num_words;
+
+    bool unreadable;
+    bool failed;
+    bool done;
+} file_result;
+
+/**
+ * Files being checked, shared by worker threads and printing thread.
+ */
+typedef struct
+{
+    const file_list* files;
+    file_result* results;
+
+    // Files taken by workers and printed so far, workers stay within window of printed files
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int next;
+    int printed;
+    int window;
+
+    // Files taken by other threads before this thread takes its next file
+    int ahead;
+} batch;
+
+/**
+ * Worker thread checking files with correction state of job.
+ */
+typedef struct
+{
+    batch* b;
+    chunk_job* job;
+} worker;
+
+/**
+ *
+ * Adds copy of path to files.
+ * Returns true if successful else false.
+ *
+ */
+static bool add_file (file_list* files, const char* path)
+{
+    if (files -> count == files -> capacity)
+    {
+        int capacity = files -> capacity > 0 ? 2 * files -> capacity : 64;
+        char** paths = realloc (files -> paths, capacity * sizeof (char*));
+        if (paths == NULL)
+            return false;
+
+        files -> paths = paths;
+        files -> capacity = capacity;
+    }
+
+    if ((files -> paths[files -> count] = strdup (path)) == NULL)
+        return false;
+
+    files -> count++;
+    return true;
+}
+
+/**
+ *
+ * Returns true if extension of file name is one of comma-separated extensions, or extensions is "*".
+ *
+ */
+static bool has_extension (const char* name, const char* extensions)
+{
+    if (strcmp (extensions, "*") == 0)
+        return true;
+
+    const char* dot = strrchr (name, '.');
+    if (dot == NULL)
+        return false;
+
+    size_t length = strlen (++dot);
+    for (const char* e = extensions; *e != '\0'; )
+    {
+        size_t e_length = strcspn (e, ",");
+        if (e_length == length && strncmp (e, dot, length) == 0)
+            return true;
+
+        e += e_length + (e[e_length] == ',');
+    }
+
+    return false;
+}
+
+/**
+ *
+ * Orders strings pointed to by a and b, for qsort.
+ *
+ */
+static int compare_names (const void* a, const void* b)
+{
+    return strcmp (*(char* const*) a, *(char* const*) b);
+}
+
+/**
+ *
+ * Adds files with one of extensions in directory at path and its subdirectories, in name order.
+ * Returns true if successful else false.
+ *
+ */
+static bool walk_directory (file_list* files, const char* path, const char* extensions)
+{
+    DIR* dir = opendir (path);
+    if (dir == NULL)
+    {
+        printf ("Could not open directory - %s.\n", path);
+        return false;
+    }
+
+    // Names of entries, sorted so order does not depend on file system
+    file_list names = {NULL, 0, 0};
+    bool listed = true;
+    for (struct dirent* entry; listed && (entry = readdir (dir)) != NULL; )
+        if (entry -> d_name[0] != '.')
+            listed = add_file (&names, entry -> d_name);
+    closedir (dir);
+
+    qsort (names.paths, names.count, sizeof (char*), compare_names);
+
+    size_t path_len = strlen (path);
+    bool slash = (path_len > 0 && path[path_len - 1] == '/');
+
+    for (int i = 0; i < names.count && listed; i++)
+    {
+        char* entry_path = malloc (path_len + strlen (names.paths[i]) + 2);
+        if (entry_path == NULL)
+        {
+            listed = false;
+            break;
+        }
+        sprintf (entry_path, "%s%s%s", path, slash ? "" : "/", names.paths[i]);
+
+        // Links are followed to files only, never to directories
+        struct stat info;
+        if (lstat (entry_path, &info) == 0)
+        {
+            if (S_ISDIR (info.st_mode))
+                listed = walk_directory (files, entry_path, extensions);
+            else if (S_ISLNK (info.st_mode) && stat (entry_path, &info) != 0)
+                info.st_mode = 0;
+
+            if (S_ISREG (info.st_mode) && has_extension (names.paths[i], extensions))
+                listed = add_file (files, entry_path);
+        }
+
+        free (entry_path);
+    }
+
+    free_files (&names);
+
+    if (!listed)
+        printf ("Out of memory. Files could not be listed.\n");
+    return listed;
+}
+
+/**
+ *
+ * Adds n paths to files, walking directories.
+ * Returns true if successful else false.
+ *
+ */
+bool list_files (file_list* files, char* const* paths, int n, const char* extensions)
+{
+    for (int i = 0; i < n; i++)
+    {
+        // Files that cannot be opened are reported when checked
+        struct stat info;
+        if (stat (paths[i], &info) == 0 && S_ISDIR (info.st_mode))
+        {
+            if (!walk_directory (files, paths[i], extensions))
+                return false;
+        }
+        else if (!add_file (files, paths[i]))
+        {
+            printf ("Out of memory. Files could not be listed.\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Frees list of text files.
+ *
+ */
+void free_files (file_list* files)
+{
+    for (int i = 0; i < files -> count; i++)
+        free (files -> paths[i]);
+
+    free (files -> paths);
+    memset (files, 0, sizeof (file_list));
+}
+
+/**
+ *
+ * Spell-checks text file at path, index of file in list, with job, storing its report in result.
+ * Report buffer of job is handed over to result.
+ *
+ */
+static void check_file (chunk_job* job, const char* path, int index, file_result* result)
+{
+    text_input input;
+    if (!open_input (&input, path))
+    {
+        result -> unreadable = true;
+        return;
+    }
+
+    // File name as field of report lines, positions counted from start of file
+    char* field = escape_field (path, job -> format);
+    if (field == NULL)
+    {
+        close_input (&input);
+        result -> failed = job -> failed = true;
+        printf ("Out of memory. Text could not be checked.\n");
+        return;
+    }
+
+    job -> file = field;
+    job -> file_len = strlen (field);
+    job -> file_index = index;
+    job -> position = (text_position) {0, 1, 0};
+
+    int misspellings = job -> misspellings;
+    int num_words = job -> num_words;
+    job -> report_len = 0;
+
+    // Check text batch by batch, report growing over whole file
+    size_t batch_size = CHUNK_SIZE;
+    for (bool last = false; !last && !job -> failed; )
+    {
+        const char* batch;
+        size_t filled, end;
+        if (!read_words (&input, &batch_size, &batch, &filled, &end, &last))
+        {
+            job -> failed = true;
+            break;
+        }
+
+        job -> text = batch;
+        job -> size = end;
+        batch_bounds (&input, batch, filled, &job -> context_start, &job -> context_end);
+        check_chunk (job);
+
+        consume_batch (&input, filled, end);
+    }
+
+    close_input (&input);
+
+    job -> file = NULL;
+    job -> file_len = 0;
+    job -> context_start = job -> context_end = NULL;
+    free (field);
+
+    result -> failed = job -> failed;
+    result -> misspellings = job -> misspellings - misspellings;
+    result -> num_words = job -> num_words - num_words;
+    result -> report = job -> report;
+    result -> report_len = job -> report_len;
+
+    job -> report = NULL;
+    job -> report_len = 0;
+    job -> report_size = 0;
+}
+
+/**
+ *
+ * Checks files in order until none are left or a check fails.
+ * Takes worker* as void* so it can be run as thread, returns NULL.
+ *
+ */
+static void* check_worker (void* arg)
+{
+    worker* w = arg;
+    batch* b = w -> b;
+    int count = b -> files -> count;
+
+    pthread_mutex_lock (&b -> lock);
+    while (b -> next < count && !w -> job -> failed)
+    {
+        // Wait for reports to be printed before checking too far ahead
+        if (b -> next >= b -> printed + b -> window)
+        {
+            pthread_cond_wait (&b -> changed, &b -> lock);
+            continue;
+        }
+
+        int i = b -> next++;
+        pthread_mutex_unlock (&b -> lock);
+
+        // File this thread will likely take next is read while this one is checked
+        if (i + b -> ahead < count)
+            prefetch_input (b -> files -> paths[i + b -> ahead]);
+
+        check_file (w -> job, b -> files -> paths[i], i, &b -> results[i]);
+
+        pthread_mutex_lock (&b -> lock);
+        b -> results[i].done = true;
+        pthread_cond_broadcast (&b -> changed);
+    }
+
+    // Files left unchecked after failure are marked done, so printing ends
+    if (w -> job -> failed)
+        for (; b -> next < count; b -> next++)
+            b -> results[b -> next].done = b -> results[b -> next].failed = true;
+
+    pthread_cond_broadcast (&b -> changed);
+    pthread_mutex_unlock (&b -> lock);
+
+    return NULL;
+}
+
+/**
+ *
+ * Prints report of file at path, checked with job.
+ * Other formats than text give report lines only, unreadable files being reported on standard error,
+ * and unique misspellings are printed once all files are checked.
+ *
+ */
+static void print_result (const char* path, const file_result* result, const chunk_job* job)
+{
+    if (job -> format != FORMAT_TEXT || job -> unique != NULL)
+    {
+        if (result -> unreadable)
+            fprintf (stderr, "Could not open text file - %s.\n", path);
+        else if (job -> unique == NULL)
+            fwrite (result -> report, 1, result -> report_len, stdout);
+        return;
+    }
+
+    printf ("\nFile: %s\n", path);
+    if (result -> unreadable)
+    {
+        printf ("Could not open text file - %s.\n", path);
+        return;
+    }
+
+    printf ("\nMisspelled Words\n\n");
+    fwrite (result -> report, 1, result -> report_len, stdout);
+    printf ("\nWORDS MISSPELLED: %d    WORDS IN TEXT: %d\n", result -> misspellings, result -> num_words);
+}
+
+/**
+ *
+ * Spell-checks files on jobs threads, printing reports in order of files.
+ * Returns true if successful else false.
+ *
+ */
+bool check_files (const file_list* files, chunk_job* job, int jobs, int* unreadable)
+{
+    batch b;
+    b.files = files;
+    b.results = calloc (files -> count + 1, sizeof (file_result));
+    b.next = 0;
+    b.printed = 0;
+    b.window = BATCH_WINDOW * jobs;
+    b.ahead = jobs;
+    *unreadable = 0;
+
+    if (b.results == NULL)
+    {
+        printf ("Out of memory. Text could not be checked.\n");
+        return false;
+    }
+
+    pthread_mutex_init (&b.lock, NULL);
+    pthread_cond_init (&b.changed, NULL);
+
+    // One worker per job
+    worker w[jobs];
+    pthread_t thread[jobs];
+    int started = 0;
+
+    for (int i = 0; i < jobs; i++)
+    {
+        w[i].b = &b;
+        w[i].job = &job[i];
+        if (pthread_create (&thread[started], NULL, check_worker, &w[i]) == 0)
+            started++;
+    }
+
+    // Without threads, check all files before printing
+    if (started == 0)
+    {
+        b.window = files -> count;
+        check_worker (&w[0]);
+    }
+
+    bool failed = false;
+    for (int i = 0; i < files -> count && !failed; i++)
+    {
+        // Wait for file to be checked
+        pthread_mutex_lock (&b.lock);
+        while (!b.results[i].done)
+            pthread_cond_wait (&b.changed, &b.lock);
+        pthread_mutex_unlock (&b.lock);
+
+        failed = b.results[i].failed;
+        if (!failed)
+            print_result (files -> paths[i], &b.results[i], job);
+        *unreadable += b.results[i].unreadable;
+
+        free (b.results[i].report);
+        b.results[i].report = NULL;
+
+        pthread_mutex_lock (&b.lock);
+        b.printed++;
+        pthread_cond_broadcast (&b.changed);
+        pthread_mutex_unlock (&b.lock);
+    }
+
+    // Stop workers after failure, freeing reports not printed
+    if (failed)
+    {
+        pthread_mutex_lock (&b.lock);
+        b.next = files -> count;
+        b.printed = files -> count;
+        pthread_cond_broadcast (&b.changed);
+        pthread_mutex_unlock (&b.lock);
+    }
+
+    for (int i = 0; i < started; i++)
+        pthread_join (thread[i], NULL);
+
+    for (int i = 0; i < files -> count; i++)
+        free (b.results[i].report);
+    free (b.results);
+
+    pthread_cond_destroy (&b.changed);
+    pthread_mutex_destroy (&b.lock);
+
+    return !failed;
+}
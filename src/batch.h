@@ -0,0 +1,65 @@
+/**
+ * batch.h
+ *
+ * Checking of several text files and directories of text files, one file per thread
+ * Word data is loaded once for all files, reports are printed in order of files
+ *
+ * file_list - text files to be checked, in order of report
+ * list_files - find text files named or in directories walked recursively
+ * free_files - free list of text files
+ * check_files - spell-check and report text files on several threads
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+
+#include "checker.h"
+
+// Extensions of text files checked in directories, unless set with --ext
+#define BATCH_EXTENSIONS "txt,md"
+
+/**
+ * Text files to be checked, in order of report.
+ */
+typedef struct
+{
+    char** paths;
+    int count;
+    int capacity;
+} file_list;
+
+/**
+ *
+ * Adds n paths to files in order given.
+ * Directories are walked recursively in name order, adding files with one of
+ * comma-separated extensions ("*" for any), skipping hidden entries and links to directories.
+ * Named files are added whatever their extension.
+ * Returns true if successful else false.
+ *
+ */
+bool list_files (file_list* files, char* const* paths, int n, const char* extensions);
+
+/**
+ *
+ * Frees list of text files.
+ *
+ */
+void free_files (file_list* files);
+
+/**
+ *
+ * Spell-checks files, each on one of jobs threads with correction state of its job.
+ * Prints report of each file in order of files, while later files are being checked.
+ * Sets *unreadable to number of files that could not be read, reported in place of their report.
+ * Returns true if successful else false.
+ *
+ */
+bool check_files (const file_list* files, chunk_job* job, int jobs, int* unreadable);
+
+#endif // BATCH_H
@@ -0,0 +1,837 @@
+/**
+ * bench.c
+ *
+ * Benchmark suite of autocorrect library.
+ * Generates deterministic corpora from word data, measures load, check, correct,
+ * segmentation and unload times over several runs, peak memory and correction accuracy.
+ * Writes results as JSON so runs can be compared across changes.
+ *
+ * Run from src directory, where word data is found, as done by 'make bench':
+ *
+ *     bench/bench [-r runs] [-o results_file]
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "../../autocorrect-lib/autocorrect.h"
+#include "../stats.h"
+
+// Word frequency data corpora are generated from
+#define WORD_DATA "../autocorrect-lib/data-files/word_data.txt"
+
+// Generated corpora, labeled misspellings shipped with suite and default results file
+#define CORPORA_DIR "bench/corpora"
+#define MISSPELLED_TEXT "misspelled.txt"
+#define LABELED_SET "bench/misspellings.tsv"
+#define RESULTS_FILE "bench/results.json"
+
+// Number of runs of each measurement
+#define RUNS_DEFAULT 3
+#define RUNS_MAX 32
+
+// Words of generated corpora
+#define CLEAN_WORDS 1000000
+#define HEAVY_WORDS 100000
+#define LONG_WORDS 20000
+
+// One in HEAVY_RATE words of heavy corpus is misspelled
+#define HEAVY_RATE 4
+
+// Generated misspellings of accuracy sets, drawn from most frequent words
+#define ACCURACY_CASES 2000
+#define ACCURACY_CASES_FAR 500
+#define ACCURACY_RANKS 20000
+
+// Generated run-together words of segmentation accuracy set
+#define ACCURACY_CASES_JOINED 1000
+
+// Generated misspellings holding punctuation or digits whose suggestion distances are checked
+#define DISTANCE_CASES 1000
+#define DISTANCE_SUGGESTIONS 16
+
+// Words checked together, as by spellcheck
+#define CHECK_BATCH 64
+
+// Seed of generators, fixed so corpora are identical on every run
+#define SEED 0x5eed5eed5eedULL
+
+/**
+ * Words of word data, most frequent first, with running total of frequencies.
+ */
+typedef struct vocabulary
+{
+    char** words;
+    unsigned long long* cumulative;
+    int count;
+} vocabulary;
+
+/**
+ * Words of corpus, lowercase and terminated in place in text.
+ */
+typedef struct corpus
+{
+    const char* name;
+    char* text;
+    size_t bytes;
+
+    const char** words;
+    int* lens;
+    int count;
+} corpus;
+
+/**
+ * Times of one measurement over all runs, in seconds.
+ */
+typedef struct timing
+{
+    double runs[RUNS_MAX];
+    int count;
+} timing;
+
+// State of pseudo-random generator (xorshift64*)
+static unsigned long long rng_state = SEED;
+
+/**
+ *
+ * Gives next pseudo-random number.
+ *
+ */
+static unsigned long long rng_next (void)
+{
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 2685821657736338717ULL;
+}
+
+/**
+ *
+ * Gives pseudo-random number below n.
+ *
+ */
+static unsigned long long rng_below (unsigned long long n)
+{
+    return rng_next () % n;
+}
+
+/**
+ *
+ * Loads words of word data file that spellcheck can check, with their frequencies.
+ * Returns true if successful else false.
+ *
+ */
+static bool load_vocabulary (vocabulary* vocab)
+{
+    FILE* file = fopen (WORD_DATA, "r");
+    if (file == NULL)
+        return false;
+
+    int capacity = 4096;
+    vocab -> words = malloc (capacity * sizeof (char*));
+    vocab -> cumulative = malloc (capacity * sizeof (unsigned long long));
+    vocab -> count = 0;
+
+    unsigned long long total = 0;
+    unsigned long frequency;
+    char word[256];
+
+    while (fscanf (file, "%lu %255s", &frequency, word) == 2)
+    {
+        // Keep words of letters and apostrophes only, as tokenized by spellcheck
+        int len = strlen (word);
+        bool valid = (len <= AUTOCORR_LENGTH_MAX && isalpha ((unsigned char) word[0]));
+        for (int i = 0; i < len && valid; i++)
+            valid = (isalpha ((unsigned char) word[i]) || word[i] == '\'');
+
+        if (!valid || frequency == 0)
+            continue;
+
+        if (vocab -> count == capacity)
+        {
+            capacity *= 2;
+            vocab -> words = realloc (vocab -> words, capacity * sizeof (char*));
+            vocab -> cumulative = realloc (vocab -> cumulative, capacity * sizeof (unsigned long long));
+        }
+
+        total += frequency;
+        vocab -> words[vocab -> count] = strdup (word);
+        vocab -> cumulative[vocab -> count] = total;
+        vocab -> count++;
+    }
+
+    fclose (file);
+    return vocab -> count > 0;
+}
+
+/**
+ *
+ * Gives word of vocabulary drawn with probability proportional to its frequency.
+ *
+ */
+static const char* sample_word (const vocabulary* vocab)
+{
+    unsigned long long r = rng_below (vocab -> cumulative[vocab -> count - 1]);
+
+    // First word with running total above r
+    int low = 0, high = vocab -> count - 1;
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (vocab -> cumulative[mid] > r)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    return vocab -> words[low];
+}
+
+/**
+ *
+ * Copies word into out with edits random edits: deletion, transposition, alteration or insertion.
+ *
+ */
+static void misspell (const char* word, int edits, char* out)
+{
+    strcpy (out, word);
+
+    for (int e = 0; e < edits; e++)
+    {
+        int len = strlen (out);
+        int at = rng_below (len);
+        char letter = 'a' + rng_below (26);
+
+        switch (rng_below (4))
+        {
+            // Deletion, keeping at least one letter
+            case 0:
+                if (len > 1)
+                {
+                    memmove (out + at, out + at + 1, len - at);
+                    break;
+                }
+
+            // Transposition, if there is a following letter
+            // fall through
+            case 1:
+                if (at + 1 < len && out[at] != out[at + 1])
+                {
+                    char c = out[at];
+                    out[at] = out[at + 1];
+                    out[at + 1] = c;
+                    break;
+                }
+
+            // Alteration
+            // fall through
+            case 2:
+                out[at] = (out[at] == letter) ? 'a' + (letter - 'a' + 1) % 26 : letter;
+                break;
+
+            // Insertion, within maximum word length
+            default:
+                if (len < AUTOCORR_LENGTH_MAX)
+                {
+                    memmove (out + at + 1, out + at, len - at + 1);
+                    out[at] = letter;
+                }
+                break;
+        }
+    }
+}
+
+/**
+ *
+ * Writes text of count words drawn from vocabulary, as lines of a dozen words.
+ * One in misspell_rate words is misspelled, none if 0.
+ * Long corpus joins two or three words without spaces, with occasional runs too long to be words.
+ * Returns true if successful else false.
+ *
+ */
+static bool write_corpus (const vocabulary* vocab, const char* name, int count, int misspell_rate, bool joined)
+{
+    char path[256];
+    snprintf (path, sizeof (path), "%s/%s.txt", CORPORA_DIR, name);
+
+    FILE* file = fopen (path, "w");
+    if (file == NULL)
+        return false;
+
+    char word[AUTOCORR_LENGTH_MAX * 3 + 1];
+    for (int i = 0; i < count; i++)
+    {
+        if (joined && rng_below (10) == 0)
+        {
+            // Alphabetical run too long to be a word, skipped by spellcheck
+            int len = AUTOCORR_LENGTH_MAX + 1 + rng_below (40);
+            for (int j = 0; j < len; j++)
+                word[j] = 'a' + rng_below (26);
+            word[len] = '\0';
+        }
+        else if (joined)
+        {
+            // Words with missing spaces, corrected by segmentation
+            strcpy (word, sample_word (vocab));
+            for (int parts = 1 + rng_below (2); parts > 0; parts--)
+            {
+                const char* next = sample_word (vocab);
+                if (strlen (word) + strlen (next) <= AUTOCORR_LENGTH_MAX)
+                    strcat (word, next);
+            }
+        }
+        else if (misspell_rate > 0 && rng_below (misspell_rate) == 0)
+            misspell (sample_word (vocab), 1 + rng_below (2), word);
+        else
+            strcpy (word, sample_word (vocab));
+
+        fprintf (file, "%s%s", word, (i % 12 == 11) ? ".\n" : " ");
+    }
+
+    fprintf (file, "\n");
+    return fclose (file) == 0;
+}
+
+/**
+ *
+ * Reads corpus from file at path, splitting it into lowercase words.
+ * Words are runs of letters and apostrophes, runs longer than maximum word length are skipped.
+ * Returns true if successful else false.
+ *
+ */
+static bool read_corpus (const char* name, const char* path, corpus* c)
+{
+    FILE* file = fopen (path, "r");
+    if (file == NULL)
+        return false;
+
+    fseek (file, 0, SEEK_END);
+    c -> bytes = ftell (file);
+    fseek (file, 0, SEEK_SET);
+
+    c -> name = name;
+    c -> text = malloc (c -> bytes + 1);
+    c -> words = malloc ((c -> bytes / 2 + 1) * sizeof (char*));
+    c -> lens = malloc ((c -> bytes / 2 + 1) * sizeof (int));
+    c -> count = 0;
+
+    bool read = (fread (c -> text, 1, c -> bytes, file) == c -> bytes);
+    fclose (file);
+    if (!read)
+        return false;
+    c -> text[c -> bytes] = '\0';
+
+    for (size_t i = 0; i < c -> bytes; )
+    {
+        if (!isalpha ((unsigned char) c -> text[i]))
+        {
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        while (i < c -> bytes && (isalpha ((unsigned char) c -> text[i]) || c -> text[i] == '\''))
+        {
+            c -> text[i] = tolower ((unsigned char) c -> text[i]);
+            i++;
+        }
+
+        if (i - start <= AUTOCORR_LENGTH_MAX)
+        {
+            c -> words[c -> count] = c -> text + start;
+            c -> lens[c -> count] = i - start;
+            c -> count++;
+        }
+
+        // Terminate word in place of character ending it
+        c -> text[i] = '\0';
+        i++;
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Gives smallest time of all runs.
+ *
+ */
+static double timing_min (const timing* t)
+{
+    double min = t -> runs[0];
+    for (int i = 1; i < t -> count; i++)
+        if (t -> runs[i] < min)
+            min = t -> runs[i];
+
+    return min;
+}
+
+/**
+ *
+ * Gives median time of all runs.
+ *
+ */
+static double timing_median (const timing* t)
+{
+    double sorted[RUNS_MAX];
+    memcpy (sorted, t -> runs, t -> count * sizeof (double));
+
+    for (int i = 1; i < t -> count; i++)
+        for (int j = i; j > 0 && sorted[j - 1] > sorted[j]; j--)
+        {
+            double tmp = sorted[j];
+            sorted[j] = sorted[j - 1];
+            sorted[j - 1] = tmp;
+        }
+
+    return sorted[t -> count / 2];
+}
+
+/**
+ *
+ * Writes timing as JSON object, with rate of items per second by fastest run.
+ *
+ */
+static void write_timing (FILE* out, const char* name, const timing* t, long items, const char* last)
+{
+    double min = timing_min (t);
+
+    fprintf (out, "      \"%s\": {\"seconds_min\": %.6f, \"seconds_median\": %.6f", name, min, timing_median (t));
+    if (items >= 0)
+        fprintf (out, ", \"items\": %ld, \"per_second\": %.0f", items, min > 0 ? items / min : 0.0);
+    fprintf (out, "}%s\n", last);
+}
+
+/**
+ *
+ * Measures checking and correcting of corpus with ctx over runs runs.
+ * Writes results as JSON object.
+ *
+ */
+static void bench_corpus (FILE* out, AUTOCORR_ctx* ctx, const corpus* c, int runs, const char* last)
+{
+    int* freqs = malloc ((c -> count + 1) * sizeof (int));
+    timing check = {.count = runs}, correct = {.count = runs};
+    histogram latency;
+    memset (&latency, 0, sizeof (latency));
+
+    // Check all words in batches
+    for (int r = 0; r < runs; r++)
+    {
+        uint64_t before = stats_now ();
+        for (int i = 0; i < c -> count; i += CHECK_BATCH)
+        {
+            int n = (c -> count - i < CHECK_BATCH) ? c -> count - i : CHECK_BATCH;
+            AUTOCORR_ctx_check_words (ctx, c -> words + i, c -> lens + i, n, freqs + i);
+        }
+        check.runs[r] = (stats_now () - before) / NANO_TO_S;
+    }
+
+    // Correct every misspelled word
+    int misspelled = 0, suggested = 0;
+    char correction[AUTOCORR_CORRECTION_MAX];
+
+    for (int r = 0; r < runs; r++)
+    {
+        uint64_t before = stats_now ();
+        for (int i = 0; i < c -> count; i++)
+        {
+            if (freqs[i] != -1)
+                continue;
+
+            uint64_t start = stats_now ();
+            bool found = AUTOCORR_ctx_correct (ctx, c -> words[i], correction, sizeof (correction));
+            histogram_add (&latency, stats_now () - start);
+
+            if (r == 0)
+            {
+                misspelled++;
+                suggested += found;
+            }
+        }
+        correct.runs[r] = (stats_now () - before) / NANO_TO_S;
+    }
+
+    fprintf (out, "    \"%s\": {\n", c -> name);
+    fprintf (out, "      \"bytes\": %lu, \"words\": %d, \"misspelled\": %d, \"suggested\": %d,\n",
+             (unsigned long) c -> bytes, c -> count, misspelled, suggested);
+    write_timing (out, "check", &check, c -> count, ",");
+    write_timing (out, "correct", &correct, misspelled, ",");
+    fprintf (out, "      \"correct_latency_ns\": {\"p50\": %lu, \"p99\": %lu, \"max\": %lu}\n",
+             (unsigned long) histogram_percentile (&latency, 0.50),
+             (unsigned long) histogram_percentile (&latency, 0.99), (unsigned long) latency.max);
+    fprintf (out, "    }%s\n", last);
+
+    printf ("%-12s %9d words %7d misspelled   check %8.0f words/s   correct %8.0f words/s\n", c -> name,
+            c -> count, misspelled, c -> count / timing_min (&check),
+            misspelled > 0 ? misspelled / timing_min (&correct) : 0.0);
+
+    free (freqs);
+}
+
+/**
+ *
+ * Measures accuracy of corrections of cases misspellings generated with edits edits,
+ * drawn from most frequent words, corrected within edit distance of ctx.
+ * Writes result as JSON object.
+ *
+ */
+static void bench_generated_accuracy (FILE* out, const AUTOCORR_dict* dict, AUTOCORR_ctx* ctx,
+                                      const vocabulary* vocab, int edits, int cases, const char* last)
+{
+    char word[AUTOCORR_LENGTH_MAX + 1], correction[AUTOCORR_CORRECTION_MAX];
+    int ranks = (vocab -> count < ACCURACY_RANKS) ? vocab -> count : ACCURACY_RANKS;
+    int tried = 0, right = 0;
+
+    for (int attempts = 0; tried < cases && attempts < 100 * cases; attempts++)
+    {
+        const char* intended = vocab -> words[rng_below (ranks)];
+        if (strlen (intended) < 4)
+            continue;
+
+        // Misspellings that are words themselves cannot be detected
+        misspell (intended, edits, word);
+        if (AUTOCORR_dict_check (dict, word) != -1)
+            continue;
+
+        tried++;
+        if (AUTOCORR_ctx_correct (ctx, word, correction, sizeof (correction)) && strcmp (correction, intended) == 0)
+            right++;
+    }
+
+    fprintf (out, "    \"edit%d\": {\"cases\": %d, \"correct\": %d, \"accuracy\": %.4f}%s\n", edits, tried, right,
+             tried > 0 ? (double) right / tried : 0.0, last);
+    printf ("accuracy     %d edit%s: %d of %d corrected (%.1f %%)\n", edits, edits > 1 ? "s" : "", right, tried,
+            tried > 0 ? 100.0 * right / tried : 0.0);
+}
+
+/**
+ *
+ * Measures accuracy of segmentation of cases words generated by joining two or three frequent words.
+ * Correction must give joined words separated by spaces.
+ * Writes result as JSON object.
+ *
+ */
+static void bench_segmentation_accuracy (FILE* out, const AUTOCORR_dict* dict, AUTOCORR_ctx* ctx,
+                                         const vocabulary* vocab, int cases, const char* last)
+{
+    char word[AUTOCORR_LENGTH_MAX + 1], intended[AUTOCORR_CORRECTION_MAX], correction[AUTOCORR_CORRECTION_MAX];
+    int ranks = (vocab -> count < ACCURACY_RANKS) ? vocab -> count : ACCURACY_RANKS;
+    int tried = 0, right = 0;
+
+    for (int attempts = 0; tried < cases && attempts < 100 * cases; attempts++)
+    {
+        word[0] = intended[0] = '\0';
+        for (int parts = 2 + rng_below (2); parts > 0; parts--)
+        {
+            const char* next = vocab -> words[rng_below (ranks)];
+            if (strlen (next) < 4 || strlen (word) + strlen (next) > AUTOCORR_LENGTH_MAX)
+                continue;
+
+            strcat (word, next);
+            if (intended[0] != '\0')
+                strcat (intended, " ");
+            strcat (intended, next);
+        }
+
+        // Joined words that are words themselves need no segmentation
+        if (strchr (intended, ' ') == NULL || AUTOCORR_dict_check (dict, word) != -1)
+            continue;
+
+        tried++;
+        if (AUTOCORR_ctx_correct (ctx, word, correction, sizeof (correction)) && strcmp (correction, intended) == 0)
+            right++;
+    }
+
+    fprintf (out, "    \"segmentation\": {\"cases\": %d, \"correct\": %d, \"accuracy\": %.4f}%s\n", tried, right,
+             tried > 0 ? (double) right / tried : 0.0, last);
+    printf ("accuracy     segmentation: %d of %d split (%.1f %%)\n", right, tried,
+            tried > 0 ? 100.0 * right / tried : 0.0);
+}
+
+/**
+ *
+ * Measures accuracy of corrections of labeled misspellings within edit distance of ctx.
+ * Writes result as JSON object.
+ *
+ */
+static void bench_labeled_accuracy (FILE* out, AUTOCORR_ctx* ctx, int distance, const char* last)
+{
+    FILE* file = fopen (LABELED_SET, "r");
+    int tried = 0, right = 0;
+    char line[256], correction[AUTOCORR_CORRECTION_MAX];
+
+    while (file != NULL && fgets (line, sizeof (line), file) != NULL)
+    {
+        // Skip comments and malformed lines
+        char* tab = strchr (line, '\t');
+        if (line[0] == '#' || tab == NULL)
+            continue;
+
+        *tab = '\0';
+        char* intended = tab + 1;
+        intended[strcspn (intended, "\r\n")] = '\0';
+
+        tried++;
+        if (AUTOCORR_ctx_correct (ctx, line, correction, sizeof (correction)) && strcmp (correction, intended) == 0)
+            right++;
+    }
+
+    if (file != NULL)
+        fclose (file);
+
+    fprintf (out, "    \"labeled_distance%d\": {\"cases\": %d, \"correct\": %d, \"accuracy\": %.4f}%s\n", distance, tried,
+             right, tried > 0 ? (double) right / tried : 0.0, last);
+    printf ("accuracy     labeled set, distance %d: %d of %d corrected (%.1f %%)\n", distance, right, tried,
+            tried > 0 ? 100.0 * right / tried : 0.0);
+}
+
+/**
+ *
+ * Gives optimal string alignment distance between a and b (edits of adjacent transpositions,
+ * deletions, insertions and alterations, no substring edited twice), by full table.
+ *
+ */
+static int osa_distance (const char* a, const char* b)
+{
+    int len_a = strlen (a), len_b = strlen (b);
+    int d[AUTOCORR_CORRECTION_MAX + 1][AUTOCORR_CORRECTION_MAX + 1];
+
+    for (int i = 0; i <= len_a; i++)
+        for (int j = 0; j <= len_b; j++)
+        {
+            if (i == 0 || j == 0)
+            {
+                d[i][j] = i + j;
+                continue;
+            }
+
+            int best = d[i - 1][j - 1] + (a[i - 1] != b[j - 1]);
+            if (d[i - 1][j] + 1 < best)
+                best = d[i - 1][j] + 1;
+            if (d[i][j - 1] + 1 < best)
+                best = d[i][j - 1] + 1;
+            if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] && d[i - 2][j - 2] + 1 < best)
+                best = d[i - 2][j - 2] + 1;
+            d[i][j] = best;
+        }
+
+    return d[len_a][len_b];
+}
+
+/**
+ *
+ * Checks distances of suggestions for cases misspellings of frequent words holding a hyphen,
+ * period or digit, characters outside trie alphabet, against optimal string alignment distance.
+ * Writes result as JSON object.
+ * Returns number of suggestions whose distance differs.
+ *
+ */
+static int bench_search_distances (FILE* out, AUTOCORR_ctx* ctx, const vocabulary* vocab, int cases, const char* last)
+{
+    static const char others[] = "-.7";
+    char word[AUTOCORR_LENGTH_MAX + 1];
+    AUTOCORR_suggestion suggestions[DISTANCE_SUGGESTIONS];
+    int ranks = (vocab -> count < ACCURACY_RANKS) ? vocab -> count : ACCURACY_RANKS;
+    int checked = 0, wrong = 0;
+
+    for (int c = 0; c < cases; c++)
+    {
+        misspell (vocab -> words[rng_below (ranks)], rng_below (2), word);
+
+        // Other character in place of letter or between letters
+        int len = strlen (word), at = rng_below (len + 1);
+        char other = others[rng_below (sizeof (others) - 1)];
+        if (len < AUTOCORR_LENGTH_MAX && rng_below (2) == 0)
+            memmove (word + at + 1, word + at, len - at + 1);
+        else if (at == len)
+            at--;
+        word[at] = other;
+
+        int found = AUTOCORR_ctx_suggest (ctx, word, DISTANCE_SUGGESTIONS, suggestions);
+        for (int i = 0; i < found; i++)
+        {
+            // Segmentations are not scored by edit distance
+            if (strchr (suggestions[i].word, ' ') != NULL)
+                continue;
+
+            checked++;
+            if (osa_distance (word, suggestions[i].word) != suggestions[i].distance)
+            {
+                if (wrong++ < 5)
+                    printf ("distance     %s -> %s: %d, expected %d\n", word, suggestions[i].word,
+                            suggestions[i].distance, osa_distance (word, suggestions[i].word));
+            }
+        }
+    }
+
+    fprintf (out, "    \"search_distances\": {\"cases\": %d, \"suggestions\": %d, \"wrong\": %d}%s\n", cases,
+             checked, wrong, last);
+    printf ("distances    %d of %d suggestions for words with punctuation wrong\n", wrong, checked);
+    return wrong;
+}
+
+int main (int argc, char* argv[])
+{
+    int runs = RUNS_DEFAULT;
+    const char* results = RESULTS_FILE;
+
+    // Parse options
+    for (int arg = 1; arg < argc; arg += 2)
+    {
+        if (arg + 1 < argc && strcmp (argv[arg], "-r") == 0)
+            runs = atoi (argv[arg + 1]);
+        else if (arg + 1 < argc && strcmp (argv[arg], "-o") == 0)
+            results = argv[arg + 1];
+        else
+            runs = 0;
+    }
+
+    if (runs < 1 || runs > RUNS_MAX)
+    {
+        printf ("Usage: bench [-r runs] [-o results_file]\n");
+        printf ("Runs must be between 1 and %d.\n", RUNS_MAX);
+        return 1;
+    }
+
+    // Generate corpora, identical for identical word data
+    vocabulary vocab;
+    if (!load_vocabulary (&vocab))
+    {
+        printf ("Could not load word data file - %s.\n", WORD_DATA);
+        return 1;
+    }
+
+    if (mkdir (CORPORA_DIR, 0755) != 0 && errno != EEXIST)
+    {
+        printf ("Could not create corpora directory - %s.\n", CORPORA_DIR);
+        return 1;
+    }
+
+    if (!write_corpus (&vocab, "clean", CLEAN_WORDS, 0, false) ||
+        !write_corpus (&vocab, "heavy", HEAVY_WORDS, HEAVY_RATE, false) ||
+        !write_corpus (&vocab, "long", LONG_WORDS, 0, true))
+    {
+        printf ("Could not write corpora.\n");
+        return 1;
+    }
+
+    corpus corpora[4];
+    const char* names[4] = {"clean", "misspelled", "heavy", "long"};
+    for (int i = 0; i < 4; i++)
+    {
+        char path[256];
+        if (i == 1)
+            snprintf (path, sizeof (path), "%s", MISSPELLED_TEXT);
+        else
+            snprintf (path, sizeof (path), "%s/%s.txt", CORPORA_DIR, names[i]);
+
+        if (!read_corpus (names[i], path, &corpora[i]))
+        {
+            printf ("Could not read corpus - %s.\n", path);
+            return 1;
+        }
+    }
+
+    FILE* out = fopen (results, "w");
+    if (out == NULL)
+    {
+        printf ("Could not open results file - %s.\n", results);
+        return 1;
+    }
+
+    // Load and unload word data
+    timing load = {.count = runs}, unload = {.count = runs};
+    for (int r = 0; r < runs; r++)
+    {
+        uint64_t before = stats_now ();
+        AUTOCORR_dict* dict = AUTOCORR_dict_upload ();
+        load.runs[r] = (stats_now () - before) / NANO_TO_S;
+
+        if (dict == NULL)
+        {
+            printf ("Could not load word data.\n");
+            return 1;
+        }
+
+        before = stats_now ();
+        AUTOCORR_dict_unload (dict);
+        unload.runs[r] = (stats_now () - before) / NANO_TO_S;
+    }
+
+    AUTOCORR_dict* dict = AUTOCORR_dict_upload ();
+    AUTOCORR_ctx* ctx = AUTOCORR_ctx_new (dict);
+    AUTOCORR_ctx* ctx_far = AUTOCORR_ctx_new (dict);
+    if (ctx == NULL || ctx_far == NULL || !AUTOCORR_ctx_set_edit_distance (ctx_far, 2))
+    {
+        printf ("Could not load word data.\n");
+        return 1;
+    }
+
+    printf ("load         %.4f s   unload %.4f s   (%d runs, fastest)\n", timing_min (&load), timing_min (&unload), runs);
+
+    fprintf (out, "{\n");
+    fprintf (out, "  \"runs\": %d,\n", runs);
+    fprintf (out, "  \"dictionary_words\": %u,\n", AUTOCORR_dict_size (dict));
+    fprintf (out, "  \"phases\": {\n");
+    write_timing (out, "load", &load, -1, ",");
+    write_timing (out, "unload", &unload, -1, "");
+    fprintf (out, "  },\n");
+
+    // Check and correct each corpus, long corpus corrections being segmentation
+    fprintf (out, "  \"corpora\": {\n");
+    for (int i = 0; i < 4; i++)
+        bench_corpus (out, ctx, &corpora[i], runs, i < 3 ? "," : "");
+    fprintf (out, "  },\n");
+
+    // Correction quality
+    fprintf (out, "  \"accuracy\": {\n");
+    rng_state = SEED;
+    bench_generated_accuracy (out, dict, ctx, &vocab, 1, ACCURACY_CASES, ",");
+    bench_generated_accuracy (out, dict, ctx_far, &vocab, 2, ACCURACY_CASES_FAR, ",");
+    bench_segmentation_accuracy (out, dict, ctx, &vocab, ACCURACY_CASES_JOINED, ",");
+    bench_labeled_accuracy (out, ctx, 1, ",");
+    bench_labeled_accuracy (out, ctx_far, 2, ",");
+    int wrong_distances = bench_search_distances (out, ctx, &vocab, DISTANCE_CASES, ",");
+    wrong_distances += bench_search_distances (out, ctx_far, &vocab, DISTANCE_CASES, "");
+    fprintf (out, "  },\n");
+
+    // Peak resident memory of whole run
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    fprintf (out, "  \"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+    fprintf (out, "}\n");
+    printf ("peak RSS     %ld kB\n", usage.ru_maxrss);
+
+    AUTOCORR_ctx_free (ctx);
+    AUTOCORR_ctx_free (ctx_far);
+    AUTOCORR_dict_unload (dict);
+
+    if (fclose (out) != 0)
+    {
+        printf ("Could not write results file - %s.\n", results);
+        return 1;
+    }
+
+    printf ("Results written to %s.\n", results);
+
+    // Search must agree with plain edit distance
+    if (wrong_distances > 0)
+    {
+        printf ("Suggestion distances differ from edit distance.\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,771 @@
+/**
+ * build.c
+ *
+ * Builds word frequency data from text corpora.
+ * Text is tokenized exactly as spellcheck reads it, in one pass over memory-mapped files (or
+ * streamed standard input). Each thread counts the words of its chunk into its own table,
+ * sharded by word hash, and shards are merged in parallel once all text is counted.
+ * Words are written most frequent first as word data file and/or binary word data image.
+ * Pairs of neighboring words with a commonly confused word may be counted the same way into a
+ * bigram context model.
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../autocorrect-lib/autocorrect.h"
+#include "checker.h"
+#include "input.h"
+
+// Maximum number of threads counting words
+#define JOBS_MAX 64
+
+// Smallest chunk worth a thread of its own
+#define SPLIT_MIN (64 << 10)
+
+// Tables of words of each thread, a power of two, selected by top bits of word hash
+#define SHARDS 64
+#define SHARD_BITS 6
+
+// Initial number of entries of each shard of table
+#define SHARD_INIT 1024
+
+// Bytes of output buffer of word data file
+#define OUTPUT_BUFFER (1 << 20)
+
+/**
+ * Word and number of times it is counted.
+ */
+typedef struct
+{
+    char word[AUTOCORR_LENGTH_MAX + 1];
+    uint32_t hash;
+    unsigned long count;
+} word_count;
+
+/**
+ * Hash table of word counts, open addressing.
+ */
+typedef struct
+{
+    word_count* entries;
+    size_t count;
+    size_t capacity;
+} count_table;
+
+/**
+ * Words counted by one thread: its chunk of text and its tables.
+ * For merging, shards of all threads with index first, first + step, ... are merged into first job.
+ */
+typedef struct count_job
+{
+    const char* text;
+    size_t size;
+
+    // Text readable around chunk, for word before its first word
+    const char* context_start;
+    const char* context_end;
+
+    count_table shards[SHARDS];
+    unsigned long num_words;
+
+    // Pairs "left right" of neighboring words, either confusable, counted if bigram model is built
+    count_table pairs[SHARDS];
+    bool count_pairs;
+
+    struct count_job* jobs;
+    int first;
+    int step;
+    int count;
+
+    bool failed;
+} count_job;
+
+/**
+ *
+ * Gives hash of word of length bytes (FNV-1a).
+ *
+ */
+static uint32_t hash_word (const char* word, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char) word[i]) * 16777619u;
+
+    return hash;
+}
+
+/**
+ *
+ * Gives entry of word of length bytes with hash in table, empty entry where it belongs if not present.
+ *
+ */
+static word_count* find_count (const count_table* table, const char* word, size_t length, uint32_t hash)
+{
+    size_t mask = table -> capacity - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask)
+    {
+        word_count* entry = &table -> entries[i];
+        if (entry -> count == 0 ||
+            (entry -> hash == hash && memcmp (entry -> word, word, length) == 0 && entry -> word[length] == '\0'))
+            return entry;
+    }
+}
+
+/**
+ *
+ * Doubles capacity of table, keeping it at most 3/4 full.
+ * Returns true if successful else false.
+ *
+ */
+static bool grow_table (count_table* table)
+{
+    count_table grown = {NULL, table -> count, table -> capacity > 0 ? 2 * table -> capacity : SHARD_INIT};
+    if ((grown.entries = calloc (grown.capacity, sizeof (word_count))) == NULL)
+        return false;
+
+    for (size_t i = 0; i < table -> capacity; i++)
+    {
+        const word_count* entry = &table -> entries[i];
+        if (entry -> count > 0)
+            *find_count (&grown, entry -> word, strlen (entry -> word), entry -> hash) = *entry;
+    }
+
+    free (table -> entries);
+    *table = grown;
+    return true;
+}
+
+/**
+ *
+ * Adds count to lowercase word of length bytes with hash in table.
+ * Returns true if successful else false.
+ *
+ */
+static bool add_count (count_table* table, const char* word, size_t length, uint32_t hash, unsigned long count)
+{
+    if (4 * (table -> count + 1) > 3 * table -> capacity && !grow_table (table))
+        return false;
+
+    word_count* entry = find_count (table, word, length, hash);
+    if (entry -> count == 0)
+    {
+        memcpy (entry -> word, word, length);
+        entry -> word[length] = '\0';
+        entry -> hash = hash;
+        table -> count++;
+    }
+
+    entry -> count += count;
+    return true;
+}
+
+/**
+ *
+ * Adds count to word of length bytes (letters and apostrophes) in shard of tables selected by its hash.
+ * Returns true if successful else false.
+ *
+ */
+static bool count_word (count_table* shards, const char* text, size_t length, unsigned long count)
+{
+    // Setting bit 5 lowercases ASCII letters and keeps apostrophes and spaces
+    char word[AUTOCORR_LENGTH_MAX + 1];
+    unsigned char bytes = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        word[i] = text[i] | 0x20;
+        bytes |= text[i];
+    }
+
+    // Words with characters that are not ASCII are folded as spellcheck looks them up,
+    // skipped if they do not fit once folded
+    if (bytes >= 0x80)
+    {
+        int folded = AUTOCORR_fold_word (text, length, word, sizeof (word));
+        if (folded < 0)
+            return true;
+        length = folded;
+    }
+
+    uint32_t hash = hash_word (word, length);
+    return add_count (&shards[hash >> (32 - SHARD_BITS)], word, length, hash, count);
+}
+
+/**
+ *
+ * Adds 1 to pair of left and right words, of left_length and right_length bytes, in shard of
+ * tables selected by its hash. Pairs longer than a word are skipped.
+ * Returns true if successful else false.
+ *
+ */
+static bool count_pair (count_table* shards, const char* left, size_t left_length, const char* right,
+                        size_t right_length)
+{
+    char pair[AUTOCORR_LENGTH_MAX + 1];
+    if (left_length + 1 + right_length > AUTOCORR_LENGTH_MAX)
+        return true;
+
+    memcpy (pair, left, left_length);
+    pair[left_length] = ' ';
+    memcpy (pair + left_length + 1, right, right_length);
+
+    return count_word (shards, pair, left_length + 1 + right_length, 1);
+}
+
+/**
+ *
+ * Checks if text from end of one word to start of next is whitespace that joins them as context.
+ *
+ */
+static bool adjacent (const char* end, const char* start)
+{
+    if (start - end < 1 || start - end > CONTEXT_GAP)
+        return false;
+
+    for (; end < start; end++)
+        if (!is_space (*end))
+            return false;
+
+    return true;
+}
+
+/**
+ *
+ * Counts words of chunk of text of job, tokenized as spellcheck does, and pairs of neighboring
+ * words, one of them confusable, if counted.
+ * Sets failed of job in case of error.
+ * Takes count_job* as void* so it can be run as thread, returns NULL.
+ *
+ */
+static void* count_chunk (void* arg)
+{
+    count_job* job = arg;
+    const unsigned char* text = (const unsigned char*) job -> text;
+
+    // Previous word, as spellcheck reads it in context
+    const char* prev = NULL;
+    size_t prev_length = 0;
+    bool prev_confusable = false, first = true;
+
+    size_t i = 0, start, length;
+    while (next_word (text, job -> size, &i, &start, &length))
+    {
+        const char* word = job -> text + start;
+        if (!count_word (job -> shards, word, length, 1))
+        {
+            job -> failed = true;
+            break;
+        }
+
+        if (job -> count_pairs)
+        {
+            // Word before first word of chunk may lie before chunk
+            if (first)
+            {
+                const char* next;
+                size_t next_length;
+                context_words (job -> context_start, job -> context_end, word, length, &prev, &prev_length, &next,
+                               &next_length);
+                prev_confusable = (prev != NULL && AUTOCORR_confusable (prev, prev_length));
+            }
+            else if (prev != NULL && !adjacent (prev + prev_length, word))
+                prev = NULL;
+
+            // Confusable words are read with typographic apostrophes folded, as spellcheck reads them
+            char folded[AUTOCORR_LENGTH_MAX + 1];
+            size_t folded_length;
+            const char* lookup = fold_span (word, length, folded, &folded_length);
+            bool confusable = (lookup != NULL && AUTOCORR_confusable (lookup, folded_length));
+
+            if (prev != NULL && (prev_confusable || confusable) &&
+                !count_pair (job -> pairs, prev, prev_length, word, length))
+            {
+                job -> failed = true;
+                break;
+            }
+
+            prev = word;
+            prev_length = length;
+            prev_confusable = confusable;
+        }
+
+        first = false;
+        job -> num_words++;
+    }
+
+    return NULL;
+}
+
+/**
+ *
+ * Adds counts of table from to table into, freeing table from.
+ * Returns true if successful else false.
+ *
+ */
+static bool merge_table (count_table* into, count_table* from)
+{
+    bool merged = true;
+    for (size_t i = 0; i < from -> capacity && merged; i++)
+    {
+        const word_count* entry = &from -> entries[i];
+        if (entry -> count > 0)
+            merged = add_count (into, entry -> word, strlen (entry -> word), entry -> hash, entry -> count);
+    }
+
+    free (from -> entries);
+    memset (from, 0, sizeof (count_table));
+    return merged;
+}
+
+/**
+ *
+ * Merges shards first, first + step, ... of count jobs into first job, freeing merged tables.
+ * Sets failed of job in case of error.
+ * Takes count_job* as void* so it can be run as thread, returns NULL.
+ *
+ */
+static void* merge_shards (void* arg)
+{
+    count_job* job = arg;
+    count_job* jobs = job -> jobs;
+
+    for (int s = job -> first; s < SHARDS; s += job -> step)
+        for (int j = 1; j < job -> count; j++)
+        {
+            if (!merge_table (&jobs[0].shards[s], &jobs[j].shards[s]) ||
+                !merge_table (&jobs[0].pairs[s], &jobs[j].pairs[s]))
+                job -> failed = true;
+        }
+
+    return NULL;
+}
+
+/**
+ *
+ * Runs function on each of n jobs, first on this thread and others on one thread each.
+ *
+ */
+static void run_jobs (void* (*function) (void*), count_job* jobs, int n)
+{
+    pthread_t thread[JOBS_MAX];
+    bool started[JOBS_MAX] = {false};
+
+    for (int i = 1; i < n; i++)
+        started[i] = (pthread_create (&thread[i], NULL, function, &jobs[i]) == 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        if (i == 0 || !started[i])
+            function (&jobs[i]);
+        else
+            pthread_join (thread[i], NULL);
+    }
+}
+
+/**
+ *
+ * Counts words of text file at path ("-" for standard input) batch by batch,
+ * splitting each batch between jobs threads.
+ * Returns true if successful else false.
+ *
+ */
+static bool count_text (const char* path, count_job* jobs, int n)
+{
+    text_input input;
+    if (!open_input (&input, path))
+    {
+        fprintf (stderr, "Could not open text file - %s.\n", path);
+        return false;
+    }
+
+    size_t batch_size = (size_t) n * CHUNK_SIZE;
+    bool failed = false;
+
+    for (bool last = false; !last && !failed; )
+    {
+        // Count batch up to last word boundary, carrying partial word into next batch
+        const char* batch;
+        size_t filled, end;
+        if (!read_words (&input, &batch_size, &batch, &filled, &end, &last))
+        {
+            failed = true;
+            break;
+        }
+
+        // Split batch into one chunk per thread, each ending on word boundary or at end of batch
+        int parts = (end / SPLIT_MIN < (size_t) n) ? end / SPLIT_MIN + 1 : n;
+        size_t start = 0;
+        for (int i = 0; i < parts; i++)
+        {
+            size_t stop = (i == parts - 1) ? end : end / parts * (i + 1);
+            while (stop > start && stop < end && !is_boundary (batch[stop - 1]))
+                stop--;
+
+            jobs[i].text = batch + start;
+            jobs[i].size = stop - start;
+            batch_bounds (&input, batch, filled, &jobs[i].context_start, &jobs[i].context_end);
+            start = stop;
+        }
+
+        run_jobs (count_chunk, jobs, parts);
+
+        for (int i = 0; i < parts; i++)
+            failed |= jobs[i].failed;
+
+        consume_batch (&input, filled, end);
+    }
+
+    close_input (&input);
+    return !failed;
+}
+
+/**
+ *
+ * Adds words and counts of word frequency data file at path to shards.
+ * Words are kept as loading word data does: lowercase letters and apostrophes.
+ * Returns true if successful else false.
+ *
+ */
+static bool merge_word_data (const char* path, count_table* shards)
+{
+    FILE* word_data_fp = fopen (path, "r");
+    if (word_data_fp == NULL)
+    {
+        fprintf (stderr, "Could not open word data file - %s.\n", path);
+        return false;
+    }
+
+    char word_str[AUTOCORR_LENGTH_MAX + 1];
+    int word_count;
+    bool merged = true;
+
+    while (merged && fscanf (word_data_fp, "%d", &word_count) == 1 && fscanf (word_data_fp, "%45s", word_str) == 1)
+    {
+        size_t word_len = 0;
+        for (int i = 0; word_str[i] != '\0'; i++)
+            if (char_class (word_str[i]) & (CLASS_LETTER | CLASS_APOSTROPHE | CLASS_NOT_ASCII))
+                word_str[word_len++] = word_str[i];
+
+        if (word_len > 0 && word_count > 0)
+            merged = count_word (shards, word_str, word_len, word_count);
+    }
+
+    merged &= (feof (word_data_fp) && !ferror (word_data_fp));
+    fclose (word_data_fp);
+
+    if (!merged)
+        fprintf (stderr, "Could not read word data file - %s.\n", path);
+    return merged;
+}
+
+/**
+ *
+ * Orders word counts pointed to by a and b by decreasing count, then alphabetically, for qsort.
+ *
+ */
+static int compare_counts (const void* a, const void* b)
+{
+    const word_count* x = *(word_count* const*) a;
+    const word_count* y = *(word_count* const*) b;
+
+    if (x -> count != y -> count)
+        return (x -> count > y -> count) ? -1 : 1;
+
+    return strcmp (x -> word, y -> word);
+}
+
+/**
+ *
+ * Gives count of word as word data frequency, at most INT_MAX.
+ *
+ */
+static int frequency (const word_count* entry)
+{
+    return (entry -> count < (unsigned long) INT_MAX) ? (int) entry -> count : INT_MAX;
+}
+
+/**
+ *
+ * Writes n words in order as word frequency data file at path, standard output if "-".
+ * Files are written to a temporary file and renamed, so readers never see a partial file.
+ * Returns true if successful else false.
+ *
+ */
+static bool write_word_data (const char* path, word_count* const* words, size_t n)
+{
+    bool to_stdout = (strcmp (path, "-") == 0);
+    char tmp_path[4096];
+    if (!to_stdout && snprintf (tmp_path, sizeof (tmp_path), "%s.tmp", path) >= (int) sizeof (tmp_path))
+        return false;
+
+    FILE* word_data_fp = to_stdout ? stdout : fopen (tmp_path, "w");
+    if (word_data_fp == NULL)
+        return false;
+    setvbuf (word_data_fp, NULL, _IOFBF, OUTPUT_BUFFER);
+
+    bool written = true;
+    for (size_t i = 0; i < n && written; i++)
+        written = fprintf (word_data_fp, "%d %s\n", frequency (words[i]), words[i] -> word) > 0;
+
+    if (to_stdout)
+        return fflush (stdout) == 0 && written;
+
+    if (fclose (word_data_fp) != 0 || !written || rename (tmp_path, path) != 0)
+    {
+        remove (tmp_path);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Gives n word counts as arrays of strings and frequencies, to be freed by caller.
+ * Returns true if successful else false.
+ *
+ */
+static bool count_arrays (word_count* const* words, size_t n, const char*** strings, int** frequencies)
+{
+    *strings = malloc ((n + 1) * sizeof (char*));
+    *frequencies = malloc ((n + 1) * sizeof (int));
+    if (*strings == NULL || *frequencies == NULL)
+        return false;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        (*strings)[i] = words[i] -> word;
+        (*frequencies)[i] = frequency (words[i]);
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Writes n words as binary word data image at path.
+ * Returns true if successful else false.
+ *
+ */
+static bool write_image (const char* path, word_count* const* words, size_t n)
+{
+    const char** strings;
+    int* frequencies;
+    bool written = count_arrays (words, n, &strings, &frequencies) &&
+                   AUTOCORR_compile_words (strings, frequencies, n, path);
+
+    free (strings);
+    free (frequencies);
+    return written;
+}
+
+/**
+ *
+ * Writes bigram model of pairs counted in shards of pair tables, for word data of n words, at path.
+ * Returns true if successful else false.
+ *
+ */
+static bool write_bigrams (const char* path, word_count* const* words, size_t n, const count_table* pairs)
+{
+    size_t number_pairs = 0;
+    for (int s = 0; s < SHARDS; s++)
+        number_pairs += pairs[s].count;
+
+    word_count** counted = malloc ((number_pairs + 1) * sizeof (word_count*));
+    size_t p = 0;
+    for (int s = 0; s < SHARDS && counted != NULL; s++)
+        for (size_t i = 0; i < pairs[s].capacity; i++)
+            if (pairs[s].entries[i].count > 0)
+                counted[p++] = &pairs[s].entries[i];
+
+    const char** strings = NULL;
+    const char** pair_strings = NULL;
+    int* frequencies = NULL;
+    int* counts = NULL;
+    bool written = counted != NULL && count_arrays (words, n, &strings, &frequencies) &&
+                   count_arrays (counted, number_pairs, &pair_strings, &counts) &&
+                   AUTOCORR_compile_bigrams (strings, frequencies, n, pair_strings, counts, number_pairs, path);
+
+    free (counted);
+    free (strings);
+    free (frequencies);
+    free (pair_strings);
+    free (counts);
+    return written;
+}
+
+/**
+ *
+ * Prints usage of dictionary builder.
+ *
+ */
+static void print_usage (void)
+{
+    printf ("Usage: spellcheck-build [-j jobs] [--min-count count] [--merge word_data_file]...\n");
+    printf ("                        [-o word_data_file] [--image image_file] [--bigrams model_file] corpus_file...\n");
+    printf ("Counts words of corpus files (- for standard input) and of word data files merged,\n");
+    printf ("writing them most frequent first to word data file (default standard output)\n");
+    printf ("and/or binary image, and neighbors of commonly confused words to bigram model.\n");
+}
+
+int main (int argc, char* argv[])
+{
+    int jobs = 1;
+    unsigned long min_count = 1;
+    const char* text_path = NULL;
+    const char* image_path = NULL;
+    const char* bigrams_path = NULL;
+
+    // Word data files merged and corpus files, in order given
+    const char** merges = calloc (argc, sizeof (char*));
+    const char** corpora = calloc (argc, sizeof (char*));
+    int num_merges = 0, num_corpora = 0;
+
+    if (merges == NULL || corpora == NULL)
+    {
+        printf ("Out of memory. Words could not be counted.\n");
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if (strcmp (argv[i], "-j") == 0 && has_value)
+        {
+            jobs = atoi (argv[++i]);
+            if (jobs < 1 || jobs > JOBS_MAX)
+            {
+                printf ("Number of jobs must be from 1 to %d.\n", JOBS_MAX);
+                return 1;
+            }
+        }
+        else if (strcmp (argv[i], "--min-count") == 0 && has_value)
+        {
+            int count = atoi (argv[++i]);
+            if (count < 1)
+            {
+                printf ("Minimum count must be at least 1.\n");
+                return 1;
+            }
+            min_count = count;
+        }
+        else if (strcmp (argv[i], "--merge") == 0 && has_value)
+            merges[num_merges++] = argv[++i];
+        else if (strcmp (argv[i], "-o") == 0 && has_value)
+            text_path = argv[++i];
+        else if (strcmp (argv[i], "--image") == 0 && has_value)
+            image_path = argv[++i];
+        else if (strcmp (argv[i], "--bigrams") == 0 && has_value)
+            bigrams_path = argv[++i];
+        else if (argv[i][0] == '-' && argv[i][1] != '\0')
+        {
+            print_usage ();
+            return 1;
+        }
+        else
+            corpora[num_corpora++] = argv[i];
+    }
+
+    if (num_corpora + num_merges == 0)
+    {
+        print_usage ();
+        return 1;
+    }
+
+    // Word data goes to standard output unless written to files, messages then go to standard error
+    if (text_path == NULL && image_path == NULL && bigrams_path == NULL)
+        text_path = "-";
+    FILE* info = (text_path != NULL && strcmp (text_path, "-") == 0) ? stderr : stdout;
+
+    count_job* job = calloc (JOBS_MAX, sizeof (count_job));
+    if (job == NULL)
+    {
+        printf ("Out of memory. Words could not be counted.\n");
+        return 1;
+    }
+
+    for (int i = 0; i < JOBS_MAX; i++)
+        job[i].count_pairs = (bigrams_path != NULL);
+
+    // Count words of corpora, then add counts of word data merged
+    bool failed = false;
+    for (int i = 0; i < num_corpora && !failed; i++)
+        failed = !count_text (corpora[i], job, jobs);
+
+    for (int i = 0; i < num_merges && !failed; i++)
+        failed = !merge_word_data (merges[i], job[0].shards);
+
+    // Merge shards of all threads into first, each thread merging shards of its own
+    for (int i = 0; i < jobs && !failed; i++)
+    {
+        job[i].jobs = job;
+        job[i].first = i;
+        job[i].step = jobs;
+        job[i].count = jobs;
+    }
+    if (!failed)
+        run_jobs (merge_shards, job, jobs);
+
+    unsigned long num_words = 0;
+    for (int i = 0; i < jobs; i++)
+    {
+        failed |= job[i].failed;
+        num_words += job[i].num_words;
+    }
+
+    // Order words kept, most frequent first
+    size_t distinct = 0;
+    for (int s = 0; s < SHARDS; s++)
+        distinct += job[0].shards[s].count;
+
+    word_count** words = failed ? NULL : malloc ((distinct + 1) * sizeof (word_count*));
+    size_t n = 0;
+    if (words != NULL)
+    {
+        for (int s = 0; s < SHARDS; s++)
+            for (size_t i = 0; i < job[0].shards[s].capacity; i++)
+                if (job[0].shards[s].entries[i].count >= min_count)
+                    words[n++] = &job[0].shards[s].entries[i];
+
+        qsort (words, n, sizeof (word_count*), compare_counts);
+    }
+    else if (!failed)
+        fprintf (info, "Out of memory. Words could not be counted.\n");
+
+    // Write word data before image, image being used only if not older
+    bool written = (words != NULL);
+    if (written && text_path != NULL && !(written = write_word_data (text_path, words, n)))
+        fprintf (info, "Could not write word data file - %s.\n", text_path);
+
+    if (written && image_path != NULL && !(written = write_image (image_path, words, n)))
+        fprintf (info, "Could not write word data image - %s.\n", image_path);
+
+    if (written && bigrams_path != NULL && !(written = write_bigrams (bigrams_path, words, n, job[0].pairs)))
+        fprintf (info, "Could not write bigram model - %s.\n", bigrams_path);
+
+    if (written)
+        fprintf (info, "Counted %lu words of text, %zu distinct words, wrote %zu words.\n", num_words, distinct, n);
+
+    for (int i = 0; i < JOBS_MAX; i++)
+        for (int s = 0; s < SHARDS; s++)
+        {
+            free (job[i].shards[s].entries);
+            free (job[i].pairs[s].entries);
+        }
+    free (job);
+    free (words);
+    free (merges);
+    free (corpora);
+
+    return written ? 0 : 1;
+}
@@ -0,0 +1,580 @@
+/**
+ * checker.c
+ *
+ * Implements spell-checking of text chunks.
+ * Tokenizes UTF-8 text in place with SSE2 character class scans, decoding only characters that
+ * are not ASCII, checks words in batches and reports misspelled words with suggested corrections.
+ * Optionally reports correctly spelled words confused with another word, by their neighbors.
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+// clock_gettime
+#define _DEFAULT_SOURCE
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "checker.h"
+
+#ifdef __SSE2__
+/**
+ *
+ * Gives bit mask of which of 16 characters at p are in any of classes.
+ *
+ */
+static inline unsigned int class_mask (const unsigned char* p, int classes)
+{
+    __m128i c = _mm_loadu_si128 ((const __m128i*) p);
+    __m128i match = _mm_setzero_si128 ();
+
+    // Bytes above 127 are negative, never between bounds
+    if (classes & CLASS_LETTER)
+    {
+        __m128i lower = _mm_or_si128 (c, _mm_set1_epi8 (0x20));
+        match = _mm_or_si128 (match, _mm_and_si128 (_mm_cmpgt_epi8 (lower, _mm_set1_epi8 ('a' - 1)),
+                                                    _mm_cmplt_epi8 (lower, _mm_set1_epi8 ('z' + 1))));
+    }
+
+    if (classes & CLASS_DIGIT)
+        match = _mm_or_si128 (match, _mm_and_si128 (_mm_cmpgt_epi8 (c, _mm_set1_epi8 ('0' - 1)),
+                                                    _mm_cmplt_epi8 (c, _mm_set1_epi8 ('9' + 1))));
+
+    if (classes & CLASS_APOSTROPHE)
+        match = _mm_or_si128 (match, _mm_cmpeq_epi8 (c, _mm_set1_epi8 ('\'')));
+
+    // Sign bits mark bytes that are not ASCII
+    if (classes & CLASS_NOT_ASCII)
+        match = _mm_or_si128 (match, c);
+
+    return _mm_movemask_epi8 (match);
+}
+#endif
+
+// Code point ranges of letters that are not ASCII, in order: letters of Latin (with IPA),
+// combining accents of decomposed letters, Greek, Cyrillic, Armenian, Hebrew and Arabic
+static const uint32_t letter_ranges[][2] =
+{
+    { 0xAA, 0xAA }, { 0xB5, 0xB5 }, { 0xBA, 0xBA }, { 0xC0, 0xD6 }, { 0xD8, 0xF6 }, { 0xF8, 0x2AF },
+    { 0x300, 0x36F }, { 0x370, 0x373 }, { 0x376, 0x377 }, { 0x37B, 0x37D }, { 0x386, 0x386 },
+    { 0x388, 0x3FF }, { 0x400, 0x481 }, { 0x48A, 0x52F }, { 0x531, 0x556 }, { 0x561, 0x587 },
+    { 0x5D0, 0x5EA }, { 0x620, 0x64A }, { 0x1E00, 0x1FBC }
+};
+
+/**
+ *
+ * Gives tokenizer class of code point c that is not ASCII: CLASS_APOSTROPHE for typographic
+ * apostrophes, folded to ' by AUTOCORR_fold_word, CLASS_LETTER for letters, else 0.
+ *
+ */
+static int code_class (uint32_t c)
+{
+    if (c == 0x2018 || c == 0x2019 || c == 0x2BC || c == 0xFF07)
+        return CLASS_APOSTROPHE;
+
+    for (size_t r = 0; r < sizeof (letter_ranges) / sizeof (letter_ranges[0]) && c >= letter_ranges[r][0]; r++)
+        if (c <= letter_ranges[r][1])
+            return CLASS_LETTER;
+
+    return 0;
+}
+
+/**
+ *
+ * Gives tokenizer class of UTF-8 character at text[i], a byte that is not ASCII, setting *length
+ * to its length in bytes. Invalid bytes are single characters of no class.
+ * Returns -1 if character is cut off by end of text at size.
+ *
+ */
+static int decode_class (const unsigned char* text, size_t i, size_t size, size_t* length)
+{
+    uint32_t c = text[i];
+    size_t n = (c >= 0xC2 && c <= 0xDF) ? 2 : (c >= 0xE0 && c <= 0xEF) ? 3 : (c >= 0xF0 && c <= 0xF4) ? 4 : 1;
+    c &= 0x7F >> n;
+
+    *length = 1;
+    for (size_t k = 1; k < n; k++)
+    {
+        if (i + k == size)
+            return -1;
+        if ((text[i + k] & 0xC0) != 0x80)
+            return 0;
+        c = (c << 6) | (text[i + k] & 0x3F);
+    }
+
+    // Lead byte without its continuation bytes, overlong forms, surrogates and code points past U+10FFFF
+    if (n == 1 || (n == 3 && c < 0x800) || (n == 4 && (c < 0x10000 || c > 0x10FFFF)) || (c >= 0xD800 && c <= 0xDFFF))
+        return 0;
+
+    *length = n;
+    return code_class (c);
+}
+
+/**
+ *
+ * Gives position of first character of text from i before end in any of classes.
+ * Returns end or more if there is none.
+ *
+ */
+static inline size_t find_classes (const unsigned char* text, size_t i, size_t end, int classes)
+{
+#ifdef __SSE2__
+    for (; i + 16 <= end; i += 16)
+    {
+        unsigned int mask = class_mask (text + i, classes);
+        if (mask != 0)
+            return i + __builtin_ctz (mask);
+    }
+#endif
+
+    while (i < end && !(char_class (text[i]) & classes))
+        i++;
+
+    return i;
+}
+
+/**
+ *
+ * Gives position of first character of text from i before end in none of classes.
+ * Returns end or more if there is none.
+ *
+ */
+static inline size_t skip_classes (const unsigned char* text, size_t i, size_t end, int classes)
+{
+#ifdef __SSE2__
+    for (; i + 16 <= end; i += 16)
+    {
+        unsigned int mask = ~class_mask (text + i, classes) & 0xFFFF;
+        if (mask != 0)
+            return i + __builtin_ctz (mask);
+    }
+#endif
+
+    while (i < end && (char_class (text[i]) & classes))
+        i++;
+
+    return i;
+}
+
+/**
+ *
+ * Gives position of first character of text from i before size not in classes, as skip_classes,
+ * decoding characters that are not ASCII.
+ * Returns size if a character is cut off by end of text, as word may go on past it.
+ *
+ */
+static inline size_t skip_word (const unsigned char* text, size_t i, size_t size, int classes)
+{
+    size_t length;
+
+    while ((i = skip_classes (text, i, size, classes)) < size && __builtin_expect (text[i] >= 0x80, 0))
+    {
+        int c = decode_class (text, i, size, &length);
+        if (c < 0)
+            return size;
+        if (!(c & classes))
+            break;
+
+        i += length;
+    }
+
+    return i;
+}
+
+/**
+ *
+ * Finds words before and after word of length characters, within text from start before end.
+ * Neighbors are read in place, so context does not depend on how text is split into chunks.
+ * Words with characters that are not ASCII are not read as neighbors.
+ *
+ */
+void context_words (const char* start, const char* end, const char* word, size_t length, const char** prev,
+                    size_t* prev_length, const char** next, size_t* next_length)
+{
+    const unsigned char* lo = (const unsigned char*) start;
+    const unsigned char* hi = (const unsigned char*) end;
+    const unsigned char* w = (const unsigned char*) word;
+
+    *prev = *next = NULL;
+    *prev_length = *next_length = 0;
+
+    // Previous word ends after whitespace before word, its run not following a digit
+    const unsigned char* p = w;
+    while (p > lo && w - p < CONTEXT_GAP && is_space (p[-1]))
+        p--;
+
+    const unsigned char* e = p;
+    while (p > lo && e - p <= AUTOCORR_LENGTH_MAX && (char_class (p[-1]) & (CLASS_LETTER | CLASS_APOSTROPHE)))
+        p--;
+
+    if (e < w && (p == lo || !(char_class (p[-1]) & (CLASS_DIGIT | CLASS_NOT_ASCII))))
+    {
+        // Words start with a letter
+        while (p < e && *p == '\'')
+            p++;
+
+        if (p < e && e - p <= AUTOCORR_LENGTH_MAX)
+        {
+            *prev = (const char*) p;
+            *prev_length = e - p;
+        }
+    }
+
+    // Next word starts after whitespace after word, and ends before end on other character than a digit
+    const unsigned char* q = w + length;
+    while (q < hi && q - (w + length) < CONTEXT_GAP && is_space (*q))
+        q++;
+
+    if (q == w + length || q == hi || char_class (*q) != CLASS_LETTER)
+        return;
+
+    e = q + 1;
+    while (e < hi && e - q <= AUTOCORR_LENGTH_MAX && (char_class (*e) & (CLASS_LETTER | CLASS_APOSTROPHE)))
+        e++;
+
+    if (e < hi && e - q <= AUTOCORR_LENGTH_MAX && !(char_class (*e) & (CLASS_DIGIT | CLASS_NOT_ASCII)))
+    {
+        *next = (const char*) q;
+        *next_length = e - q;
+    }
+}
+
+/**
+ *
+ * Finds alternatives of n correctly spelled words of batch of chunk (freqs[k] not -1) that are
+ * confusable, and much more probable than word in its context by bigram model of chunk.
+ * Sets alternatives[k] to alternative of words[k], NULL if there is none.
+ * Words of most batches are ruled out by first letter and length alone.
+ *
+ */
+static void find_alternatives (chunk_job* job, const char** words, const int* lens, const int* freqs, int n,
+                               const char** alternatives)
+{
+    uint64_t before = stats_now ();
+
+    const char* start = (job -> context_start != NULL) ? job -> context_start : job -> text;
+    const char* end = (job -> context_end != NULL) ? job -> context_end : job -> text + job -> size;
+
+    for (int k = 0; k < n; k++)
+    {
+        alternatives[k] = NULL;
+
+        // Confusion sets are read with typographic apostrophes folded
+        char folded[AUTOCORR_LENGTH_MAX + 1];
+        const char* word;
+        size_t length;
+        int confusable;
+        if (freqs[k] == -1 || (word = fold_span (words[k], lens[k], folded, &length)) == NULL ||
+            (confusable = AUTOCORR_bigrams_find (job -> bigrams, word, length)) < 0)
+            continue;
+
+        const char *prev, *next;
+        size_t prev_length, next_length;
+        context_words (start, end, words[k], lens[k], &prev, &prev_length, &next, &next_length);
+
+        alternatives[k] = AUTOCORR_bigrams_alternative (job -> bigrams, confusable, prev, prev_length, next, next_length);
+    }
+
+    job -> time_context += (stats_now () - before) / NANO_TO_S;
+}
+
+/**
+ *
+ * Checks batch of n words of chunk together.
+ * Reports misspelled words with suggested corrections into report buffer of chunk,
+ * or counts them in unique table of chunk to be corrected once each.
+ * With a bigram model, correctly spelled words their context tells against are reported as
+ * misspelled, suggesting the word context prefers.
+ * Returns true if successful else false.
+ *
+ */
+static bool check_batch (chunk_job* job, const char** words, const int* lens, int n)
+{
+    int freqs[CHECK_BATCH];
+    char word[AUTOCORR_LENGTH_MAX + 1];
+    char word_corrected[AUTOCORR_CORRECTION_MAX];
+    bool positions = (job -> format != FORMAT_TEXT || job -> unique != NULL);
+
+    // Check words' spelling, sampling latency per word of batch
+    uint64_t before = stats_now ();
+    AUTOCORR_ctx_check_words (job -> ctx, words, lens, n, freqs);
+    histogram_add (&job -> check_latency, (stats_now () - before) / n);
+
+    // Find correctly spelled words confused with another word
+    const char* alternatives[CHECK_BATCH];
+    if (job -> bigrams != NULL)
+        find_alternatives (job, words, lens, freqs, n, alternatives);
+
+    // Report misspelled words in order
+    for (int k = 0; k < n; k++)
+    {
+        if (freqs[k] != -1 && (job -> bigrams == NULL || alternatives[k] == NULL))
+            continue;
+
+        // Folded copy of word for correction and report, lowercase with apostrophes as '
+        int word_len = AUTOCORR_fold_word (words[k], lens[k], word, sizeof (word));
+        if (word_len < 0)
+        {
+            for (word_len = 0; word_len < lens[k]; word_len++)
+                word[word_len] = tolower ((unsigned char) words[k][word_len]);
+            word[word_len] = '\0';
+        }
+
+        // Count lines up to word
+        if (positions)
+        {
+            advance_position (&job -> position, job -> counted, words[k] - job -> counted);
+            job -> counted = words[k];
+        }
+
+        job -> misspellings++;
+
+        // Count occurrence of word, corrected once all text is checked
+        if (job -> unique != NULL)
+        {
+            if (!unique_add (job -> unique, word, word_len, 1, job -> file_index, &job -> position))
+            {
+                printf ("Out of memory. Text could not be checked.\n");
+                return false;
+            }
+            continue;
+        }
+
+        // Check word's correction, confused words already having theirs
+        const char* suggestion = (freqs[k] != -1) ? alternatives[k] : NULL;
+        if (suggestion == NULL)
+        {
+            before = stats_now ();
+            bool corrected = AUTOCORR_ctx_correct (job -> ctx, word, word_corrected, sizeof (word_corrected));
+            uint64_t latency = stats_now () - before;
+
+            // Update benchmark
+            job -> time_correct += latency / NANO_TO_S;
+            histogram_add (&job -> correct_latency, latency);
+
+            suggestion = corrected ? word_corrected : NULL;
+        }
+
+        // Grow report buffer to fit line
+        size_t line_max = FORMAT_LINE_MAX + job -> file_len;
+        if (job -> report_len + line_max > job -> report_size)
+        {
+            size_t report_size = 2 * job -> report_size + line_max;
+            char* report = realloc (job -> report, report_size);
+            if (report == NULL)
+            {
+                printf ("Out of memory. Text could not be checked.\n");
+                return false;
+            }
+
+            job -> report = report;
+            job -> report_size = report_size;
+        }
+
+        // Text reports folded word, other formats word as in text
+        bool text = (job -> format == FORMAT_TEXT);
+        job -> report_len += format_misspelling (job -> report + job -> report_len, job -> format, job -> file,
+                                                 job -> file_len, text ? word : words[k], text ? word_len : lens[k],
+                                                 suggestion, 0, &job -> position);
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Finds next word of text from *i before size, setting its start and length.
+ * Words are runs of letters and apostrophes not starting with an apostrophe, ended by any other
+ * character than a digit; runs with digits or longer than AUTOCORR_LENGTH_MAX are skipped.
+ * Text is scanned 16 bytes at a time for letters, digits and bytes that are not ASCII, only
+ * characters that are not ASCII being decoded.
+ * Moves *i past character ending word.
+ * Returns true if word is found else false.
+ *
+ */
+bool next_word (const unsigned char* text, size_t size, size_t* i, size_t* start, size_t* length)
+{
+    // Skip to first letter or digit of each run
+    for (size_t j = *i, n; (j = find_classes (text, j, size, CLASS_LETTER | CLASS_DIGIT | CLASS_NOT_ASCII)) < size; )
+    {
+        // Characters that are not ASCII start words only if they are letters
+        int first = char_class (text[j]);
+        n = 1;
+        if (__builtin_expect (first == CLASS_NOT_ASCII, 0) && (first = decode_class (text, j, size, &n)) != CLASS_LETTER)
+        {
+            if (first < 0)
+                break;
+
+            j += n;
+            continue;
+        }
+
+        // Ignore words with numbers
+        // Skip alphanumeric string and character ending it
+        if (first == CLASS_DIGIT)
+        {
+            j = skip_word (text, j + 1, size, CLASS_LETTER | CLASS_DIGIT) + 1;
+            continue;
+        }
+
+        // Allow only alphabetical characters and apostrophes
+        *start = j;
+        j = skip_word (text, j + n, size, CLASS_LETTER | CLASS_APOSTROPHE);
+        *length = j - *start;
+
+        // Ignore alphabetical strings too long to be words
+        // Skip alphabetical string after maximum length and character ending it
+        if (*length > AUTOCORR_LENGTH_MAX)
+        {
+            j = *start + AUTOCORR_LENGTH_MAX + 1;
+            while (j < size && (text[j] & 0xC0) == 0x80)
+                j++;
+
+            j = skip_word (text, j, size, CLASS_LETTER) + 1;
+            continue;
+        }
+
+        // Words not followed by any character are not words yet
+        if (j == size)
+            break;
+
+        // Ignore words with numbers
+        if (char_class (text[j]) == CLASS_DIGIT)
+        {
+            j = skip_word (text, j + 1, size, CLASS_LETTER | CLASS_DIGIT) + 1;
+            continue;
+        }
+
+        // Whole word found, move past character ending it
+        *i = j + 1;
+        return true;
+    }
+
+    *i = size;
+    return false;
+}
+
+/**
+ *
+ * Checks if first length bytes of text are a single word, as next_word finds words:
+ * letters and apostrophes, starting with a letter, at most AUTOCORR_LENGTH_MAX bytes long.
+ *
+ */
+bool is_word (const char* text, size_t length)
+{
+    const unsigned char* word = (const unsigned char*) text;
+    size_t n = 1;
+
+    if (length == 0 || length > AUTOCORR_LENGTH_MAX)
+        return false;
+
+    int first = char_class (word[0]);
+    if (first == CLASS_NOT_ASCII)
+        first = decode_class (word, 0, length, &n);
+
+    if (first != CLASS_LETTER || skip_word (word, n, length, CLASS_LETTER | CLASS_APOSTROPHE) != length)
+        return false;
+
+    // Word must not end in a character cut off
+    size_t last = length - 1;
+    while (last > 0 && (word[last] & 0xC0) == 0x80)
+        last--;
+
+    return word[last] < 0x80 || decode_class (word, last, length, &n) >= 0;
+}
+
+/**
+ *
+ * Gives word of length bytes itself if it is ASCII, else folded into buffer, for lookups.
+ * Typographic apostrophes are folded, so "it’s" is read as "it's".
+ *
+ */
+const char* fold_span (const char* word, size_t length, char* buffer, size_t* folded_length)
+{
+    unsigned char bytes = 0;
+    for (size_t i = 0; i < length; i++)
+        bytes |= word[i];
+
+    *folded_length = length;
+    if (bytes < 0x80)
+        return word;
+
+    int folded = AUTOCORR_fold_word (word, length, buffer, AUTOCORR_LENGTH_MAX + 1);
+    if (folded < 0)
+        return NULL;
+
+    *folded_length = folded;
+    return buffer;
+}
+
+/**
+ *
+ * Spell-checks chunk of text, word-by-word.
+ * Lines are counted only up to misspelled words, and only for formats reporting positions.
+ * Words are checked in place in batches.
+ * Benchmarks use elapsed time of calling thread.
+ *
+ */
+void* check_chunk (void* arg)
+{
+    chunk_job* job = arg;
+    const unsigned char* text = (const unsigned char*) job -> text;
+    size_t size = job -> size;
+
+    // Timing data in nanoseconds
+    uint64_t before = stats_now ();
+    double time_correct = job -> time_correct;
+    double time_context = job -> time_context;
+
+    // Lines are counted from start of chunk
+    job -> counted = job -> text;
+
+    // Words waiting to be checked
+    const char* words[CHECK_BATCH];
+    int lens[CHECK_BATCH];
+    int n = 0;
+
+    // Spell-check each word in chunk
+    size_t i = 0, start, length;
+    while (next_word (text, size, &i, &start, &length))
+    {
+        // Update counter
+        job -> num_words++;
+
+        // Queue word, checking queue once full
+        words[n] = (const char*) text + start;
+        lens[n] = length;
+        if (++n == CHECK_BATCH)
+        {
+            if (!check_batch (job, words, lens, n))
+            {
+                job -> failed = true;
+                break;
+            }
+            n = 0;
+        }
+    }
+
+    // Check remaining words
+    if (!job -> failed && n > 0 && !check_batch (job, words, lens, n))
+        job -> failed = true;
+
+    // Position moves to end of chunk, where next chunk of file starts
+    if (job -> format != FORMAT_TEXT || job -> unique != NULL)
+        advance_position (&job -> position, job -> counted, job -> text + size - job -> counted);
+
+    // Update benchmarks, checking includes reading words from text
+    job -> time_check += (stats_now () - before) / NANO_TO_S - (job -> time_correct - time_correct) -
+                         (job -> time_context - time_context);
+
+    return NULL;
+}
@@ -0,0 +1,190 @@
+/**
+ * checker.h
+ *
+ * Spell-checking of text chunks: tokenizer and batched checks with corrections
+ * Shared by spell-checker command line and server
+ *
+ * chunk_job - chunk of text checked by one thread, with its report
+ * check_chunk - spell-check chunk of text
+ * context_words - find words next to word of text, as context of word
+ * next_word - find next word of text as spell-checker tokenizes it
+ * is_word - check if text is a single word as spell-checker tokenizes it
+ * fold_span - fold word with characters that are not ASCII for lookup in place
+ * char_class - give tokenizer classes of character
+ * is_boundary - check if text may be split after character
+ * is_space - check if character may separate word from its context
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef CHECKER_H
+#define CHECKER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../autocorrect-lib/autocorrect.h"
+#include "report.h"
+#include "stats.h"
+
+// Words of chunk checked together
+#define CHECK_BATCH 64
+
+// Most whitespace characters between word and neighbor read as its context
+#define CONTEXT_GAP 3
+
+// Character classes of tokenizer, as in C locale for ASCII
+// Bytes of UTF-8 characters that are not ASCII are classified once the character is decoded:
+// letters of alphabetic scripts as letters, typographic apostrophes as apostrophes
+#define CLASS_LETTER 1
+#define CLASS_DIGIT 2
+#define CLASS_APOSTROPHE 4
+#define CLASS_NOT_ASCII 8
+
+/**
+ * Chunk of text checked by one thread.
+ * Misspellings are reported into buffer, printed in document order once all chunks are checked.
+ */
+typedef struct
+{
+    const AUTOCORR_dict* dict;
+    AUTOCORR_ctx* ctx;
+
+    // Text of chunk, ends on word boundary unless at end of file
+    const char* text;
+    size_t size;
+
+    // Report of misspelled words in chunk
+    char* report;
+    size_t report_len;
+    size_t report_size;
+
+    // Format of report, file name as field of format and index of file among files checked
+    int format;
+    const char* file;
+    size_t file_len;
+    int file_index;
+
+    // Position in file of text counted so far, starting at text, kept if format reports positions
+    text_position position;
+    const char* counted;
+
+    // Misspellings counted as unique words instead of reported, NULL to report each occurrence
+    unique_table* unique;
+
+    // Bigram model reporting correctly spelled words their context tells against, NULL if not used
+    // Neighbors of words are read in place between context bounds, chunk bounds if NULL
+    const AUTOCORR_bigrams* bigrams;
+    const char* context_start;
+    const char* context_end;
+
+    // Counters and benchmarks
+    int misspellings;
+    int num_words;
+    double time_check;
+    double time_correct;
+    double time_context;
+    histogram check_latency;
+    histogram correct_latency;
+
+    bool failed;
+} chunk_job;
+
+/**
+ *
+ * Spell-checks chunk of text of job, word-by-word, appending misspellings to its report
+ * (or counting them in its unique table).
+ * Words are runs of letters and apostrophes not starting with an apostrophe, checked in place
+ * in batches.
+ * Position of job is moved to end of text, so chunks of one file may follow each other.
+ * Sets failed of job in case of error.
+ * Takes chunk_job* as void* so it can be run as thread, returns NULL.
+ *
+ */
+void* check_chunk (void* arg);
+
+/**
+ *
+ * Finds words before and after word of length characters, within text from start before end,
+ * setting their start and length (NULL and 0 if there is none).
+ * Neighbors are words as next_word finds them, separated from word by at most CONTEXT_GAP
+ * whitespace characters and nothing else, so punctuation ends context.
+ *
+ */
+void context_words (const char* start, const char* end, const char* word, size_t length, const char** prev,
+                    size_t* prev_length, const char** next, size_t* next_length);
+
+/**
+ *
+ * Finds next word of text from *i before size, setting its start and length.
+ * Words are runs of letters and apostrophes of UTF-8 text not starting with an apostrophe, ended
+ * by any other character than a digit; runs with digits or longer than AUTOCORR_LENGTH_MAX bytes
+ * are skipped, and so is a word at end of text, which may go on past it.
+ * Moves *i past character ending word.
+ * Returns true if word is found else false.
+ *
+ */
+bool next_word (const unsigned char* text, size_t size, size_t* i, size_t* start, size_t* length);
+
+/**
+ *
+ * Checks if first length bytes of text are a single word, as next_word finds words.
+ *
+ */
+bool is_word (const char* text, size_t length);
+
+/**
+ *
+ * Gives word of length bytes as dictionary lookups read it: word itself if it is ASCII, else
+ * folded by AUTOCORR_fold_word into buffer (AUTOCORR_LENGTH_MAX + 1 bytes), setting *folded_length.
+ * Returns NULL if word cannot be folded.
+ *
+ */
+const char* fold_span (const char* word, size_t length, char* buffer, size_t* folded_length);
+
+/**
+ *
+ * Gives tokenizer classes of byte c.
+ * Matches isalpha, isdigit in C locale for ASCII, bytes of other characters are CLASS_NOT_ASCII.
+ *
+ */
+static inline int char_class (unsigned char c)
+{
+    if ((unsigned) ((c | 0x20) - 'a') < 26)
+        return CLASS_LETTER;
+
+    if ((unsigned) (c - '0') < 10)
+        return CLASS_DIGIT;
+
+    if (c >= 0x80)
+        return CLASS_NOT_ASCII;
+
+    return (c == '\'') ? CLASS_APOSTROPHE : 0;
+}
+
+/**
+ *
+ * Returns true if text may be split after byte c.
+ * Neither a word nor a skipped alphanumeric string continues past such a character.
+ * Text is never split after a byte of a character that is not ASCII, which may be a letter
+ * or be cut off.
+ *
+ */
+static inline bool is_boundary (unsigned char c)
+{
+    return !(char_class (c) & (CLASS_LETTER | CLASS_DIGIT | CLASS_APOSTROPHE | CLASS_NOT_ASCII));
+}
+
+/**
+ *
+ * Returns true if c is whitespace that may separate word from its context.
+ *
+ */
+static inline bool is_space (unsigned char c)
+{
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+#endif // CHECKER_H
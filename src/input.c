@@ -0,0 +1,235 @@
+/**
+ * input.c
+ *
+ * Implements reading of text files to be checked.
+ * Regular files are mapped in place, pipes and other files are read batch by batch.
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+// mmap advice, posix_fadvise
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checker.h"
+#include "input.h"
+
+/**
+ *
+ * Opens text file for checking, standard input if path is "-".
+ * Maps regular files in place, other files are streamed into buffer.
+ * Returns true if successful else false.
+ *
+ */
+bool open_input (text_input* input, const char* path)
+{
+    memset (input, 0, sizeof (text_input));
+
+    // Standard input is always streamed
+    if (strcmp (path, "-") == 0)
+    {
+        input -> file = stdin;
+        return true;
+    }
+
+    if ((input -> file = fopen (path, "r")) == NULL)
+        return false;
+
+    // Empty and special files cannot be mapped
+    struct stat info;
+    if (fstat (fileno (input -> file), &info) == 0 && S_ISREG (info.st_mode) && info.st_size > 0)
+    {
+        void* map = mmap (NULL, info.st_size, PROT_READ, MAP_PRIVATE, fileno (input -> file), 0);
+        if (map != MAP_FAILED)
+        {
+            madvise (map, info.st_size, MADV_SEQUENTIAL);
+            input -> map = map;
+            input -> map_size = info.st_size;
+        }
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Gives next batch of up to size bytes of text.
+ * Streamed text is given as soon as any arrives, run being skipped removed from it.
+ * Sets last if batch reaches end of file.
+ * Returns true if successful else false.
+ *
+ */
+bool read_batch (text_input* input, size_t size, const char** batch, size_t* filled, bool* last)
+{
+    // Mapped text is used in place
+    if (input -> map != NULL)
+    {
+        *batch = input -> map + input -> offset;
+        *filled = input -> map_size - input -> offset;
+        *last = (*filled <= size);
+        if (!*last)
+            *filled = size;
+
+        return true;
+    }
+
+    // Grow buffer to size of batch
+    if (input -> buffer_size < size)
+    {
+        char* buffer = realloc (input -> buffer, size);
+        if (buffer == NULL)
+        {
+            printf ("Out of memory. Text could not be checked.\n");
+            return false;
+        }
+
+        input -> buffer = buffer;
+        input -> buffer_size = size;
+    }
+
+    // Read whatever is available after carried text, waiting only if nothing is
+    ssize_t got;
+    do
+        got = read (fileno (input -> file), input -> buffer + input -> carried, size - input -> carried);
+    while (got < 0 && errno == EINTR);
+
+    if (got < 0)
+    {
+        printf ("Error reading text file.\n");
+        return false;
+    }
+
+    *batch = input -> buffer;
+    *filled = input -> carried + got;
+    *last = (got == 0);
+
+    // Drop skipped run up to and including character ending it
+    if (input -> skipping)
+    {
+        size_t i = 0;
+        while (i < *filled && !is_boundary (input -> buffer[i]))
+            i++;
+
+        if (i < *filled)
+        {
+            input -> skipping = false;
+            memmove (input -> buffer, input -> buffer + i + 1, *filled - i - 1);
+            *filled -= i + 1;
+        }
+        else
+            *filled = 0;
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Gives next batch of about *size bytes of text, checked up to *end, its last word boundary.
+ * Partial word at end of batch is carried into next batch.
+ * Streamed batches never grow, keeping memory use constant: a run without word boundary
+ * filling a whole batch cannot be a word, and is skipped up to its end.
+ * Returns true if successful else false.
+ *
+ */
+bool read_words (text_input* input, size_t* size, const char** batch, size_t* filled, size_t* end, bool* last)
+{
+    while (read_batch (input, *size, batch, filled, last))
+    {
+        *end = *filled;
+        if (*last)
+            return true;
+
+        while (*end > 0 && !is_boundary ((*batch)[*end - 1]))
+            (*end)--;
+
+        if (*end > 0)
+            return true;
+
+        // No word boundary in batch yet, read on into batch
+        consume_batch (input, *filled, 0);
+        if (*filled < *size)
+            continue;
+
+        // Batch full, mapped text is taken in larger batch, streamed text skips run
+        if (input -> map != NULL)
+            *size *= 2;
+        else
+        {
+            input -> skipping = true;
+            input -> carried = 0;
+        }
+    }
+
+    return false;
+}
+
+/**
+ *
+ * Moves past first end of filled bytes of batch.
+ * Remaining bytes start next batch.
+ *
+ */
+void consume_batch (text_input* input, size_t filled, size_t end)
+{
+    if (input -> map != NULL)
+    {
+        input -> offset += end;
+        return;
+    }
+
+    input -> carried = filled - end;
+    memmove (input -> buffer, input -> buffer + end, input -> carried);
+}
+
+/**
+ *
+ * Gives bounds of text that may be read around batch of filled bytes: whole file if mapped,
+ * else batch itself.
+ *
+ */
+void batch_bounds (const text_input* input, const char* batch, size_t filled, const char** start, const char** end)
+{
+    *start = (input -> map != NULL) ? input -> map : batch;
+    *end = (input -> map != NULL) ? input -> map + input -> map_size : batch + filled;
+}
+
+/**
+ *
+ * Closes text file, unmapping or freeing its text.
+ *
+ */
+void close_input (text_input* input)
+{
+    if (input -> map != NULL)
+        munmap ((void*) input -> map, input -> map_size);
+
+    free (input -> buffer);
+    if (input -> file != stdin)
+        fclose (input -> file);
+}
+
+/**
+ *
+ * Asks kernel to start reading text file at path into page cache.
+ * Lets next file be read from disk while current one is checked.
+ *
+ */
+void prefetch_input (const char* path)
+{
+    int fd = open (path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+    close (fd);
+}
@@ -0,0 +1,113 @@
+/**
+ * input.h
+ *
+ * Reading of text files to be checked, batch by batch
+ *
+ * text_input - text file being checked
+ * open_input - open text file for checking
+ * read_batch - give next batch of text
+ * read_words - give next batch of text and its last word boundary
+ * consume_batch - move past checked part of batch
+ * batch_bounds - give bounds of text readable around batch
+ * close_input - close text file
+ * prefetch_input - start reading text file ahead of checking it
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Bytes of text checked by each thread per batch
+#define CHUNK_SIZE (4 << 20)
+
+/**
+ * Text being checked.
+ * Regular files are mapped in place, other files (standard input, pipes) are streamed
+ * into buffer batch by batch.
+ */
+typedef struct
+{
+    FILE* file;
+
+    // Mapping of whole file and start of next batch, NULL if file is read into buffer
+    const char* map;
+    size_t map_size;
+    size_t offset;
+
+    // Buffer holding batch, starting with text carried over from previous batch
+    char* buffer;
+    size_t buffer_size;
+    size_t carried;
+
+    // Streamed run without word boundary too long for buffer, being skipped
+    bool skipping;
+} text_input;
+
+/**
+ *
+ * Opens text file for checking, standard input if path is "-".
+ * Maps regular files in place, other files are streamed into buffer.
+ * Returns true if successful else false.
+ *
+ */
+bool open_input (text_input* input, const char* path);
+
+/**
+ *
+ * Gives next batch of up to size bytes of text.
+ * Streamed text is given as soon as any is available.
+ * Sets last if batch reaches end of file.
+ * Returns true if successful else false.
+ *
+ */
+bool read_batch (text_input* input, size_t size, const char** batch, size_t* filled, bool* last);
+
+/**
+ *
+ * Gives next batch of about *size bytes of text, as read_batch, setting *end to length
+ * of batch up to its last word boundary (whole batch at end of file).
+ * Doubles *size while mapped batch has no word boundary, streamed runs without word boundary
+ * longer than *size are skipped.
+ * Returns true if successful else false.
+ *
+ */
+bool read_words (text_input* input, size_t* size, const char** batch, size_t* filled, size_t* end, bool* last);
+
+/**
+ *
+ * Moves past first end of filled bytes of batch.
+ * Remaining bytes start next batch.
+ *
+ */
+void consume_batch (text_input* input, size_t filled, size_t end);
+
+/**
+ *
+ * Gives bounds of text that may be read around batch of filled bytes, setting *start and *end.
+ * Words next to batch are only readable in mapped files.
+ *
+ */
+void batch_bounds (const text_input* input, const char* batch, size_t filled, const char** start, const char** end);
+
+/**
+ *
+ * Closes text file, unmapping or freeing its text.
+ *
+ */
+void close_input (text_input* input);
+
+/**
+ *
+ * Asks kernel to start reading text file at path into page cache, without waiting.
+ *
+ */
+void prefetch_input (const char* path);
+
+#endif // INPUT_H
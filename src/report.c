@@ -0,0 +1,463 @@
+/**
+ * report.c
+ *
+ * Implements formats of misspelling reports.
+ * Lines are assembled with plain copies into report buffers, never with printf,
+ * so large reports cost little more than writing them.
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "report.h"
+
+// Width of word column of text report
+#define WORD_WIDTH AUTOCORR_LENGTH_MAX
+
+// Width of count column of text report of unique misspellings
+#define COUNT_WIDTH 8
+
+// Bytes of output assembled before writing, for unique misspellings
+#define WRITE_BUFFER (1 << 20)
+
+// Copies string literal s to out, advancing out
+#define PUT_LITERAL(out, s) ((out) = put ((out), (s), sizeof (s) - 1))
+
+/**
+ *
+ * Copies size bytes of data to out.
+ * Returns end of copy.
+ *
+ */
+static inline char* put (char* out, const char* data, size_t size)
+{
+    memcpy (out, data, size);
+    return out + size;
+}
+
+/**
+ *
+ * Writes decimal digits of n to out.
+ * Returns end of number.
+ *
+ */
+static char* put_number (char* out, unsigned long long n)
+{
+    char digits[20];
+    int d = 0;
+
+    do
+    {
+        digits[d++] = '0' + n % 10;
+        n /= 10;
+    }
+    while (n > 0);
+
+    while (d > 0)
+        *out++ = digits[--d];
+
+    return out;
+}
+
+/**
+ *
+ * Pads text from start to out with spaces to width characters, UTF-8 continuation bytes
+ * taking no width.
+ * Returns end of padding.
+ *
+ */
+static inline char* put_padding (char* out, const char* start, size_t width)
+{
+    size_t written = out - start;
+    for (const char* p = start; p < out; p++)
+        if ((*p & 0xC0) == 0x80)
+            written--;
+
+    if (written < width)
+    {
+        memset (out, ' ', width - written);
+        out += width - written;
+    }
+
+    return out;
+}
+
+/**
+ *
+ * Moves position past size bytes of text, counting lines.
+ *
+ */
+void advance_position (text_position* position, const char* text, size_t size)
+{
+    const char* end = text + size;
+    for (const char* nl = text; (nl = memchr (nl, '\n', end - nl)) != NULL; )
+    {
+        nl++;
+        position -> line++;
+        position -> line_start = position -> offset + (nl - text);
+    }
+
+    position -> offset += size;
+}
+
+/**
+ *
+ * Gives file name path as field of format.
+ * Returns newly allocated field if successful else NULL.
+ *
+ */
+char* escape_field (const char* path, int format)
+{
+    // Every byte escapes to at most 6 bytes (\u00XX), plus quotes and terminator
+    char* field = malloc (6 * strlen (path) + 3);
+    if (field == NULL)
+        return NULL;
+
+    char* out = field;
+    if (format == FORMAT_JSONL)
+        *out++ = '"';
+
+    for (const unsigned char* c = (const unsigned char*) path; *c != '\0'; c++)
+    {
+        if (format == FORMAT_JSONL && (*c == '"' || *c == '\\'))
+        {
+            *out++ = '\\';
+            *out++ = *c;
+        }
+        else if (format == FORMAT_JSONL && *c < 0x20)
+        {
+            static const char hex[] = "0123456789abcdef";
+            PUT_LITERAL (out, "\\u00");
+            *out++ = hex[*c >> 4];
+            *out++ = hex[*c & 0xF];
+        }
+        else if (format == FORMAT_TSV && (*c == '\t' || *c == '\n' || *c == '\r' || *c == '\\'))
+        {
+            *out++ = '\\';
+            *out++ = (*c == '\t') ? 't' : (*c == '\n') ? 'n' : (*c == '\r') ? 'r' : '\\';
+        }
+        else
+            *out++ = *c;
+    }
+
+    if (format == FORMAT_JSONL)
+        *out++ = '"';
+    *out = '\0';
+
+    return field;
+}
+
+/**
+ *
+ * Formats report line of misspelled word.
+ * Text lines are as ever printed by spellcheck, JSON Lines and TSV lines give position too.
+ * Returns length of line.
+ *
+ */
+size_t format_misspelling (char* line, int format, const char* file, size_t file_len, const char* word,
+                           size_t length, const char* correction, unsigned long count, const text_position* position)
+{
+    char* out = line;
+
+    if (format == FORMAT_TEXT)
+    {
+        out = put_padding (put (out, word, length), line, WORD_WIDTH);
+
+        if (count > 0)
+        {
+            *out++ = ' ';
+            char* number = out;
+            out = put_padding (put_number (out, count), number, COUNT_WIDTH);
+        }
+
+        if (correction == NULL)
+            PUT_LITERAL (out, " No suggested correction\n");
+        else
+        {
+            PUT_LITERAL (out, " Suggested Correction: ");
+            out = put (out, correction, strlen (correction));
+            *out++ = '\n';
+        }
+
+        return out - line;
+    }
+
+    // Columns count bytes from 1
+    unsigned long column = position -> offset - position -> line_start + 1;
+
+    if (format == FORMAT_JSONL)
+    {
+        PUT_LITERAL (out, "{\"file\":");
+        out = put (out, file, file_len);
+        PUT_LITERAL (out, ",\"line\":");
+        out = put_number (out, position -> line);
+        PUT_LITERAL (out, ",\"column\":");
+        out = put_number (out, column);
+        PUT_LITERAL (out, ",\"offset\":");
+        out = put_number (out, position -> offset);
+        PUT_LITERAL (out, ",\"word\":\"");
+        out = put (out, word, length);
+        PUT_LITERAL (out, "\",");
+
+        if (count > 0)
+        {
+            PUT_LITERAL (out, "\"count\":");
+            out = put_number (out, count);
+            *out++ = ',';
+        }
+
+        PUT_LITERAL (out, "\"suggestion\":");
+        if (correction == NULL)
+            PUT_LITERAL (out, "null}\n");
+        else
+        {
+            *out++ = '"';
+            out = put (out, correction, strlen (correction));
+            PUT_LITERAL (out, "\"}\n");
+        }
+
+        return out - line;
+    }
+
+    // Tab separated values, in order of header
+    out = put (out, file, file_len);
+    *out++ = '\t';
+    out = put_number (out, position -> line);
+    *out++ = '\t';
+    out = put_number (out, column);
+    *out++ = '\t';
+    out = put_number (out, position -> offset);
+    *out++ = '\t';
+    out = put (out, word, length);
+    *out++ = '\t';
+
+    if (count > 0)
+    {
+        out = put_number (out, count);
+        *out++ = '\t';
+    }
+
+    if (correction != NULL)
+        out = put (out, correction, strlen (correction));
+    *out++ = '\n';
+
+    return out - line;
+}
+
+/**
+ *
+ * Gives header line of report of format, NULL if it has none.
+ *
+ */
+const char* format_header (int format, bool unique)
+{
+    if (format != FORMAT_TSV)
+        return NULL;
+
+    return unique ? "file\tline\tcolumn\toffset\tword\tcount\tsuggestion\n"
+                  : "file\tline\tcolumn\toffset\tword\tsuggestion\n";
+}
+
+/**
+ *
+ * Gives hash of word of length bytes (FNV-1a).
+ *
+ */
+static uint32_t hash_word (const char* word, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char) word[i]) * 16777619u;
+
+    return hash;
+}
+
+/**
+ *
+ * Gives entry of word of length bytes in table, empty entry where it belongs if not present.
+ *
+ */
+static unique_entry* find_entry (const unique_table* table, const char* word, size_t length)
+{
+    size_t mask = table -> capacity - 1;
+    for (size_t i = hash_word (word, length) & mask; ; i = (i + 1) & mask)
+    {
+        unique_entry* entry = &table -> entries[i];
+        if (entry -> count == 0 || (strncmp (entry -> word, word, length) == 0 && entry -> word[length] == '\0'))
+            return entry;
+    }
+}
+
+/**
+ *
+ * Doubles capacity of table, keeping it at most 3/4 full.
+ * Returns true if successful else false.
+ *
+ */
+static bool grow_table (unique_table* table)
+{
+    unique_table grown = {NULL, table -> count, table -> capacity > 0 ? 2 * table -> capacity : 1024};
+    if ((grown.entries = calloc (grown.capacity, sizeof (unique_entry))) == NULL)
+        return false;
+
+    for (size_t i = 0; i < table -> capacity; i++)
+        if (table -> entries[i].count > 0)
+        {
+            const char* word = table -> entries[i].word;
+            *find_entry (&grown, word, strlen (word)) = table -> entries[i];
+        }
+
+    free (table -> entries);
+    *table = grown;
+    return true;
+}
+
+/**
+ *
+ * Counts count occurrences of misspelled word, keeping earliest first occurrence.
+ * Returns true if successful else false.
+ *
+ */
+bool unique_add (unique_table* table, const char* word, size_t length, unsigned long count, int file,
+                 const text_position* position)
+{
+    if (4 * (table -> count + 1) > 3 * table -> capacity && !grow_table (table))
+        return false;
+
+    unique_entry* entry = find_entry (table, word, length);
+    if (entry -> count == 0)
+    {
+        memcpy (entry -> word, word, length);
+        entry -> word[length] = '\0';
+        entry -> file = file;
+        entry -> first = *position;
+        table -> count++;
+    }
+    else if (file < entry -> file || (file == entry -> file && position -> offset < entry -> first.offset))
+    {
+        entry -> file = file;
+        entry -> first = *position;
+    }
+
+    entry -> count += count;
+    return true;
+}
+
+/**
+ *
+ * Adds counts and first occurrences of table from to table into.
+ * Returns true if successful else false.
+ *
+ */
+bool unique_merge (unique_table* into, const unique_table* from)
+{
+    for (size_t i = 0; i < from -> capacity; i++)
+    {
+        const unique_entry* entry = &from -> entries[i];
+        if (entry -> count > 0 &&
+            !unique_add (into, entry -> word, strlen (entry -> word), entry -> count, entry -> file, &entry -> first))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Orders entries pointed to by a and b, most frequent first, then by first occurrence, for qsort.
+ *
+ */
+static int compare_entries (const void* a, const void* b)
+{
+    const unique_entry* x = *(unique_entry* const*) a;
+    const unique_entry* y = *(unique_entry* const*) b;
+
+    if (x -> count != y -> count)
+        return (x -> count > y -> count) ? -1 : 1;
+    if (x -> file != y -> file)
+        return (x -> file < y -> file) ? -1 : 1;
+    if (x -> first.offset != y -> first.offset)
+        return (x -> first.offset < y -> first.offset) ? -1 : 1;
+
+    return strcmp (x -> word, y -> word);
+}
+
+/**
+ *
+ * Corrects each misspelled word of table once, writing them to out in order.
+ * Returns true if successful else false.
+ *
+ */
+bool unique_print (const unique_table* table, AUTOCORR_ctx* ctx, int format, char* const* paths, FILE* out)
+{
+    unique_entry** order = malloc ((table -> count + 1) * sizeof (unique_entry*));
+    char* buffer = malloc (WRITE_BUFFER);
+    char* field = NULL;
+    int field_file = -1;
+    bool printed = (order != NULL && buffer != NULL);
+
+    size_t n = 0;
+    for (size_t i = 0; i < table -> capacity && printed; i++)
+        if (table -> entries[i].count > 0)
+            order[n++] = &table -> entries[i];
+
+    if (printed)
+        qsort (order, n, sizeof (unique_entry*), compare_entries);
+
+    size_t len = 0;
+    for (size_t i = 0; i < n && printed; i++)
+    {
+        const unique_entry* entry = order[i];
+        char correction[AUTOCORR_CORRECTION_MAX];
+        bool corrected = AUTOCORR_ctx_correct (ctx, entry -> word, correction, sizeof (correction));
+
+        // File field of first occurrence, escaped once per file in a row
+        if (format != FORMAT_TEXT && entry -> file != field_file)
+        {
+            free (field);
+            field_file = entry -> file;
+            printed = ((field = escape_field (paths[field_file], format)) != NULL);
+            if (!printed)
+                break;
+        }
+        size_t field_len = (field != NULL) ? strlen (field) : 0;
+
+        // Write out buffer once next line might not fit
+        if (len + FORMAT_LINE_MAX + field_len > WRITE_BUFFER)
+        {
+            fwrite (buffer, 1, len, out);
+            len = 0;
+        }
+
+        len += format_misspelling (buffer + len, format, field, field_len, entry -> word, strlen (entry -> word),
+                                   corrected ? correction : NULL, entry -> count, &entry -> first);
+    }
+
+    if (printed)
+        fwrite (buffer, 1, len, out);
+    else
+        printf ("Out of memory. Misspellings could not be reported.\n");
+
+    free (field);
+    free (buffer);
+    free (order);
+    return printed;
+}
+
+/**
+ *
+ * Frees table of unique misspellings.
+ *
+ */
+void unique_free (unique_table* table)
+{
+    free (table -> entries);
+    memset (table, 0, sizeof (unique_table));
+}
@@ -0,0 +1,138 @@
+/**
+ * report.h
+ *
+ * Formats of misspelling reports: text, JSON Lines and TSV, one occurrence or unique word per line
+ *
+ * text_position - byte offset and line of position in text file
+ * advance_position - move position past text, counting lines
+ * escape_field - quote file name as field of report format
+ * format_misspelling - format report line of misspelling
+ * format_header - give header line of report format
+ * unique_table - misspelled words with counts and first occurrences
+ * unique_add - count occurrence of misspelled word
+ * unique_merge - add counts of one table to another
+ * unique_print - correct and print unique misspellings, most frequent first
+ * unique_free - free table of unique misspellings
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "../autocorrect-lib/autocorrect.h"
+
+// Report formats
+#define FORMAT_TEXT 0
+#define FORMAT_JSONL 1
+#define FORMAT_TSV 2
+
+// Bytes of report line besides escaped file name
+#define FORMAT_LINE_MAX 384
+
+/**
+ * Position in text file: byte offset, line number (from 1) and byte offset of line start.
+ */
+typedef struct
+{
+    size_t offset;
+    long line;
+    size_t line_start;
+} text_position;
+
+/**
+ * Misspelled word, occurrences and first occurrence, file being index of file checked.
+ */
+typedef struct
+{
+    char word[AUTOCORR_LENGTH_MAX + 1];
+    unsigned long count;
+    int file;
+    text_position first;
+} unique_entry;
+
+/**
+ * Hash table of misspelled words, open addressing.
+ */
+typedef struct
+{
+    unique_entry* entries;
+    size_t count;
+    size_t capacity;
+} unique_table;
+
+/**
+ *
+ * Moves position past size bytes of text, counting lines.
+ *
+ */
+void advance_position (text_position* position, const char* text, size_t size);
+
+/**
+ *
+ * Gives file name path as field of format: quoted string for JSON Lines, tabs, newlines and
+ * backslashes escaped for TSV, unchanged for text.
+ * Returns newly allocated field if successful else NULL.
+ *
+ */
+char* escape_field (const char* path, int format);
+
+/**
+ *
+ * Formats report line of misspelled word of length bytes at position in file (escaped field),
+ * with its suggested correction (NULL if none) and number of occurrences (0 if not counted).
+ * Line must have room for FORMAT_LINE_MAX bytes and file field.
+ * Returns length of line.
+ *
+ */
+size_t format_misspelling (char* line, int format, const char* file, size_t file_len, const char* word,
+                           size_t length, const char* correction, unsigned long count, const text_position* position);
+
+/**
+ *
+ * Gives header line of report of format, NULL if it has none.
+ *
+ */
+const char* format_header (int format, bool unique);
+
+/**
+ *
+ * Counts count occurrences of misspelled word of length bytes, first at position of file.
+ * Earliest first occurrence is kept.
+ * Returns true if successful else false.
+ *
+ */
+bool unique_add (unique_table* table, const char* word, size_t length, unsigned long count, int file,
+                 const text_position* position);
+
+/**
+ *
+ * Adds counts and first occurrences of table from to table into.
+ * Returns true if successful else false.
+ *
+ */
+bool unique_merge (unique_table* into, const unique_table* from);
+
+/**
+ *
+ * Corrects each misspelled word of table once using ctx, and writes them to out in format,
+ * most frequent first, then in order of first occurrence; paths are names of files checked.
+ * Returns true if successful else false.
+ *
+ */
+bool unique_print (const unique_table* table, AUTOCORR_ctx* ctx, int format, char* const* paths, FILE* out);
+
+/**
+ *
+ * Frees table of unique misspellings.
+ *
+ */
+void unique_free (unique_table* table);
+
+#endif // REPORT_H
@@ -0,0 +1,548 @@
+/**
+ * server.c
+ *
+ * Implements resident spell-check server over Unix domain socket, and its client.
+ * One thread per connected client, each with its own correction state.
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+// sigaction, MSG_NOSIGNAL, lstat
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "checker.h"
+#include "server.h"
+
+// Maximum number of clients connected at once
+#define CLIENTS_MAX 256
+
+// Interval at which accepting clients checks for interruption
+#define ACCEPT_POLL_MS 200
+
+// Bytes of frame header (payload length)
+#define FRAME_HEADER 4
+
+/**
+ * State shared by all client threads of server.
+ */
+typedef struct
+{
+    const AUTOCORR_dict* dict;
+    int edit_distance;
+    AUTOCORR_cache* cache;
+    const AUTOCORR_bigrams* bigrams;
+
+    // Sockets of connected clients, -1 if slot free
+    pthread_mutex_t lock;
+    pthread_cond_t idle;
+    int clients[CLIENTS_MAX];
+    int connected;
+} server;
+
+/**
+ * Client connection, owned by its thread.
+ */
+typedef struct
+{
+    server* srv;
+    int slot;
+    int fd;
+} client;
+
+// Set by SIGINT and SIGTERM to stop serving
+static volatile sig_atomic_t stopping = 0;
+
+/**
+ *
+ * Stops server on signal.
+ *
+ */
+static void stop_serving (int signal)
+{
+    stopping = 1;
+}
+
+/**
+ *
+ * Writes size bytes of data to socket fd, without raising SIGPIPE.
+ * Returns true if successful else false.
+ *
+ */
+static bool write_all (int fd, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = send (fd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+
+        data += written;
+        size -= written;
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Reads size bytes from socket fd into data.
+ * Returns true if successful, false on error or end of connection.
+ *
+ */
+static bool read_all (int fd, char* data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t got = read (fd, data, size);
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return false;
+
+        data += got;
+        size -= got;
+    }
+
+    return true;
+}
+
+/**
+ *
+ * Writes frame of code byte followed by head_len bytes of head and body_len bytes of body.
+ * Returns true if successful else false.
+ *
+ */
+static bool write_frame (int fd, char code, const char* head, size_t head_len, const char* body, size_t body_len)
+{
+    size_t length = 1 + head_len + body_len;
+    char header[FRAME_HEADER + 1] = {length >> 24, length >> 16, length >> 8, length, code};
+
+    return write_all (fd, header, sizeof (header)) && write_all (fd, head, head_len) &&
+           write_all (fd, body, body_len);
+}
+
+/**
+ *
+ * Reads frame into *buffer, grown as needed from *buffer_size bytes, and terminates it.
+ * Sets *length to payload length.
+ * Returns true if successful, false on error, oversized frame or end of connection.
+ *
+ */
+static bool read_frame (int fd, char** buffer, size_t* buffer_size, size_t* length)
+{
+    unsigned char header[FRAME_HEADER];
+    if (!read_all (fd, (char*) header, FRAME_HEADER))
+        return false;
+
+    *length = (size_t) header[0] << 24 | header[1] << 16 | header[2] << 8 | header[3];
+    if (*length == 0 || *length > SERVE_FRAME_MAX)
+        return false;
+
+    if (*buffer_size < *length + 1)
+    {
+        char* grown = realloc (*buffer, *length + 1);
+        if (grown == NULL)
+            return false;
+
+        *buffer = grown;
+        *buffer_size = *length + 1;
+    }
+
+    (*buffer)[*length] = '\0';
+    return read_all (fd, *buffer, *length);
+}
+
+/**
+ *
+ * Answers request of length bytes from client on socket fd.
+ * Documents are checked with job, using its correction state.
+ * Returns true if reply sent else false.
+ *
+ */
+static bool answer (int fd, chunk_job* job, const char* request, size_t length)
+{
+    const char* argument = request + 1;
+    size_t size = length - 1;
+    char reply[AUTOCORR_CORRECTION_MAX];
+
+    switch (request[0])
+    {
+        case SERVE_CHECK:
+            if (!is_word (argument, size))
+                break;
+
+            snprintf (reply, sizeof (reply), "%d", AUTOCORR_dict_check_span (job -> dict, argument, size));
+            return write_frame (fd, SERVE_OK, reply, strlen (reply), NULL, 0);
+
+        case SERVE_CORRECT:
+        {
+            if (!is_word (argument, size))
+                break;
+
+            // Folded copy of word for correction
+            char word[AUTOCORR_LENGTH_MAX + 1];
+            if (AUTOCORR_fold_word (argument, size, word, sizeof (word)) < 0)
+                break;
+
+            if (!AUTOCORR_ctx_correct (job -> ctx, word, reply, sizeof (reply)))
+                reply[0] = '\0';
+            return write_frame (fd, SERVE_OK, reply, strlen (reply), NULL, 0);
+        }
+
+        case SERVE_SUGGEST:
+        {
+            // Number of suggestions, then word after a space
+            char* rest;
+            long k = strtol (argument, &rest, 10);
+            if (rest == argument || *rest != ' ' || k < 1)
+            {
+                const char* error = "Bad number of suggestions";
+                return write_frame (fd, SERVE_ERROR, error, strlen (error), NULL, 0);
+            }
+
+            rest++;
+            size -= rest - argument;
+            if (!is_word (rest, size))
+                break;
+
+            char word[AUTOCORR_LENGTH_MAX + 1];
+            if (AUTOCORR_fold_word (rest, size, word, sizeof (word)) < 0)
+                break;
+
+            AUTOCORR_suggestion suggestions[AUTOCORR_SUGGEST_MAX];
+            int n = AUTOCORR_ctx_suggest (job -> ctx, word, k < AUTOCORR_SUGGEST_MAX ? k : AUTOCORR_SUGGEST_MAX,
+                                          suggestions);
+
+            // One line per suggestion: word, edit distance and frequency, separated by tabs
+            char lines[AUTOCORR_SUGGEST_MAX * (AUTOCORR_CORRECTION_MAX + 24)];
+            size_t len = 0;
+            for (int i = 0; i < n; i++)
+                len += snprintf (lines + len, sizeof (lines) - len, "%s\t%d\t%d\n", suggestions[i].word,
+                                 suggestions[i].distance, suggestions[i].frequency);
+
+            return write_frame (fd, SERVE_OK, lines, len, NULL, 0);
+        }
+
+        case SERVE_DOCUMENT:
+            job -> text = argument;
+            job -> size = size;
+            job -> report_len = 0;
+            job -> misspellings = 0;
+            job -> num_words = 0;
+            check_chunk (job);
+
+            if (job -> failed)
+            {
+                job -> failed = false;
+                const char* error = "Out of memory";
+                return write_frame (fd, SERVE_ERROR, error, strlen (error), NULL, 0);
+            }
+
+            snprintf (reply, sizeof (reply), "%d %d %u\n", job -> num_words, job -> misspellings,
+                      AUTOCORR_dict_size (job -> dict));
+            return write_frame (fd, SERVE_OK, reply, strlen (reply), job -> report, job -> report_len);
+
+        default:
+        {
+            const char* error = "Unknown command";
+            return write_frame (fd, SERVE_ERROR, error, strlen (error), NULL, 0);
+        }
+    }
+
+    const char* error = "Not a word";
+    return write_frame (fd, SERVE_ERROR, error, strlen (error), NULL, 0);
+}
+
+/**
+ *
+ * Answers requests of client until it disconnects or server stops.
+ * Runs as thread of client, freeing it.
+ *
+ */
+static void* serve_client (void* arg)
+{
+    client* conn = arg;
+    server* srv = conn -> srv;
+
+    // Correction state and report buffer of client
+    chunk_job job;
+    memset (&job, 0, sizeof (job));
+    job.dict = srv -> dict;
+    job.bigrams = srv -> bigrams;
+    job.ctx = AUTOCORR_ctx_new (srv -> dict);
+
+    if (job.ctx != NULL && AUTOCORR_ctx_set_edit_distance (job.ctx, srv -> edit_distance))
+    {
+        AUTOCORR_ctx_set_cache (job.ctx, srv -> cache);
+
+        char* request = NULL;
+        size_t request_size = 0, length;
+        while (read_frame (conn -> fd, &request, &request_size, &length) &&
+               answer (conn -> fd, &job, request, length));
+
+        free (request);
+    }
+
+    free (job.report);
+    AUTOCORR_ctx_free (job.ctx);
+
+    // Free slot before closing, so socket is never shut down once reused
+    pthread_mutex_lock (&srv -> lock);
+    srv -> clients[conn -> slot] = -1;
+    srv -> connected--;
+    pthread_cond_signal (&srv -> idle);
+    pthread_mutex_unlock (&srv -> lock);
+
+    close (conn -> fd);
+    free (conn);
+
+    return NULL;
+}
+
+/**
+ *
+ * Starts thread answering client connected on socket fd.
+ * Returns true if successful, else false, refusing client.
+ *
+ */
+static bool start_client (server* srv, int fd)
+{
+    client* conn = malloc (sizeof (client));
+    if (conn == NULL)
+        return false;
+
+    conn -> srv = srv;
+    conn -> fd = fd;
+    conn -> slot = -1;
+
+    pthread_mutex_lock (&srv -> lock);
+    for (int i = 0; i < CLIENTS_MAX && conn -> slot < 0; i++)
+        if (srv -> clients[i] < 0)
+            conn -> slot = i;
+
+    if (conn -> slot < 0)
+    {
+        pthread_mutex_unlock (&srv -> lock);
+        free (conn);
+        return false;
+    }
+
+    srv -> clients[conn -> slot] = fd;
+    srv -> connected++;
+    pthread_mutex_unlock (&srv -> lock);
+
+    // Threads of clients are never joined
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+    bool started = (pthread_create (&thread, &attr, serve_client, conn) == 0);
+    pthread_attr_destroy (&attr);
+
+    if (!started)
+    {
+        pthread_mutex_lock (&srv -> lock);
+        srv -> clients[conn -> slot] = -1;
+        srv -> connected--;
+        pthread_mutex_unlock (&srv -> lock);
+        free (conn);
+    }
+
+    return started;
+}
+
+/**
+ *
+ * Fills address of Unix domain socket at path.
+ * Returns true if successful, false if path is too long.
+ *
+ */
+static bool socket_address (const char* path, struct sockaddr_un* address)
+{
+    memset (address, 0, sizeof (struct sockaddr_un));
+    address -> sun_family = AF_UNIX;
+
+    if (strlen (path) >= sizeof (address -> sun_path))
+    {
+        printf ("Socket path too long - %s.\n", path);
+        return false;
+    }
+
+    strcpy (address -> sun_path, path);
+    return true;
+}
+
+/**
+ *
+ * Listens on Unix domain socket at path and answers requests of clients until interrupted.
+ * Returns true if successful else false.
+ *
+ */
+bool serve (const char* path, const AUTOCORR_dict* dict, int edit_distance, AUTOCORR_cache* cache,
+            const AUTOCORR_bigrams* bigrams)
+{
+    struct sockaddr_un address;
+    if (!socket_address (path, &address))
+        return false;
+
+    // Remove socket left behind by stopped server, never a running server's or another file
+    struct stat info;
+    if (lstat (path, &info) == 0)
+    {
+        int running = server_connect (path);
+        if (running >= 0 || !S_ISSOCK (info.st_mode))
+        {
+            printf ("Could not serve on %s, %s.\n", path, running >= 0 ? "server already running" : "file exists");
+            if (running >= 0)
+                close (running);
+            return false;
+        }
+
+        unlink (path);
+    }
+
+    int listener = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind (listener, (struct sockaddr*) &address, sizeof (address)) != 0 ||
+        listen (listener, SOMAXCONN) != 0)
+    {
+        printf ("Could not serve on %s - %s.\n", path, strerror (errno));
+        if (listener >= 0)
+            close (listener);
+        return false;
+    }
+
+    server srv;
+    srv.dict = dict;
+    srv.edit_distance = edit_distance;
+    srv.cache = cache;
+    srv.bigrams = bigrams;
+    srv.connected = 0;
+    pthread_mutex_init (&srv.lock, NULL);
+    pthread_cond_init (&srv.idle, NULL);
+    for (int i = 0; i < CLIENTS_MAX; i++)
+        srv.clients[i] = -1;
+
+    // Stop on interruption, without restarting interrupted calls
+    struct sigaction action;
+    memset (&action, 0, sizeof (action));
+    action.sa_handler = stop_serving;
+    sigemptyset (&action.sa_mask);
+    sigaction (SIGINT, &action, NULL);
+    sigaction (SIGTERM, &action, NULL);
+
+    printf ("Serving on %s.\n", path);
+    fflush (stdout);
+
+    // Accept clients, checking for interruption between waits
+    while (!stopping)
+    {
+        struct pollfd waiting = {.fd = listener, .events = POLLIN};
+        if (poll (&waiting, 1, ACCEPT_POLL_MS) <= 0)
+            continue;
+
+        int fd = accept (listener, NULL, NULL);
+        if (fd < 0)
+            continue;
+
+        if (!start_client (&srv, fd))
+        {
+            const char* error = "Server busy";
+            write_frame (fd, SERVE_ERROR, error, strlen (error), NULL, 0);
+            close (fd);
+        }
+    }
+
+    close (listener);
+    unlink (path);
+
+    // Disconnect clients and wait for their threads to finish with word data
+    pthread_mutex_lock (&srv.lock);
+    for (int i = 0; i < CLIENTS_MAX; i++)
+        if (srv.clients[i] >= 0)
+            shutdown (srv.clients[i], SHUT_RDWR);
+
+    while (srv.connected > 0)
+        pthread_cond_wait (&srv.idle, &srv.lock);
+    pthread_mutex_unlock (&srv.lock);
+
+    pthread_cond_destroy (&srv.idle);
+    pthread_mutex_destroy (&srv.lock);
+
+    printf ("Server stopped.\n");
+    return true;
+}
+
+/**
+ *
+ * Connects to server listening on Unix domain socket at path.
+ * Returns connected socket if successful else -1.
+ *
+ */
+int server_connect (const char* path)
+{
+    struct sockaddr_un address;
+    if (!socket_address (path, &address))
+        return -1;
+
+    int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect (fd, (struct sockaddr*) &address, sizeof (address)) != 0)
+    {
+        close (fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+/**
+ *
+ * Sends request of command with size bytes of data to server, and receives reply into *reply.
+ * Returns true if server answered request else false, printing error.
+ *
+ */
+bool server_request (int fd, char command, const char* data, size_t size, char** reply, size_t* reply_size,
+                     size_t* reply_len)
+{
+    if (size >= SERVE_FRAME_MAX)
+    {
+        printf ("Request too large for server.\n");
+        return false;
+    }
+
+    size_t length;
+    if (!write_frame (fd, command, data, size, NULL, 0) || !read_frame (fd, reply, reply_size, &length))
+    {
+        printf ("Lost connection to server.\n");
+        return false;
+    }
+
+    // Reply follows status byte, moved with its terminator
+    char status = (*reply)[0];
+    *reply_len = length - 1;
+    memmove (*reply, *reply + 1, length);
+
+    if (status != SERVE_OK)
+    {
+        printf ("Server error - %s.\n", *reply);
+        return false;
+    }
+
+    return true;
+}
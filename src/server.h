@@ -0,0 +1,78 @@
+/**
+ * server.h
+ *
+ * Resident spell-check server over Unix domain socket, and its client
+ * Word data is loaded once and shared by all clients, each answered on its own thread
+ *
+ * Requests and replies are frames: 4-byte payload length (big-endian), then payload.
+ * Request payload is command byte followed by argument:
+ *     SERVE_CHECK word - reply is word frequency, -1 if misspelled
+ *     SERVE_CORRECT word - reply is suggested correction, empty if none
+ *     SERVE_SUGGEST k word - reply is line "word distance frequency" (tab separated) for each
+ *                            of up to k suggestions, closest first, empty if none
+ *     SERVE_DOCUMENT text - reply is line "words misspellings dictionary_words", then
+ *                           report of misspelled words as printed by spellcheck
+ * Reply payload is SERVE_OK followed by reply, or SERVE_ERROR followed by error message.
+ *
+ * serve - answer requests of clients on socket until interrupted
+ * server_connect - connect to server
+ * server_request - send request to server and receive reply
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../autocorrect-lib/autocorrect.h"
+
+// Request commands
+#define SERVE_CHECK 'c'
+#define SERVE_CORRECT 'r'
+#define SERVE_SUGGEST 's'
+#define SERVE_DOCUMENT 'd'
+
+// Reply status
+#define SERVE_OK '+'
+#define SERVE_ERROR '-'
+
+// Largest frame payload accepted
+#define SERVE_FRAME_MAX (64 << 20)
+
+/**
+ *
+ * Listens on Unix domain socket at path and answers requests of any number of clients
+ * concurrently, correcting within edit_distance and sharing cache (may be NULL).
+ * Documents are checked in context of neighboring words with bigrams, if not NULL.
+ * Serves until interrupted (SIGINT or SIGTERM), then closes all connections and removes socket.
+ * Returns true if successful else false.
+ *
+ */
+bool serve (const char* path, const AUTOCORR_dict* dict, int edit_distance, AUTOCORR_cache* cache,
+            const AUTOCORR_bigrams* bigrams);
+
+/**
+ *
+ * Connects to server listening on Unix domain socket at path.
+ * Returns connected socket if successful else -1.
+ *
+ */
+int server_connect (const char* path);
+
+/**
+ *
+ * Sends request of command with size bytes of data to server on socket fd, and receives reply.
+ * Reply is terminated and stored in *reply, grown as needed from *reply_size bytes,
+ * its length being set in *reply_len.
+ * Returns true if server answered request else false, printing error.
+ *
+ */
+bool server_request (int fd, char command, const char* data, size_t size, char** reply, size_t* reply_size,
+                     size_t* reply_len);
+
+#endif // SERVER_H
@@ -10,205 +10,960 @@
  *
  */
 
-#include <ctype.h>
+
+// clock_gettime
+#define _DEFAULT_SOURCE
+
+#include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
-#include <sys/resource.h>
-#include <sys/time.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "../autocorrect-lib/autocorrect.h"
+#include "batch.h"
+#include "checker.h"
+#include "input.h"
+#include "report.h"
+#include "server.h"
+#include "stats.h"
+
+// Maximum number of checking threads
+#define JOBS_MAX 64
+
+// Smallest chunk of batch worth checking on its own thread
+#define SPLIT_MIN (64 << 10)
+
+// Bytes of standard output buffered when it is not a terminal
+#define OUTPUT_BUFFER (1 << 20)
 
-#undef calculate
-#undef getrusage
+// Maximum number of overlay dictionaries layered over word data
+#define OVERLAYS_MAX 16
+
+// Maximum megabytes of memory cap options
+#define MEGABYTES_MAX (1 << 20)
+
+/**
+ * Output policy of streamed text (standard input, pipes).
+ */
+typedef struct
+{
+    // Milliseconds between flushes of misspellings reported, 0 to flush after every batch
+    int flush_ms;
 
-// Microseconds to a second
-#define MICRO_TO_S 1000000.0
+    // Seconds between running totals printed to standard error, 0 for none
+    int stats_every;
+} stream_policy;
 
-// Returns number of seconds between b and a
-double calculate (const struct rusage* b, const struct rusage* a);
+// Spell-checks text file, splitting it between threads
+static bool check_text (const char* path, chunk_job* job, int jobs, const stream_policy* policy);
+
+// Gives monotonic clock time in milliseconds
+static uint64_t clock_ms (void);
+
+// Spell-checks text file on server
+static int check_remote (const char* socket_path, const char* path, bool stats_json);
+
+// Adds words of word list file to word data
+static int learn_words (const char* path, size_t log_bytes);
+
+// Unloads word data and overlays layered over it
+static void unload_layers (AUTOCORR_dict** layers, int count);
+
+// Parses megabytes of memory cap option into bytes
+static bool parse_megabytes (const char* value, size_t* bytes);
+
+// Parses whole number option within range
+static bool parse_number (const char* value, int min, int max, int* number);
 
 int main (int argc, char* argv[])
 {
-    char* text;
+    // Compile word data file into binary image for fast loading
+    if (argc >= 2 && argc <= 3 && strcmp (argv[1], "--compile-dict") == 0)
+    {
+        if (!AUTOCORR_compile_data (argc == 3 ? argv[2] : NULL))
+        {
+            printf ("Could not compile word data file.\n");
+            return 1;
+        }
+
+        printf ("Compiled word data image.\n");
+        return 0;
+    }
+
+    // Add words or frequencies of word list to word data, merging delta log past its limit
+    if (argc == 3 && strcmp (argv[1], "--learn") == 0)
+        return learn_words (argv[2], 0);
+
+    if (argc == 5 && strcmp (argv[1], "--log-kb") == 0 && strcmp (argv[3], "--learn") == 0)
+    {
+        int log_kb;
+        if (!parse_number (argv[2], 0, MEGABYTES_MAX, &log_kb))
+        {
+            printf ("Delta log limit must be between 0 and %d KB.\n", MEGABYTES_MAX);
+            return 1;
+        }
+        return learn_words (argv[4], (size_t) log_kb << 10);
+    }
+
+    // Merge learned words into word data file
+    if (argc == 2 && strcmp (argv[1], "--compact-dict") == 0)
+    {
+        AUTOCORR_dict* dict = AUTOCORR_dict_upload ();
+        bool compacted = (dict != NULL && AUTOCORR_dict_compact (dict));
+        AUTOCORR_dict_unload (dict);
+
+        printf (compacted ? "Merged learned words into word data.\n" : "Could not merge learned words into word data.\n");
+        return compacted ? 0 : 1;
+    }
+
+    // Edit distance of trie search corrections
+    int edit_distance = 1;
+
+    // Edit distance answered by symmetric-delete index, 0 if index not used
+    int index_distance = 0;
+    size_t index_bytes = 0;
+
+    // Number of threads checking text
+    int jobs = 1;
+
+    // Number of most frequent words checked while the rest of word data loads, 0 to load all at once
+    int core_words = 0;
+
+    // Memory cap of correction cache shared by all threads, 0 if cache not used
+    size_t cache_bytes = (size_t) 16 << 20;
+
+    // Report benchmarks as JSON instead of text
+    bool stats_json = false;
+
+    // Format of misspellings reported, and whether each misspelled word is reported once with its count
+    int format = FORMAT_TEXT;
+    bool unique = false;
+
+    // Report correctly spelled words confused with another word, by bigram model of their neighbors
+    bool context = false;
+
+    // Flushing and running totals of streamed text
+    stream_policy policy = {0, 0};
+
+    // Extensions of text files checked in directories
+    const char* extensions = BATCH_EXTENSIONS;
+
+    // Files of words added or suppressed, layered over word data in order given
+    const char* overlay_paths[OVERLAYS_MAX];
+    int overlays = 0;
+
+    // Socket to serve requests on, or of server to check text file with
+    const char* serve_path = NULL;
+    const char* connect_path = NULL;
+
+    // Parse options preceding text files
+    int arg = 1;
+    for (; arg < argc - 1 && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp (argv[arg], "--stats=json") == 0 || strcmp (argv[arg], "--stats=text") == 0)
+        {
+            stats_json = (strcmp (argv[arg], "--stats=json") == 0);
+            continue;
+        }
+
+        if (strcmp (argv[arg], "--unique") == 0)
+        {
+            unique = true;
+            continue;
+        }
+
+        if (strcmp (argv[arg], "--context") == 0)
+        {
+            context = true;
+            continue;
+        }
+
+        // Other options take value from next argument
+        const char* option = argv[arg++];
+        const char* value = argv[arg];
+
+        if (strcmp (option, "-d") == 0 || strcmp (option, "--edit-distance") == 0)
+        {
+            edit_distance = atoi (value);
+            if (edit_distance < 1 || edit_distance > 3)
+            {
+                printf ("Edit distance must be between 1 and 3.\n");
+                return 1;
+            }
+        }
+
+        else if (strcmp (option, "--deletes-index") == 0)
+        {
+            if (!parse_number (value, 0, 3, &index_distance))
+            {
+                printf ("Deletes index distance must be between 0 and 3.\n");
+                return 1;
+            }
+        }
+
+        else if (strcmp (option, "--index-mb") == 0)
+        {
+            if (!parse_megabytes (value, &index_bytes))
+            {
+                printf ("Index size must be between 0 and %d MB.\n", MEGABYTES_MAX);
+                return 1;
+            }
+        }
+
+        else if (strcmp (option, "--cache-mb") == 0)
+        {
+            if (!parse_megabytes (value, &cache_bytes))
+            {
+                printf ("Cache size must be between 0 and %d MB.\n", MEGABYTES_MAX);
+                return 1;
+            }
+        }
 
-    // Check for correct number of args
-    if (argc != 2)
+        else if (strcmp (option, "--core-words") == 0)
+        {
+            if (!parse_number (value, 0, INT_MAX, &core_words))
+            {
+                printf ("Number of core words must be between 0 and %d.\n", INT_MAX);
+                return 1;
+            }
+        }
+
+        else if (strcmp (option, "-j") == 0 || strcmp (option, "--jobs") == 0)
+        {
+            jobs = atoi (value);
+            if (jobs < 1 || jobs > JOBS_MAX)
+            {
+                printf ("Number of jobs must be between 1 and %d.\n", JOBS_MAX);
+                return 1;
+            }
+        }
+
+        else if (strcmp (option, "--flush-ms") == 0)
+        {
+            if (!parse_number (value, 0, INT_MAX, &policy.flush_ms))
+            {
+                printf ("Flush interval must be between 0 and %d milliseconds.\n", INT_MAX);
+                return 1;
+            }
+        }
+
+        else if (strcmp (option, "--stats-every") == 0)
+        {
+            if (!parse_number (value, 0, INT_MAX, &policy.stats_every))
+            {
+                printf ("Interval of running totals must be between 0 and %d seconds.\n", INT_MAX);
+                return 1;
+            }
+        }
+
+        else if (strcmp (option, "--ext") == 0)
+            extensions = value;
+
+        else if (strcmp (option, "--overlay") == 0)
+        {
+            if (overlays == OVERLAYS_MAX)
+            {
+                printf ("At most %d overlays can be layered.\n", OVERLAYS_MAX);
+                return 1;
+            }
+            overlay_paths[overlays++] = value;
+        }
+
+        else if (strcmp (option, "--format") == 0)
+        {
+            if (strcmp (value, "text") == 0)
+                format = FORMAT_TEXT;
+            else if (strcmp (value, "jsonl") == 0)
+                format = FORMAT_JSONL;
+            else if (strcmp (value, "tsv") == 0)
+                format = FORMAT_TSV;
+            else
+            {
+                printf ("Report format must be text, jsonl or tsv.\n");
+                return 1;
+            }
+        }
+
+        else if (strcmp (option, "--serve") == 0)
+            serve_path = value;
+
+        else if (strcmp (option, "--connect") == 0)
+            connect_path = value;
+
+        // Unknown option
+        else
+        {
+            arg = argc;
+            break;
+        }
+    }
+
+    // Check for correct number of args, server takes no text file and client one
+    // Server and client report in text format only, client checks context if server does
+    // Unique misspellings are corrected once all text is checked, without context
+    int paths = argc - arg;
+    bool text_report = (format == FORMAT_TEXT && !unique);
+    if ((serve_path != NULL && (paths != 0 || connect_path != NULL || !text_report)) ||
+        (connect_path != NULL && (paths != 1 || !text_report || context)) || (serve_path == NULL && paths == 0) ||
+        (context && unique))
     {
-        printf("Usage: spellcheck text_file\n");
+        printf("Usage: spellcheck [-d distance] [--deletes-index distance] [--index-mb megabytes] [--cache-mb megabytes] [--overlay words_file]... [--core-words words] [-j jobs] [--ext extensions] [--flush-ms milliseconds] [--stats-every seconds] [--format text|jsonl|tsv] [--unique | --context] [--stats=json] path...\n");
+        printf("       Path - checks standard input as a stream.\n");
+        printf("       spellcheck [-d distance] [--deletes-index distance] [--index-mb megabytes] [--cache-mb megabytes] [--overlay words_file]... [--context] --serve socket_file\n");
+        printf("       spellcheck [--stats=json] --connect socket_file text_file\n");
+        printf("       spellcheck --compile-dict [image_file]\n");
+        printf("       spellcheck [--log-kb kilobytes] --learn word_list_file\n");
+        printf("       spellcheck --compact-dict\n");
         return 1;
     }
 
-    // Structs for timing data
-    struct rusage before, after;
+    // Check text file on server, without loading word data
+    if (connect_path != NULL)
+        return check_remote (connect_path, argv[arg], stats_json);
 
-    // Benchmarks for autocorrect and dictionary function times
-    double time_load = 0.0, time_correct = 0.0, time_check = 0.0, time_size = 0.0, time_unload = 0.0;
+    // Reports are written in large blocks unless read as they are printed
+    if (!isatty (STDOUT_FILENO))
+        setvbuf (stdout, NULL, _IOFBF, OUTPUT_BUFFER);
 
-    // Determine text file to use
-    text = argv[1];
+    // Benchmarks go to standard error when standard output is a machine-readable report
+    FILE* stats_out = (format == FORMAT_TEXT) ? stdout : stderr;
 
-    // Load word data
-    getrusage (RUSAGE_SELF, &before);
-    bool loaded_table = AUTOCORR_upload ();
-    getrusage (RUSAGE_SELF, &after);
+    // Timing data in nanoseconds
+    uint64_t before;
+
+    // Results and benchmarks for autocorrect and dictionary function times
+    run_stats stats;
+    memset (&stats, 0, sizeof (stats));
+    stats.jobs = jobs;
+    stats.index_used = (index_distance > 0);
+    stats.context_used = context;
+    stats.cache_used = (cache_bytes > 0);
+    stats.overlays = overlays;
+
+    // Several files or directories are checked one file per thread
+    struct stat info;
+    bool batch = (paths > 1 || (paths == 1 && stat (argv[arg], &info) == 0 && S_ISDIR (info.st_mode)));
+
+    // Find text files to check before loading word data
+    file_list files = {NULL, 0, 0};
+    if (batch && !list_files (&files, argv + arg, paths, extensions))
+    {
+        free_files (&files);
+        return 1;
+    }
+    stats.files = files.count;
+
+    // Load word data, shared by all threads, most frequent words first if tiered
+    before = stats_now ();
+    AUTOCORR_dict* dict = (core_words > 0) ? AUTOCORR_dict_upload_tiered (core_words) : AUTOCORR_dict_upload ();
 
     // Calculate time to load word data
-    time_load = calculate (&before, &after);
+    stats.time_load = (stats_now () - before) / NANO_TO_S;
 
     // Abort if word data not loaded
-    if (!loaded_table)
+    if (dict == NULL)
     {
         printf ("Could not load word data file.\n");
         return 1;
     }
 
-    FILE* text_file = fopen (text, "r");
-    if (text_file == NULL)
+    // Index word deletes for corrections within larger edit distances
+    if (index_distance > 0)
+    {
+        before = stats_now ();
+        bool indexed = AUTOCORR_dict_build_deletes_index (dict, index_distance, index_bytes);
+
+        // Calculate time to build index
+        stats.time_index = (stats_now () - before) / NANO_TO_S;
+
+        if (!indexed)
+        {
+            printf ("Could not build deletes index.\n");
+            AUTOCORR_dict_unload (dict);
+            return 1;
+        }
+    }
+
+    // Layer overlays over word data, top one checked first, each sharing dicts below it
+    AUTOCORR_dict* layers[OVERLAYS_MAX + 1] = { dict };
+    int number_layers = 1;
+    before = stats_now ();
+    for (; number_layers <= overlays; number_layers++)
+    {
+        if ((layers[number_layers] = AUTOCORR_dict_overlay (dict, overlay_paths[number_layers - 1])) == NULL)
+        {
+            printf ("Could not load overlay %s.\n", overlay_paths[number_layers - 1]);
+            unload_layers (layers, number_layers);
+            return 1;
+        }
+        dict = layers[number_layers];
+    }
+
+    // Calculate time to load overlays
+    stats.time_overlay = (stats_now () - before) / NANO_TO_S;
+
+    // Load bigram model of word data, shared by all threads
+    AUTOCORR_bigrams* bigrams = NULL;
+    if (context)
+    {
+        before = stats_now ();
+        bigrams = AUTOCORR_bigrams_load (dict, NULL);
+
+        // Loading model counts as loading word data
+        stats.time_load += (stats_now () - before) / NANO_TO_S;
+
+        if (bigrams == NULL)
+        {
+            printf ("Could not load bigram model of word data. Build it with spellcheck-build --bigrams.\n");
+            unload_layers (layers, number_layers);
+            return 1;
+        }
+    }
+
+    // Correction state, report buffer and unique misspellings of each thread
+    chunk_job job[JOBS_MAX];
+    memset (job, 0, sizeof (job));
+    unique_table tables[JOBS_MAX];
+    memset (tables, 0, sizeof (tables));
+
+    // File name as field of reports of single text file
+    char* field = NULL;
+
+    // Corrections of repeated misspellings, shared by all threads
+    AUTOCORR_cache* cache = NULL;
+    bool prepared = (cache_bytes == 0 || (cache = AUTOCORR_cache_new (cache_bytes)) != NULL);
+
+    // Answer requests of clients until interrupted, sharing word data and cache
+    if (prepared && serve_path != NULL)
+    {
+        // Server answers from all words, not just most frequent ones
+        bool loaded = AUTOCORR_dict_wait (dict);
+        if (!loaded)
+            printf ("Could not load word data file.\n");
+
+        bool served = loaded && serve (serve_path, dict, edit_distance, cache, bigrams);
+        AUTOCORR_cache_free (cache);
+        AUTOCORR_bigrams_unload (bigrams);
+        unload_layers (layers, number_layers);
+        return served ? 0 : 1;
+    }
+
+    prepared = prepared && (batch || (field = escape_field (argv[arg], format)) != NULL);
+
+    for (int i = 0; i < jobs && prepared; i++)
+    {
+        job[i].dict = dict;
+        job[i].ctx = AUTOCORR_ctx_new (dict);
+        prepared = (job[i].ctx != NULL) && AUTOCORR_ctx_set_edit_distance (job[i].ctx, edit_distance);
+        if (prepared)
+            AUTOCORR_ctx_set_cache (job[i].ctx, cache);
+
+        job[i].format = format;
+        job[i].file = field;
+        job[i].file_len = (field != NULL) ? strlen (field) : 0;
+        job[i].unique = unique ? &tables[i] : NULL;
+        job[i].bigrams = bigrams;
+    }
+
+    if (!prepared)
+    {
+        printf ("Out of memory. Text could not be checked.\n");
+
+        for (int i = 0; i < jobs; i++)
+            AUTOCORR_ctx_free (job[i].ctx);
+        free (field);
+        AUTOCORR_cache_free (cache);
+        AUTOCORR_bigrams_unload (bigrams);
+        unload_layers (layers, number_layers);
+        free_files (&files);
+        return 1;
+    }
+
+    // Wall clock time spent checking, less than sum of thread times when running in parallel
+    uint64_t wall_before = stats_now ();
+
+    // Header of report, printed once for all files
+    const char* header = format_header (format, unique);
+    if (header != NULL)
+        fputs (header, stdout);
+
+    // Spell-check text file, or each of several files
+    int unreadable = 0;
+    bool failed;
+    if (batch)
+        failed = !check_files (&files, job, jobs, &unreadable);
+    else
+        failed = !check_text (argv[arg], job, jobs, &policy);
+
+    // Words not among most frequent ones were reported misspelled if rest of word data failed to load
+    if (!failed && !AUTOCORR_dict_wait (dict))
     {
-        printf ("Could not open text file - %s.\n", text);
-        AUTOCORR_unload_words ();
+        printf ("Could not load word data file.\n");
+        failed = true;
+    }
+
+    // Report each misspelled word once, correcting it once, counts of all threads added together
+    if (unique && !failed)
+    {
+        before = stats_now ();
+        for (int i = 1; i < jobs && !failed; i++)
+            failed = !unique_merge (&tables[0], &tables[i]);
+
+        // Single text file printed header already
+        if (failed)
+            printf ("Out of memory. Misspellings could not be reported.\n");
+        else if (format == FORMAT_TEXT && batch)
+            printf ("\nMisspelled Words\n\n");
+
+        if (!failed)
+            failed = !unique_print (&tables[0], job[0].ctx, format, batch ? files.paths : argv + arg, stdout);
+
+        // Calculate time to correct unique misspellings
+        stats.time_correct += (stats_now () - before) / NANO_TO_S;
+    }
+
+    free_files (&files);
+    free (field);
+
+    stats.time_wall = (stats_now () - wall_before) / NANO_TO_S;
+
+    // Aggregate counters and benchmarks of all threads
+    for (int i = 0; i < jobs; i++)
+    {
+        stats.misspellings += job[i].misspellings;
+        stats.num_words += job[i].num_words;
+        stats.time_check += job[i].time_check;
+        stats.time_correct += job[i].time_correct;
+        stats.time_context += job[i].time_context;
+        histogram_merge (&stats.check_latency, &job[i].check_latency);
+        histogram_merge (&stats.correct_latency, &job[i].correct_latency);
+
+        AUTOCORR_stats work;
+        AUTOCORR_ctx_stats (job[i].ctx, &work);
+        stats.work.nodes_visited += work.nodes_visited;
+        stats.work.candidates_probed += work.candidates_probed;
+
+        free (job[i].report);
+        unique_free (&tables[i]);
+        AUTOCORR_ctx_free (job[i].ctx);
+    }
+
+    // Count corrections reused from cache
+    AUTOCORR_cache_stats (cache, &stats.cache_hits, &stats.cache_misses);
+    AUTOCORR_cache_free (cache);
+    AUTOCORR_bigrams_unload (bigrams);
+
+    // Check whether there was an error
+    if (failed)
+    {
+        unload_layers (layers, number_layers);
         return 1;
     }
 
+    // Determine dictionary's size
+    before = stats_now ();
+    stats.dict_words = AUTOCORR_dict_size (dict);
+
+    // Calculate time to determine dictionary's size
+    stats.time_size = (stats_now () - before) / NANO_TO_S;
+
+    // Unload word data file
+    before = stats_now ();
+    unload_layers (layers, number_layers);
+
+    // Calculate time to unload word data
+    stats.time_unload = (stats_now () - before) / NANO_TO_S;
+
+    // Report benchmarks
+    if (stats_json)
+        stats_print_json (&stats, stats_out);
+    else
+        stats_print_text (&stats, stats_out);
+
+    return (unreadable > 0) ? 1 : 0;
+}
+
+/**
+ *
+ * Spell-checks text file at path batch by batch, splitting each batch between jobs threads.
+ * Misspellings are printed in document order, with their positions in other formats than text.
+ * Streamed text is checked as it arrives, misspellings being flushed and running totals
+ * printed as set by policy.
+ * Returns true if successful else false.
+ *
+ */
+static bool check_text (const char* path, chunk_job* job, int jobs, const stream_policy* policy)
+{
+    text_input input;
+    if (!open_input (&input, path))
+    {
+        fprintf (job[0].format == FORMAT_TEXT ? stdout : stderr, "Could not open text file - %s.\n", path);
+        return false;
+    }
+
     // Prepare to report misspellings
-    printf ("\nMisspelled Words\n\n");
+    if (job[0].format == FORMAT_TEXT)
+        printf ("\nMisspelled Words\n\n");
+    fflush (stdout);
 
     // Prepare to spell-check
-    int index = 0, misspellings = 0, num_words = 0;
-    char word[AUTOCORR_LENGTH_MAX + 1];
+    size_t batch_size = (size_t) jobs * CHUNK_SIZE;
+    bool failed = false;
 
-    // Spell-check each word in text
-    for (int c = fgetc (text_file); c != EOF; c = fgetc (text_file))
-    {
-        // Allow only lowercase alphabetical characters and apostrophes
-        if (isalpha (c) || (c == '\'' && index > 0))
-        {
-            // Append character to word
-            word[index] = tolower (c);
-            index++;
+    // Position of batch in document, kept if positions are reported or counted
+    bool positions = (job[0].format != FORMAT_TEXT || job[0].unique != NULL);
+    text_position position = {0, 1, 0};
 
-            // Ignore alphabetical strings too long to be words
-            if (index > AUTOCORR_LENGTH_MAX)
-            {
-                // Consume remainder of alphabetical string
-                while ((c = fgetc (text_file)) != EOF && isalpha (c));
+    // Streams are flushed and totalled by time since start
+    bool stream = (input.map == NULL);
+    uint64_t start_ms = clock_ms (), flushed_ms = start_ms, totalled_ms = start_ms;
 
-                // Prepare for new word
-                index = 0;
-            }
+    // Spell-check text batch by batch, one chunk per thread
+    for (bool last = false; !last && !failed; )
+    {
+        // Check batch up to last word boundary, carrying partial word into next batch
+        const char* batch;
+        size_t filled, end;
+        if (!read_words (&input, &batch_size, &batch, &filled, &end, &last))
+        {
+            failed = true;
+            break;
         }
 
-        // Ignore words with numbers
-        else if (isdigit (c))
+        // Split batch into one chunk per thread, each ending on word boundary or at end of batch
+        // Small batches of streams are checked on fewer threads
+        int parts = (end / SPLIT_MIN < (size_t) jobs) ? end / SPLIT_MIN + 1 : jobs;
+        size_t start = 0;
+        for (int i = 0; i < jobs; i++)
         {
-            // Consume remainder of alphanumeric string
-            while ((c = fgetc (text_file)) != EOF && isalnum (c));
-
-            // Prepare for new word
-            index = 0;
+            size_t stop = (i >= parts - 1) ? end : end / parts * (i + 1);
+            while (stop > start && stop < end && !is_boundary (batch[stop - 1]))
+                stop--;
+
+            job[i].text = batch + start;
+            job[i].size = stop - start;
+            job[i].report_len = 0;
+            batch_bounds (&input, batch, filled, &job[i].context_start, &job[i].context_end);
+            start = stop;
+
+            // Chunk starts where previous one ends
+            job[i].position = position;
+            if (positions && i < jobs - 1)
+                advance_position (&position, job[i].text, job[i].size);
         }
 
-        // Whole word found
-        else if (index > 0)
-        {
-            // Terminate current word string
-            word[index] = '\0';
+        // Check first chunk on this thread, others on one thread each
+        pthread_t thread[JOBS_MAX];
+        bool started[JOBS_MAX] = {false};
 
-            // Update counter
-            num_words++;
+        for (int i = 1; i < jobs; i++)
+            started[i] = (job[i].size > 0 && pthread_create (&thread[i], NULL, check_chunk, &job[i]) == 0);
 
-            // Check word's spelling
-            getrusage (RUSAGE_SELF, &before);
-            int check = AUTOCORR_check_word (word);
-            getrusage (RUSAGE_SELF, &after);
+        for (int i = 0; i < jobs; i++)
+        {
+            if (i == 0 || (!started[i] && job[i].size > 0))
+                check_chunk (&job[i]);
+            else if (started[i])
+                pthread_join (thread[i], NULL);
+        }
 
-            // Update benchmark
-            time_check += calculate (&before, &after);
+        // Next batch starts where last chunk ends
+        position = job[jobs - 1].position;
 
-            // Print word if misspelled
-            if (check == -1)
-            {
-                // Check word's correction
-                getrusage (RUSAGE_SELF, &before);
-                char* word_corrected = AUTOCORR_correct_word (word);
-                getrusage (RUSAGE_SELF, &after);
+        // Report misspellings in document order
+        bool reported = false;
+        for (int i = 0; i < jobs; i++)
+        {
+            failed |= job[i].failed;
+            fwrite (job[i].report, 1, job[i].report_len, stdout);
+            reported |= (job[i].report_len > 0);
+        }
 
-                // Update benchmark
-                time_correct += calculate (&before, &after);
+        consume_batch (&input, filled, end);
 
-                if (word_corrected == NULL)
-                    printf ("%-45s No suggested correction\n", word);
-                else
-                    printf ("%-45s Suggested Correction: %s\n", word, word_corrected);
+        if (!stream)
+            continue;
 
-                misspellings++;
+        // Flush misspellings of stream once due
+        uint64_t now_ms = clock_ms ();
+        if (reported && now_ms - flushed_ms >= (uint64_t) policy -> flush_ms)
+        {
+            fflush (stdout);
+            flushed_ms = now_ms;
+        }
+
+        // Print running totals of stream once due
+        if (policy -> stats_every > 0 && now_ms - totalled_ms >= (uint64_t) policy -> stats_every * 1000)
+        {
+            long num_words = 0, misspellings = 0;
+            for (int i = 0; i < jobs; i++)
+            {
+                num_words += job[i].num_words;
+                misspellings += job[i].misspellings;
             }
 
-            // Prepare for next word
-            index = 0;
+            double seconds = (now_ms - start_ms) / 1000.0;
+            fprintf (stderr, "%.0f s: %ld words, %ld misspelled, %.0f words/s\n", seconds, num_words,
+                     misspellings, num_words / seconds);
+            totalled_ms = now_ms;
         }
     }
 
-    // Check whether there was an error
-    if (ferror (text_file))
+    close_input (&input);
+    return !failed;
+}
+
+/**
+ *
+ * Spell-checks text file at path on server listening on socket_path.
+ * Text is sent in chunks ending on word boundaries, so misspellings are reported as
+ * by checking text file locally.
+ * Returns exit status of program.
+ *
+ */
+static int check_remote (const char* socket_path, const char* path, bool stats_json)
+{
+    int fd = server_connect (socket_path);
+    if (fd < 0)
+    {
+        printf ("Could not connect to server - %s.\n", socket_path);
+        return 1;
+    }
+
+    text_input input;
+    if (!open_input (&input, path))
     {
-        fclose (text_file);
-        printf ("Error reading %s.\n", text);
-        AUTOCORR_unload_words ();
+        printf ("Could not open text file - %s.\n", path);
+        close (fd);
         return 1;
     }
 
-    // Close text file
-    fclose (text_file);
+    run_stats stats;
+    memset (&stats, 0, sizeof (stats));
+    stats.jobs = 1;
+    stats.remote = true;
 
-    // Determine dictionary's size
-    getrusage (RUSAGE_SELF, &before);
-    unsigned int n = AUTOCORR_size_data ();
-    getrusage (RUSAGE_SELF, &after);
+    // Prepare to report misspellings
+    printf ("\nMisspelled Words\n\n");
+    fflush (stdout);
 
-    // Calculate time to determine dictionary's size
-    time_size = calculate (&before, &after);
+    uint64_t before = stats_now ();
+    size_t batch_size = CHUNK_SIZE;
+    char* reply = NULL;
+    size_t reply_size = 0, reply_len;
+    bool failed = false;
 
-    // Unload word data file
-    getrusage (RUSAGE_SELF, &before);
-    AUTOCORR_unload_words ();
-    getrusage (RUSAGE_SELF, &after);
+    // Send text chunk by chunk, carrying partial word into next chunk
+    for (bool last = false; !last && !failed; )
+    {
+        const char* batch;
+        size_t filled, end;
+        if (!read_words (&input, &batch_size, &batch, &filled, &end, &last))
+        {
+            failed = true;
+            break;
+        }
 
-    // Calculate time to unload word data
-    time_unload = calculate(&before, &after);
+        // Reply starts with counts of chunk, followed by its report
+        int words, misspellings;
+        unsigned int dict_words;
+        char* report;
+        if (!server_request (fd, SERVE_DOCUMENT, batch, end, &reply, &reply_size, &reply_len) ||
+            sscanf (reply, "%d %d %u", &words, &misspellings, &dict_words) != 3 ||
+            (report = strchr (reply, '\n')) == NULL)
+        {
+            failed = true;
+            break;
+        }
+
+        report++;
+        fwrite (report, 1, reply_len - (report - reply), stdout);
+        stats.num_words += words;
+        stats.misspellings += misspellings;
+        stats.dict_words = dict_words;
+
+        consume_batch (&input, filled, end);
+    }
+
+    stats.time_wall = (stats_now () - before) / NANO_TO_S;
+
+    free (reply);
+    close_input (&input);
+    close (fd);
+
+    if (failed)
+        return 1;
 
     // Report benchmarks
-    printf ("\nWORDS MISSPELLED:                        %d\n", misspellings);
-    printf ("WORDS IN DICTIONARY:                     %d\n", n);
-    printf ("WORDS IN TEXT:                           %d\n", num_words);
-    printf ("Time in loading word data file:          %.2f seconds\n", time_load);
-    printf ("Time in checking text:                   %.2f seconds\n", time_check);
-    printf ("Time in correcting text:                 %.2f seconds\n", time_correct);
-    printf ("Time in finding size of word data:       %.2f seconds\n", time_size);
-    printf ("Time in unloading word data:             %.2f seconds\n", time_unload);
-    printf ("TIME IN TOTAL:                           %.2f seconds\n\n", time_load + time_check + time_size + time_unload + time_correct);
+    if (stats_json)
+        stats_print_json (&stats, stdout);
+    else
+        stats_print_text (&stats, stdout);
 
     return 0;
 }
 
 /**
  *
- * Returns number of seconds between b and a.
- * Uses resource usage structures.
+ * Adds words of word list file at path ("-" for standard input) to word data, all in one batch.
+ * Each line holds a word, or a count and a word as in word data file.
+ * Delta log is merged into word data file once it grows past log_bytes (1 MB if 0).
+ * Returns exit status of program.
  *
  */
-double calculate (const struct rusage* b, const struct rusage* a)
+static int learn_words (const char* path, size_t log_bytes)
 {
-    if (b == NULL || a == NULL)
+    FILE* list = (strcmp (path, "-") == 0) ? stdin : fopen (path, "r");
+    if (list == NULL)
     {
-        return 0.0;
+        printf ("Could not open word list file - %s.\n", path);
+        return 1;
+    }
+
+    // Words and counts read from list, words stored one after another
+    char* text = NULL;
+    size_t text_len = 0, text_size = 0;
+    size_t* offsets = NULL;
+    int* counts = NULL;
+    int n = 0, capacity = 0;
+    bool read = true;
+
+    char line[256], word[256];
+    while (read && fgets (line, sizeof (line), list) != NULL)
+    {
+        // Lines too long for any word are skipped whole, last line may lack its newline
+        if (strchr (line, '\n') == NULL && !feof (list))
+        {
+            while (fgets (line, sizeof (line), list) != NULL && strchr (line, '\n') == NULL)
+                ;
+            continue;
+        }
+
+        int count = 1;
+        if (sscanf (line, "%d %255s", &count, word) != 2 && sscanf (line, "%255s", word) != 1)
+            continue;
+
+        size_t length = strlen (word) + 1;
+        if (n == capacity)
+        {
+            capacity = capacity > 0 ? 2 * capacity : 4096;
+            size_t* grown_offsets = realloc (offsets, capacity * sizeof (size_t));
+            int* grown_counts = realloc (counts, capacity * sizeof (int));
+            offsets = (grown_offsets != NULL) ? grown_offsets : offsets;
+            counts = (grown_counts != NULL) ? grown_counts : counts;
+            read = (grown_offsets != NULL && grown_counts != NULL);
+        }
+        if (read && text_len + length > text_size)
+        {
+            text_size = 2 * text_size + length + 4096;
+            char* grown = realloc (text, text_size);
+            text = (grown != NULL) ? grown : text;
+            read = (grown != NULL);
+        }
+        if (!read)
+            break;
+
+        memcpy (text + text_len, word, length);
+        offsets[n] = text_len;
+        counts[n++] = count;
+        text_len += length;
     }
+
+    if (list != stdin)
+        fclose (list);
+
+    const char** words = read ? malloc ((n + 1) * sizeof (char*)) : NULL;
+    AUTOCORR_dict* dict = NULL;
+    int status = 1;
+
+    if (words == NULL)
+        printf ("Out of memory. Words could not be learned.\n");
+    else if ((dict = AUTOCORR_dict_upload ()) == NULL)
+        printf ("Could not load word data file.\n");
     else
     {
-        return ((((a -> ru_utime.tv_sec * MICRO_TO_S + a -> ru_utime.tv_usec) -
-                 (b -> ru_utime.tv_sec * MICRO_TO_S + b -> ru_utime.tv_usec)) +
-                ((a -> ru_stime.tv_sec * MICRO_TO_S + a -> ru_stime.tv_usec) -
-                 (b -> ru_stime.tv_sec * MICRO_TO_S + b -> ru_stime.tv_usec)))
-                / MICRO_TO_S);
+        for (int i = 0; i < n; i++)
+            words[i] = text + offsets[i];
+
+        AUTOCORR_dict_set_log_limit (dict, log_bytes);
+
+        unsigned int before = AUTOCORR_dict_size (dict);
+        int learned = AUTOCORR_dict_learn (dict, words, counts, n);
+        if (learned >= 0)
+        {
+            printf ("Learned %d words, %u new to word data.\n", learned, AUTOCORR_dict_size (dict) - before);
+            status = 0;
+        }
+        else
+            printf ("Could not learn words.\n");
     }
+
+    AUTOCORR_dict_unload (dict);
+    free (words);
+    free (text);
+    free (offsets);
+    free (counts);
+    return status;
+}
+
+/**
+ *
+ * Gives monotonic clock time in milliseconds.
+ * Used for output policy, so kept when instrumentation is compiled out.
+ *
+ */
+static uint64_t clock_ms (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+
+/**
+ *
+ * Unloads count layers of word data, from top overlay (last) down to word data (first).
+ *
+ */
+static void unload_layers (AUTOCORR_dict** layers, int count)
+{
+    while (count > 0)
+        AUTOCORR_dict_unload (layers[--count]);
+}
+
+/**
+ *
+ * Parses value, whole number of megabytes between 0 and MEGABYTES_MAX, into bytes.
+ * Returns true if successful else false, bytes being left unchanged.
+ *
+ */
+static bool parse_megabytes (const char* value, size_t* bytes)
+{
+    char* end;
+    long megabytes = strtol (value, &end, 10);
+    if (end == value || *end != '\0' || megabytes < 0 || megabytes > MEGABYTES_MAX ||
+        (size_t) megabytes > SIZE_MAX >> 20)
+        return false;
+
+    *bytes = (size_t) megabytes << 20;
+    return true;
+}
+
+/**
+ *
+ * Parses value, whole number between min and max, into number.
+ * Returns true if successful else false, number being left unchanged.
+ *
+ */
+static bool parse_number (const char* value, int min, int max, int* number)
+{
+    char* end;
+    long parsed = strtol (value, &end, 10);
+    if (end == value || *end != '\0' || parsed < min || parsed > max)
+        return false;
+
+    *number = (int) parsed;
+    return true;
 }
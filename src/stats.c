@@ -0,0 +1,237 @@
+/**
+ * stats.c
+ *
+ * Implements instrumentation of spell-checker.
+ * Latency histograms and benchmark reports as text or JSON.
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+
+#include "stats.h"
+
+#if AUTOCORR_STATS
+
+/**
+ *
+ * Gives histogram bucket of latency of ns nanoseconds.
+ *
+ */
+static int histogram_bucket (uint64_t ns)
+{
+    if (ns < HISTOGRAM_STEPS)
+        return ns;
+
+    // Highest set bit selects power of two, bits below it select step
+    int e = 63 - __builtin_clzll (ns);
+    return (e - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_STEPS + ((ns >> (e - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_STEPS - 1));
+}
+
+/**
+ *
+ * Records latency sample of ns nanoseconds.
+ *
+ */
+void histogram_add (histogram* h, uint64_t ns)
+{
+    h -> count[histogram_bucket (ns)]++;
+    h -> samples++;
+
+    if (ns > h -> max)
+        h -> max = ns;
+}
+
+/**
+ *
+ * Adds samples of histogram from to histogram into.
+ *
+ */
+void histogram_merge (histogram* into, const histogram* from)
+{
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+        into -> count[b] += from -> count[b];
+
+    into -> samples += from -> samples;
+    if (from -> max > into -> max)
+        into -> max = from -> max;
+}
+
+#endif // AUTOCORR_STATS
+
+/**
+ *
+ * Gives largest latency in nanoseconds falling into histogram bucket b.
+ *
+ */
+static uint64_t bucket_limit (int b)
+{
+    if (b < HISTOGRAM_STEPS)
+        return b;
+
+    int e = b / HISTOGRAM_STEPS + HISTOGRAM_SUB_BITS - 1;
+    uint64_t step = (uint64_t) 1 << (e - HISTOGRAM_SUB_BITS);
+
+    return (HISTOGRAM_STEPS + b % HISTOGRAM_STEPS) * step + step - 1;
+}
+
+/**
+ *
+ * Gives approximate latency in nanoseconds below which fraction p of samples lie.
+ * Returns 0 if there are no samples.
+ *
+ */
+uint64_t histogram_percentile (const histogram* h, double p)
+{
+    if (h -> samples == 0)
+        return 0;
+
+    // Rank of sample at percentile, counting from 1
+    unsigned long rank = p * h -> samples + 0.5;
+    if (rank < 1)
+        rank = 1;
+
+    unsigned long seen = 0;
+    for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+    {
+        seen += h -> count[b];
+        if (seen >= rank)
+            return bucket_limit (b) < h -> max ? bucket_limit (b) : h -> max;
+    }
+
+    return h -> max;
+}
+
+/**
+ *
+ * Prints benchmark report to out.
+ *
+ */
+void stats_print_text (const run_stats* stats, FILE* out)
+{
+    fprintf (out, "\nWORDS MISSPELLED:                        %d\n", stats -> misspellings);
+    fprintf (out, "WORDS IN DICTIONARY:                     %d\n", stats -> dict_words);
+    fprintf (out, "WORDS IN TEXT:                           %d\n", stats -> num_words);
+    if (stats -> files > 0)
+        fprintf (out, "FILES CHECKED:                           %d\n", stats -> files);
+    if (stats -> cache_used)
+    {
+        fprintf (out, "CORRECTIONS FROM CACHE:                  %lu\n", stats -> cache_hits);
+        fprintf (out, "CORRECTIONS NOT IN CACHE:                %lu\n", stats -> cache_misses);
+    }
+
+#if AUTOCORR_STATS
+    if (stats -> remote)
+    {
+        fprintf (out, "Time in server requests:                 %.2f seconds\n\n", stats -> time_wall);
+        return;
+    }
+
+    fprintf (out, "TRIE NODES VISITED:                      %lu\n", stats -> work.nodes_visited);
+    fprintf (out, "CANDIDATES PROBED:                       %lu\n", stats -> work.candidates_probed);
+    fprintf (out, "Check latency per word p50/p99/max:      %lu / %lu / %lu ns\n",
+            (unsigned long) histogram_percentile (&stats -> check_latency, 0.50),
+            (unsigned long) histogram_percentile (&stats -> check_latency, 0.99),
+            (unsigned long) stats -> check_latency.max);
+    fprintf (out, "Correct latency p50/p99/max:             %lu / %lu / %lu ns\n",
+            (unsigned long) histogram_percentile (&stats -> correct_latency, 0.50),
+            (unsigned long) histogram_percentile (&stats -> correct_latency, 0.99),
+            (unsigned long) stats -> correct_latency.max);
+    fprintf (out, "Time in loading word data file:          %.2f seconds\n", stats -> time_load);
+    if (stats -> index_used)
+        fprintf (out, "Time in building deletes index:          %.2f seconds\n", stats -> time_index);
+    if (stats -> overlays > 0)
+        fprintf (out, "Time in loading overlays:                %.2f seconds\n", stats -> time_overlay);
+    fprintf (out, "Time in checking text:                   %.2f seconds\n", stats -> time_check);
+    fprintf (out, "Time in correcting text:                 %.2f seconds\n", stats -> time_correct);
+    if (stats -> context_used)
+        fprintf (out, "Time in checking context:                %.2f seconds\n", stats -> time_context);
+    if (stats -> jobs > 1)
+        fprintf (out, "Wall time in checking, %2d threads:       %.2f seconds\n", stats -> jobs, stats -> time_wall);
+    fprintf (out, "Time in finding size of word data:       %.2f seconds\n", stats -> time_size);
+    fprintf (out, "Time in unloading word data:             %.2f seconds\n", stats -> time_unload);
+    fprintf (out, "TIME IN TOTAL:                           %.2f seconds\n", stats -> time_load + stats -> time_index + stats -> time_overlay +
+            stats -> time_check + stats -> time_size + stats -> time_unload + stats -> time_correct + stats -> time_context);
+#endif
+
+    fprintf (out, "\n");
+}
+
+#if AUTOCORR_STATS
+/**
+ *
+ * Prints latency histogram summary as JSON object to out.
+ *
+ */
+static void print_latency_json (FILE* out, const char* name, const histogram* h, bool last)
+{
+    fprintf (out, "    \"%s\": {\"samples\": %lu, \"p50\": %lu, \"p99\": %lu, \"max\": %lu}%s\n", name, h -> samples,
+            (unsigned long) histogram_percentile (h, 0.50), (unsigned long) histogram_percentile (h, 0.99),
+            (unsigned long) h -> max, last ? "" : ",");
+}
+#endif
+
+/**
+ *
+ * Prints benchmark report as JSON object to out.
+ * Times in seconds, latencies in nanoseconds.
+ *
+ */
+void stats_print_json (const run_stats* stats, FILE* out)
+{
+    fprintf (out, "\n{\n");
+    fprintf (out, "  \"words_misspelled\": %d,\n", stats -> misspellings);
+    fprintf (out, "  \"words_in_dictionary\": %u,\n", stats -> dict_words);
+    fprintf (out, "  \"words_in_text\": %d,\n", stats -> num_words);
+    fprintf (out, "  \"jobs\": %d,\n", stats -> jobs);
+    if (stats -> files > 0)
+        fprintf (out, "  \"files\": %d,\n", stats -> files);
+    if (stats -> overlays > 0)
+        fprintf (out, "  \"overlays\": %d,\n", stats -> overlays);
+
+    if (stats -> cache_used)
+        fprintf (out, "  \"cache\": {\"hits\": %lu, \"misses\": %lu},\n", stats -> cache_hits, stats -> cache_misses);
+
+#if AUTOCORR_STATS
+    if (stats -> remote)
+    {
+        fprintf (out, "  \"remote\": true,\n");
+        fprintf (out, "  \"time_seconds\": {\"server_requests\": %.6f},\n", stats -> time_wall);
+        fprintf (out, "  \"stats_enabled\": true\n");
+        fprintf (out, "}\n");
+        return;
+    }
+
+    fprintf (out, "  \"counters\": {\"trie_nodes_visited\": %lu, \"candidates_probed\": %lu},\n",
+            stats -> work.nodes_visited, stats -> work.candidates_probed);
+
+    fprintf (out, "  \"latency_ns\": {\n");
+    print_latency_json (out, "check", &stats -> check_latency, false);
+    print_latency_json (out, "correct", &stats -> correct_latency, true);
+    fprintf (out, "  },\n");
+
+    fprintf (out, "  \"time_seconds\": {\n");
+    fprintf (out, "    \"load\": %.6f,\n", stats -> time_load);
+    if (stats -> index_used)
+        fprintf (out, "    \"index\": %.6f,\n", stats -> time_index);
+    if (stats -> overlays > 0)
+        fprintf (out, "    \"overlays\": %.6f,\n", stats -> time_overlay);
+    fprintf (out, "    \"check\": %.6f,\n", stats -> time_check);
+    fprintf (out, "    \"correct\": %.6f,\n", stats -> time_correct);
+    if (stats -> context_used)
+        fprintf (out, "    \"context\": %.6f,\n", stats -> time_context);
+    fprintf (out, "    \"wall_check\": %.6f,\n", stats -> time_wall);
+    fprintf (out, "    \"size\": %.6f,\n", stats -> time_size);
+    fprintf (out, "    \"unload\": %.6f,\n", stats -> time_unload);
+    fprintf (out, "    \"total\": %.6f\n", stats -> time_load + stats -> time_index + stats -> time_overlay + stats -> time_check +
+            stats -> time_size + stats -> time_unload + stats -> time_correct + stats -> time_context);
+    fprintf (out, "  },\n");
+#endif
+
+    fprintf (out, "  \"stats_enabled\": %s\n", AUTOCORR_STATS ? "true" : "false");
+    fprintf (out, "}\n");
+}
@@ -0,0 +1,152 @@
+/**
+ * stats.h
+ *
+ * Instrumentation of spell-checker: phase timers, latency histograms and report
+ * Compiled out entirely when built with AUTOCORR_STATS=0 (make STATS=0)
+ *
+ * stats_now - give monotonic clock time in nanoseconds
+ * histogram_add - record latency sample
+ * histogram_merge - add samples of one histogram to another
+ * histogram_percentile - give approximate latency percentile
+ * stats_print_text - print benchmark report
+ * stats_print_json - print benchmark report as JSON
+ *
+ * Copyright (C)   2016    Madhav Datt
+ * http://www.gnu.org/licenses/old-licenses/gpl-2.0.html
+ *
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../autocorrect-lib/autocorrect.h"
+
+// Nanoseconds to a second
+#define NANO_TO_S 1000000000.0
+
+// Histogram buckets split each power of two into 2^HISTOGRAM_SUB_BITS steps
+#define HISTOGRAM_SUB_BITS 2
+#define HISTOGRAM_STEPS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS (64 * HISTOGRAM_STEPS)
+
+/**
+ * Latency histogram in nanoseconds.
+ * Log-linear buckets: percentiles are within 1 / HISTOGRAM_STEPS of exact value.
+ */
+typedef struct histogram
+{
+    unsigned long count[HISTOGRAM_BUCKETS];
+    unsigned long samples;
+    uint64_t max;
+} histogram;
+
+/**
+ * Results and benchmarks of one spell-check run.
+ * Times are in seconds, check and correct times summed over all threads.
+ */
+typedef struct run_stats
+{
+    int jobs;
+    int files;
+    int misspellings;
+    int num_words;
+    unsigned int dict_words;
+
+    bool cache_used;
+    unsigned long cache_hits;
+    unsigned long cache_misses;
+
+    bool index_used;
+
+    // Number of overlay dictionaries layered over word data, time_overlay being time spent loading them
+    int overlays;
+
+    // Words checked in context of their neighbors, time_context being time spent on it
+    bool context_used;
+
+    // Checked by server: only counts and time_wall (time in server requests) are known
+    bool remote;
+
+    double time_load;
+    double time_index;
+    double time_overlay;
+    double time_check;
+    double time_correct;
+    double time_context;
+    double time_wall;
+    double time_size;
+    double time_unload;
+
+    // Work counters of all threads
+    AUTOCORR_stats work;
+
+    // Check latency per word (sampled per batch) and latency per correction
+    histogram check_latency;
+    histogram correct_latency;
+} run_stats;
+
+#if AUTOCORR_STATS
+
+/**
+ *
+ * Gives time of monotonic clock in nanoseconds.
+ * Served by vDSO on Linux, no system call.
+ *
+ */
+static inline uint64_t stats_now (void)
+{
+    struct timespec t;
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+/**
+ *
+ * Records latency sample of ns nanoseconds.
+ *
+ */
+void histogram_add (histogram* h, uint64_t ns);
+
+/**
+ *
+ * Adds samples of histogram from to histogram into.
+ *
+ */
+void histogram_merge (histogram* into, const histogram* from);
+
+#else
+
+#define stats_now() ((uint64_t) 0)
+#define histogram_add(h, ns) ((void) 0)
+#define histogram_merge(into, from) ((void) 0)
+
+#endif // AUTOCORR_STATS
+
+/**
+ *
+ * Gives approximate latency in nanoseconds below which fraction p of samples lie.
+ * Returns 0 if there are no samples.
+ *
+ */
+uint64_t histogram_percentile (const histogram* h, double p);
+
+/**
+ *
+ * Prints benchmark report to out.
+ *
+ */
+void stats_print_text (const run_stats* stats, FILE* out);
+
+/**
+ *
+ * Prints benchmark report as JSON object to out.
+ *
+ */
+void stats_print_json (const run_stats* stats, FILE* out);
+
+#endif // STATS_H